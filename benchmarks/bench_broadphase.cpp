@@ -0,0 +1,405 @@
+// headless benchmarks for `itu_lib_broadphase`, uniform grid (`grid`) against sweep and prune (`sap`)
+// a field of moving circles, bouncing on the edges of a square world. The world grows with the number of circles,
+// so that density (and so the number of pairs per circle) stays the same at every count.
+// Circles are either spread all over the world (`uniform`) or packed in a few dense clusters (`clustered`).
+// Results are written as JSON (stdout, or the file passed with `--out`), same format as `bench_ecs`.
+//
+// usage: bench_broadphase [--out results.json]
+//
+// `frame` is a whole collision frame (move all proxies, update, pairs, circle test on every pair): the target is
+// 100k circles well within a 60 Hz frame (16.6 ms)
+
+#define TEXTURE_PIXELS_PER_UNIT 128
+#define CAMERA_PIXELS_PER_UNIT  32
+
+#include <itu_unity_include.hpp>
+
+#include <stdio.h>
+
+#define NUM_TRIALS 10
+
+#define CIRCLE_RADIUS    0.5f
+#define CIRCLE_SPACING   2.0f  // average distance between circles
+#define CIRCLE_SPEED     4.0f
+#define CELL_SIZE        (CIRCLE_RADIUS * 4)
+#define PAIRS_PER_CIRCLE 8     // pairs buffer size
+#define QUERY_COUNT      1024
+#define QUERY_SIZE       (CELL_SIZE * 4)
+#define CLUSTERS_COUNT   32
+#define CLUSTERS_DENSITY 4.0f  // how much denser than `uniform` clusters are
+
+#define array_count(arr) (sizeof(arr) / sizeof(arr[0]))
+
+enum BenchBroadphase
+{
+	BENCH_BROADPHASE_GRID,
+	BENCH_BROADPHASE_SAP,
+};
+
+enum BenchDistribution
+{
+	BENCH_DISTRIBUTION_UNIFORM,
+	BENCH_DISTRIBUTION_CLUSTERED,
+};
+
+static const char* bench_broadphase_names[]   = { "grid", "sap" };
+static const char* bench_distribution_names[] = { "uniform", "clustered" };
+
+struct BenchResult
+{
+	const char* name;
+	BenchBroadphase broadphase;
+	BenchDistribution distribution;
+	int entities_count;
+	int ops_count;
+	Uint64 min;
+	Uint64 max;
+	Uint64 avg;
+};
+
+struct BenchCircle
+{
+	vec2f position;
+	vec2f velocity;
+	int proxy;
+};
+
+struct BenchContext
+{
+	ITU_Broadphase broadphase;
+	ITU_BroadphaseSap sap;
+	BenchBroadphase broadphase_type;
+	BenchDistribution distribution;
+	stbds_arr(BenchCircle) circles;
+	stbds_arr(ITU_BroadphasePair) pairs;
+	stbds_arr(Uint32) query_ids;
+	stbds_arr(BenchResult) results;
+	Uint32 rng_state;
+	float world_size;
+
+	// written by every trial, so that loops can't be optimized away
+	float sink;
+};
+
+static BenchContext ctx_bench;
+
+static Uint32 bench_rand()
+{
+	// xorshift32, deterministic across platforms
+	Uint32 x = ctx_bench.rng_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	ctx_bench.rng_state = x;
+	return x;
+}
+
+static float bench_randf()
+{
+	return (float)(bench_rand() & 0xFFFFFF) / (float)0x1000000;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// setup
+
+static vec2f bench_world_position(vec2f* clusters)
+{
+	if(ctx_bench.distribution == BENCH_DISTRIBUTION_UNIFORM)
+		return vec2f { bench_randf(), bench_randf() } * ctx_bench.world_size;
+
+	// uniform in a disc around a random cluster. All clusters together cover `1 / CLUSTERS_DENSITY` of the world
+	float cluster_radius = ctx_bench.world_size / SDL_sqrtf(CLUSTERS_DENSITY * CLUSTERS_COUNT * SDL_PI_F);
+	vec2f center = clusters[bench_rand() % CLUSTERS_COUNT];
+	float angle = bench_randf() * 2 * SDL_PI_F;
+	float distance = SDL_sqrtf(bench_randf()) * cluster_radius;
+	vec2f ret = center + vec2f { SDL_cosf(angle), SDL_sinf(angle) } * distance;
+	ret.x = SDL_clamp(ret.x, 0.0f, ctx_bench.world_size);
+	ret.y = SDL_clamp(ret.y, 0.0f, ctx_bench.world_size);
+	return ret;
+}
+
+static void bench_world_populate(int circles_count, BenchBroadphase broadphase_type, BenchDistribution distribution)
+{
+	ctx_bench.rng_state = 0x9E3779B9;
+	ctx_bench.world_size = SDL_sqrtf((float)circles_count) * CIRCLE_SPACING;
+	ctx_bench.broadphase_type = broadphase_type;
+	ctx_bench.distribution = distribution;
+
+	vec2f clusters[CLUSTERS_COUNT];
+	for(int i = 0; i < CLUSTERS_COUNT; ++i)
+		clusters[i] = vec2f { bench_randf(), bench_randf() } * ctx_bench.world_size;
+
+	itu_lib_broadphase_clear(&ctx_bench.broadphase);
+	itu_lib_broadphase_sap_clear(&ctx_bench.sap);
+	stbds_arrsetlen(ctx_bench.circles, circles_count);
+	stbds_arrsetlen(ctx_bench.pairs, circles_count * PAIRS_PER_CIRCLE);
+	for(int i = 0; i < circles_count; ++i)
+	{
+		BenchCircle* circle = &ctx_bench.circles[i];
+		circle->position = bench_world_position(clusters);
+		float angle = bench_randf() * 2 * SDL_PI_F;
+		circle->velocity = vec2f { SDL_cosf(angle), SDL_sinf(angle) } * CIRCLE_SPEED;
+
+		vec2f extents = vec2f { CIRCLE_RADIUS, CIRCLE_RADIUS };
+		if(broadphase_type == BENCH_BROADPHASE_GRID)
+			circle->proxy = itu_lib_broadphase_insert(&ctx_bench.broadphase, circle->position - extents, circle->position + extents, i, false);
+		else
+			circle->proxy = itu_lib_broadphase_sap_insert(&ctx_bench.sap, circle->position - extents, circle->position + extents, i, false);
+	}
+	if(broadphase_type == BENCH_BROADPHASE_GRID)
+		itu_lib_broadphase_update(&ctx_bench.broadphase);
+	else
+		itu_lib_broadphase_sap_update(&ctx_bench.sap);
+}
+
+// NOTE: circles bounce instead of wrapping around. Wrapping would teleport them to the other side of the world,
+//       which is the worst case for sweep and prune and not what most games do
+static void bench_world_move(float delta)
+{
+	vec2f extents = vec2f { CIRCLE_RADIUS, CIRCLE_RADIUS };
+	for(int i = 0; i < stbds_arrlen(ctx_bench.circles); ++i)
+	{
+		BenchCircle* circle = &ctx_bench.circles[i];
+		circle->position += circle->velocity * delta;
+		if(circle->position.x < 0 || circle->position.x >= ctx_bench.world_size)
+		{
+			circle->velocity.x = -circle->velocity.x;
+			circle->position.x = SDL_clamp(circle->position.x, 0.0f, ctx_bench.world_size);
+		}
+		if(circle->position.y < 0 || circle->position.y >= ctx_bench.world_size)
+		{
+			circle->velocity.y = -circle->velocity.y;
+			circle->position.y = SDL_clamp(circle->position.y, 0.0f, ctx_bench.world_size);
+		}
+
+		if(ctx_bench.broadphase_type == BENCH_BROADPHASE_GRID)
+			itu_lib_broadphase_move(&ctx_bench.broadphase, circle->proxy, circle->position - extents, circle->position + extents);
+		else
+			itu_lib_broadphase_sap_move(&ctx_bench.sap, circle->proxy, circle->position - extents, circle->position + extents);
+	}
+}
+
+static void bench_world_update()
+{
+	if(ctx_bench.broadphase_type == BENCH_BROADPHASE_GRID)
+		itu_lib_broadphase_update(&ctx_bench.broadphase);
+	else
+		itu_lib_broadphase_sap_update(&ctx_bench.sap);
+}
+
+// returns how many pairs actually overlap
+static int bench_narrowphase(int pairs_count)
+{
+	int hits = 0;
+	for(int i = 0; i < pairs_count; ++i)
+	{
+		BenchCircle* a = &ctx_bench.circles[ctx_bench.pairs[i].user_id_a];
+		BenchCircle* b = &ctx_bench.circles[ctx_bench.pairs[i].user_id_b];
+		hits += itu_lib_overlaps_circle_circle(a->position, CIRCLE_RADIUS, b->position, CIRCLE_RADIUS);
+	}
+	return hits;
+}
+
+static int bench_pairs()
+{
+	// NOTE: sweep and prune also reports only what changed (`pairs_added`/`pairs_removed`), but here we want all of
+	//       them every frame, same as the grid
+	int pairs_max = (int)stbds_arrlen(ctx_bench.pairs);
+	int pairs_count = ctx_bench.broadphase_type == BENCH_BROADPHASE_GRID
+		? itu_lib_broadphase_pairs(&ctx_bench.broadphase, ctx_bench.pairs, pairs_max)
+		: itu_lib_broadphase_sap_pairs(&ctx_bench.sap, ctx_bench.pairs, pairs_max);
+	if(pairs_count > pairs_max)
+	{
+		SDL_Log("WARNING pairs buffer too small (%d > %d)", pairs_count, pairs_max);
+		pairs_count = pairs_max;
+	}
+	return pairs_count;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// trials
+
+static void bench_result_begin(BenchResult* result, const char* name, int entities_count, int ops_count)
+{
+	result->name = name;
+	result->broadphase = ctx_bench.broadphase_type;
+	result->distribution = ctx_bench.distribution;
+	result->entities_count = entities_count;
+	result->ops_count = ops_count;
+	result->min = (Uint64)-1;
+	result->max = 0;
+	result->avg = 0;
+}
+
+static void bench_result_sample(BenchResult* result, Uint64 elapsed)
+{
+	result->min = SDL_min(result->min, elapsed);
+	result->max = SDL_max(result->max, elapsed);
+	result->avg += elapsed;
+}
+
+static void bench_result_end(BenchResult* result)
+{
+	result->avg /= NUM_TRIALS;
+	stbds_arrput(ctx_bench.results, *result);
+}
+
+// moving every proxy and rebuilding the cells (grid) or re-sorting the endpoints (sap)
+static void bench_update(int circles_count, BenchBroadphase broadphase_type, BenchDistribution distribution)
+{
+	bench_world_populate(circles_count, broadphase_type, distribution);
+
+	BenchResult result;
+	bench_result_begin(&result, "update", circles_count, circles_count);
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		Uint64 time_beg = SDL_GetTicksNS();
+		bench_world_move(1.0f / 60.0f);
+		bench_world_update();
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+	}
+	bench_result_end(&result);
+}
+
+// pair generation only, on a world that doesn't change between trials
+static void bench_pairs_only(int circles_count, BenchBroadphase broadphase_type, BenchDistribution distribution)
+{
+	bench_world_populate(circles_count, broadphase_type, distribution);
+
+	BenchResult result;
+	bench_result_begin(&result, "pairs", circles_count, circles_count);
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		Uint64 time_beg = SDL_GetTicksNS();
+		int pairs_count = bench_pairs();
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+		ctx_bench.sink += (float)pairs_count;
+	}
+	bench_result_end(&result);
+}
+
+// grid only, sweep and prune has no queries
+static void bench_query(int circles_count, BenchDistribution distribution)
+{
+	bench_world_populate(circles_count, BENCH_BROADPHASE_GRID, distribution);
+	stbds_arrsetlen(ctx_bench.query_ids, circles_count);
+
+	BenchResult result;
+	bench_result_begin(&result, "query", circles_count, QUERY_COUNT);
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		Uint64 time_beg = SDL_GetTicksNS();
+		int found = 0;
+		for(int i = 0; i < QUERY_COUNT; ++i)
+		{
+			vec2f query_min = vec2f { bench_randf(), bench_randf() } * (ctx_bench.world_size - QUERY_SIZE);
+			vec2f query_max = query_min + vec2f { QUERY_SIZE, QUERY_SIZE };
+			found += itu_lib_broadphase_query(&ctx_bench.broadphase, query_min, query_max, ctx_bench.query_ids, circles_count);
+		}
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+		ctx_bench.sink += (float)found;
+	}
+	bench_result_end(&result);
+}
+
+static void bench_frame(int circles_count, BenchBroadphase broadphase_type, BenchDistribution distribution)
+{
+	bench_world_populate(circles_count, broadphase_type, distribution);
+
+	BenchResult result;
+	bench_result_begin(&result, "frame", circles_count, circles_count);
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		Uint64 time_beg = SDL_GetTicksNS();
+		bench_world_move(1.0f / 60.0f);
+		bench_world_update();
+		int hits = bench_narrowphase(bench_pairs());
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+		ctx_bench.sink += (float)hits;
+	}
+	bench_result_end(&result);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// output
+
+static void bench_write_json(FILE* out)
+{
+	fprintf(out, "{\n");
+	fprintf(out, "\t\"benchmark\": \"broadphase\",\n");
+	fprintf(out, "\t\"cell_size\": %.3f,\n", CELL_SIZE);
+	fprintf(out, "\t\"trials\": %d,\n", NUM_TRIALS);
+	fprintf(out, "\t\"results\": [\n");
+	for(int i = 0; i < stbds_arrlen(ctx_bench.results); ++i)
+	{
+		BenchResult* result = &ctx_bench.results[i];
+		fprintf(out,
+			"\t\t{ \"name\": \"%s\", \"broadphase\": \"%s\", \"distribution\": \"%s\", \"entities\": %d, \"ops\": %d, \"min_ns\": %llu, \"avg_ns\": %llu, \"max_ns\": %llu, \"avg_ns_per_op\": %.3f }%s\n",
+			result->name, bench_broadphase_names[result->broadphase], bench_distribution_names[result->distribution], result->entities_count, result->ops_count,
+			(unsigned long long)result->min, (unsigned long long)result->avg, (unsigned long long)result->max,
+			result->ops_count ? (double)result->avg / result->ops_count : 0.0,
+			i + 1 < stbds_arrlen(ctx_bench.results) ? "," : ""
+		);
+	}
+	fprintf(out, "\t]\n");
+	fprintf(out, "}\n");
+}
+
+int main(int argc, char** argv)
+{
+	const char* path_out = NULL;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(SDL_strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			path_out = argv[++i];
+		else
+		{
+			fprintf(stderr, "usage: %s [--out results.json]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	itu_lib_broadphase_init(&ctx_bench.broadphase, CELL_SIZE, 1024);
+	itu_lib_broadphase_sap_init(&ctx_bench.sap, 1024);
+
+	int sizes[] = { 1000, 10 * 1000, 100 * 1000 };
+	for(int s = 0; s < (int)array_count(sizes); ++s)
+	{
+		int circles_count = sizes[s];
+		fprintf(stderr, "running %d circles...\n", circles_count);
+
+		for(int d = 0; d < (int)array_count(bench_distribution_names); ++d)
+		{
+			BenchDistribution distribution = (BenchDistribution)d;
+			for(int b = 0; b < (int)array_count(bench_broadphase_names); ++b)
+			{
+				BenchBroadphase broadphase_type = (BenchBroadphase)b;
+				bench_update(circles_count, broadphase_type, distribution);
+				bench_pairs_only(circles_count, broadphase_type, distribution);
+				bench_frame(circles_count, broadphase_type, distribution);
+			}
+			bench_query(circles_count, distribution);
+		}
+	}
+
+	FILE* out = stdout;
+	if(path_out)
+	{
+		out = fopen(path_out, "w");
+		if(!out)
+		{
+			fprintf(stderr, "could not open %s\n", path_out);
+			return 1;
+		}
+	}
+	bench_write_json(out);
+	if(out != stdout)
+		fclose(out);
+
+	itu_lib_broadphase_free(&ctx_bench.broadphase);
+	itu_lib_broadphase_sap_free(&ctx_bench.sap);
+
+	// keeps `sink` alive
+	fprintf(stderr, "done (%f)\n", ctx_bench.sink);
+	return 0;
+}
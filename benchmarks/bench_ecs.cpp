@@ -0,0 +1,464 @@
+// headless benchmarks for `itu_entity_storage`
+// no window, no renderer: only the entity storage is exercised, through its public API.
+// Results are written as JSON (stdout, or the file passed with `--out`), so that runs before and after a change to the
+// storage internals can be compared.
+//
+// usage: bench_ecs [--archetype] [--group] [--out results.json]
+// `--group` puts Transform and Sprite in a component group (sparse set mode only, see `itu_sys_estorage_group_add`)
+// run it once with and once without `--archetype` to compare the two storage layouts, from 1k up to 1M entities
+//
+// every benchmark is run on a freshly populated storage at each entity count, `NUM_TRIALS` times.
+// `ops` is how many entities (or entity operations) a single trial touches, used to normalize timings
+
+#define TEXTURE_PIXELS_PER_UNIT 128
+#define CAMERA_PIXELS_PER_UNIT  32
+
+#include <itu_unity_include.hpp>
+
+#include <stdio.h>
+
+#define NUM_TRIALS 10
+
+#define BENCH_TAG 0
+
+#define array_count(arr) (sizeof(arr) / sizeof(arr[0]))
+
+struct BenchResult
+{
+	const char* name;
+	int entities_count;
+	int ops_count;
+	Uint64 min;
+	Uint64 max;
+	Uint64 avg;
+};
+
+struct BenchContext
+{
+	SDLContext context;
+	stbds_arr(ITU_EntityId) entities;
+	stbds_arr(BenchResult) results;
+	Uint32 rng_state;
+
+	// written by systems, so that their loops can't be optimized away
+	float sink;
+};
+
+static BenchContext ctx_bench;
+
+static Uint32 bench_rand()
+{
+	// xorshift32, deterministic across platforms
+	Uint32 x = ctx_bench.rng_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	ctx_bench.rng_state = x;
+	return x;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// systems
+
+static void bench_system_join2(SDLContext* context, ITU_EntityId* entity_ids, int entity_ids_count)
+{
+	itu_view<Transform, Sprite> view(entity_ids, entity_ids_count);
+	float sum = 0;
+	for(int i = 0; i < view.count; ++i)
+	{
+		Transform* transform = view.get<Transform>(i);
+		Sprite*    sprite    = view.get<Sprite>(i);
+		transform->position.x += sprite->pivot.x * context->delta;
+		sum += transform->position.x;
+	}
+	ctx_bench.sink += sum;
+}
+
+static void bench_system_join3(SDLContext* context, ITU_EntityId* entity_ids, int entity_ids_count)
+{
+	itu_view<Transform, Sprite, PhysicsData> view(entity_ids, entity_ids_count);
+	float sum = 0;
+	for(int i = 0; i < view.count; ++i)
+	{
+		Transform*   transform = view.get<Transform>(i);
+		Sprite*      sprite    = view.get<Sprite>(i);
+		PhysicsData* physics   = view.get<PhysicsData>(i);
+		transform->position += physics->velocity * context->delta;
+		sum += transform->position.y + sprite->pivot.y;
+	}
+	ctx_bench.sink += sum;
+}
+
+static void bench_system_tagged(SDLContext* context, ITU_EntityId* entity_ids, int entity_ids_count)
+{
+	itu_view<Transform> view(entity_ids, entity_ids_count);
+	float sum = 0;
+	for(int i = 0; i < view.count; ++i)
+		sum += view.get<Transform>(i)->rotation;
+	ctx_bench.sink += sum;
+}
+
+static int bench_compare_transform_x(const void* a, const void* b)
+{
+	float xa = ((const Transform*)a)->position.x;
+	float xb = ((const Transform*)b)->position.x;
+	return (xa > xb) - (xa < xb);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// setup
+
+// every entity gets Transform and Sprite. One every `physics_every` also gets PhysicsData, one every `tag_every` is tagged
+// (0 for none)
+static void bench_world_populate(int entities_count, int physics_every, int tag_every)
+{
+	itu_sys_estorage_clear_all_entities();
+	stbds_arrsetlen(ctx_bench.entities, 0);
+	ctx_bench.rng_state = 0x9E3779B9;
+
+	for(int i = 0; i < entities_count; ++i)
+	{
+		ITU_EntityId id = itu_entity_create();
+		Transform transform = TRANSFORM_DEFAULT;
+		transform.position = vec2f { (float)(bench_rand() % 1024), (float)(bench_rand() % 1024) };
+		Sprite sprite = { };
+		sprite.pivot = vec2f { 0.5f, 0.5f };
+		entity_add_component(id, Transform, transform);
+		entity_add_component(id, Sprite, sprite);
+		if(physics_every && i % physics_every == 0)
+		{
+			PhysicsData physics = { };
+			physics.velocity = vec2f { 1, 1 };
+			entity_add_component(id, PhysicsData, physics);
+		}
+		if(tag_every && i % tag_every == 0)
+			itu_entity_tag_add(id, BENCH_TAG);
+		stbds_arrput(ctx_bench.entities, id);
+	}
+}
+
+static void bench_systems_set(ITU_SystemDef* systems, int systems_count)
+{
+	itu_sys_estorage_set_systems(systems, systems_count);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// trials
+
+static void bench_result_begin(BenchResult* result, const char* name, int entities_count, int ops_count)
+{
+	result->name = name;
+	result->entities_count = entities_count;
+	result->ops_count = ops_count;
+	result->min = (Uint64)-1;
+	result->max = 0;
+	result->avg = 0;
+}
+
+static void bench_result_sample(BenchResult* result, Uint64 elapsed)
+{
+	result->min = SDL_min(result->min, elapsed);
+	result->max = SDL_max(result->max, elapsed);
+	result->avg += elapsed;
+}
+
+static void bench_result_end(BenchResult* result)
+{
+	result->avg /= NUM_TRIALS;
+	stbds_arrput(ctx_bench.results, *result);
+}
+
+static void bench_systems_update(const char* name, int entities_count, int ops_count)
+{
+	BenchResult result;
+	bench_result_begin(&result, name, entities_count, ops_count);
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		// a new frame for the per-system stats every trial
+		ctx_bench.context.uptime += ctx_bench.context.delta;
+
+		Uint64 time_beg = SDL_GetTicksNS();
+		itu_sys_estorage_systems_update(&ctx_bench.context);
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+	}
+	bench_result_end(&result);
+}
+
+// destroys a quarter of the entities (spread across the whole range) and creates them again
+static void bench_create_destroy(int entities_count)
+{
+	bench_systems_set(NULL, 0);
+	bench_world_populate(entities_count, 0, 0);
+
+	int ops_count = entities_count / 4;
+	BenchResult result;
+	bench_result_begin(&result, "create_destroy", entities_count, ops_count);
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		Uint64 time_beg = SDL_GetTicksNS();
+		for(int i = k % 4; i < entities_count; i += 4)
+			itu_entity_destroy(ctx_bench.entities[i]);
+		for(int i = k % 4; i < entities_count; i += 4)
+		{
+			ITU_EntityId id = itu_entity_create();
+			Transform transform = TRANSFORM_DEFAULT;
+			Sprite sprite = { };
+			entity_add_component(id, Transform, transform);
+			entity_add_component(id, Sprite, sprite);
+			ctx_bench.entities[i] = id;
+		}
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+	}
+	bench_result_end(&result);
+}
+
+// destroys a quarter of the entities through `itu_entity_destroy_batch` (only the destruction is timed)
+static void bench_destroy_batch(int entities_count)
+{
+	bench_systems_set(NULL, 0);
+	bench_world_populate(entities_count, 0, 0);
+
+	int ops_count = entities_count / 4;
+	ITU_EntityId* batch = (ITU_EntityId*)SDL_malloc(sizeof(ITU_EntityId) * (ops_count + 1));
+	BenchResult result;
+	bench_result_begin(&result, "destroy_batch", entities_count, ops_count);
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		int batch_count = 0;
+		for(int i = k % 4; i < entities_count; i += 4)
+			batch[batch_count++] = ctx_bench.entities[i];
+
+		Uint64 time_beg = SDL_GetTicksNS();
+		itu_entity_destroy_batch(batch, batch_count);
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+
+		for(int i = k % 4; i < entities_count; i += 4)
+		{
+			ITU_EntityId id = itu_entity_create();
+			Transform transform = TRANSFORM_DEFAULT;
+			Sprite sprite = { };
+			entity_add_component(id, Transform, transform);
+			entity_add_component(id, Sprite, sprite);
+			ctx_bench.entities[i] = id;
+		}
+	}
+	bench_result_end(&result);
+	SDL_free(batch);
+}
+
+// adds PhysicsData to half of the entities, then removes it again
+static void bench_component_add_remove(int entities_count)
+{
+	// with a system matching, so that membership updates are part of the cost
+	ITU_SystemDef systems[] = { { "bench_system_join3", bench_system_join3, component_mask(Transform) | component_mask(Sprite) | component_mask(PhysicsData), 0 } };
+	bench_systems_set(systems, array_count(systems));
+	bench_world_populate(entities_count, 0, 0);
+
+	int ops_count = entities_count / 2 * 2;
+	BenchResult result;
+	bench_result_begin(&result, "component_add_remove", entities_count, ops_count);
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		Uint64 time_beg = SDL_GetTicksNS();
+		PhysicsData physics = { };
+		for(int i = k % 2; i < entities_count; i += 2)
+			entity_add_component(ctx_bench.entities[i], PhysicsData, physics);
+		for(int i = k % 2; i < entities_count; i += 2)
+			itu_entity_component_remove(ctx_bench.entities[i], ITU_COMPONENT_TYPE_PhysicsData);
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+	}
+	bench_result_end(&result);
+}
+
+static void bench_join2(int entities_count)
+{
+	ITU_SystemDef systems[] = { { "bench_system_join2", bench_system_join2, component_mask(Transform) | component_mask(Sprite), 0, component_mask(Sprite), component_mask(Transform) } };
+	bench_systems_set(systems, array_count(systems));
+	bench_world_populate(entities_count, 2, 0);
+	bench_systems_update("join2", entities_count, entities_count);
+}
+
+static void bench_join3(int entities_count)
+{
+	ITU_SystemDef systems[] = { { "bench_system_join3", bench_system_join3, component_mask(Transform) | component_mask(Sprite) | component_mask(PhysicsData), 0, component_mask(Sprite) | component_mask(PhysicsData), component_mask(Transform) } };
+	bench_systems_set(systems, array_count(systems));
+	bench_world_populate(entities_count, 2, 0);
+	bench_systems_update("join3", entities_count, (entities_count + 1) / 2);
+}
+
+static void bench_tag_filter(int entities_count)
+{
+	ITU_SystemDef systems[] = { { "bench_system_tagged", bench_system_tagged, component_mask(Transform), tag_mask(BENCH_TAG), component_mask(Transform), 0 } };
+	bench_systems_set(systems, array_count(systems));
+	bench_world_populate(entities_count, 0, 8);
+	bench_systems_update("tag_filter", entities_count, (entities_count + 7) / 8);
+}
+
+// sorts Transform by x, after scrambling it again every trial
+static void bench_sort_data(int entities_count)
+{
+	bench_systems_set(NULL, 0);
+	bench_world_populate(entities_count, 0, 0);
+
+	BenchResult result;
+	bench_result_begin(&result, "sort_data", entities_count, entities_count);
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		for(int i = 0; i < entities_count; ++i)
+			(entity_get_data(ctx_bench.entities[i], Transform))->position.x = (float)(bench_rand() % 1024);
+
+		Uint64 time_beg = SDL_GetTicksNS();
+		itu_sys_estorage_component_sort_data(ITU_COMPONENT_TYPE_Transform, bench_compare_transform_x);
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+	}
+	bench_result_end(&result);
+}
+
+// moves 1% of the entities every frame, then takes a rollback snapshot (only the snapshot is timed)
+static void bench_rollback_save(int entities_count)
+{
+	bench_systems_set(NULL, 0);
+	bench_world_populate(entities_count, 0, 0);
+	itu_sys_estorage_rollback_init(NUM_TRIALS + 1);
+	itu_sys_estorage_rollback_save();
+
+	int ops_count = SDL_max(entities_count / 100, 1);
+	BenchResult result;
+	bench_result_begin(&result, "rollback_save", entities_count, ops_count);
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		for(int i = 0; i < ops_count; ++i)
+			(entity_get_data(ctx_bench.entities[bench_rand() % entities_count], Transform))->position.x += 1.0f;
+
+		Uint64 time_beg = SDL_GetTicksNS();
+		itu_sys_estorage_rollback_save();
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+	}
+	bench_result_end(&result);
+	itu_sys_estorage_rollback_init(0);
+}
+
+// moves 1% of the entities and destroys 0.1% of them, then rolls back to the previous frame (only the restore is timed)
+static void bench_rollback_restore(int entities_count)
+{
+	bench_systems_set(NULL, 0);
+	bench_world_populate(entities_count, 0, 0);
+	itu_sys_estorage_rollback_init(2);
+	int frame = itu_sys_estorage_rollback_save();
+
+	int ops_count = SDL_max(entities_count / 100, 1);
+	BenchResult result;
+	bench_result_begin(&result, "rollback_restore", entities_count, ops_count);
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		for(int i = 0; i < ops_count; ++i)
+			(entity_get_data(ctx_bench.entities[bench_rand() % entities_count], Transform))->position.x += 1.0f;
+		for(int i = 0; i < ops_count / 10; ++i)
+		{
+			ITU_EntityId id = ctx_bench.entities[bench_rand() % entities_count];
+			if(itu_entity_is_valid(id))
+				itu_entity_destroy(id);
+		}
+
+		Uint64 time_beg = SDL_GetTicksNS();
+		itu_sys_estorage_rollback_restore(frame);
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+	}
+	bench_result_end(&result);
+	itu_sys_estorage_rollback_init(0);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// output
+
+static void bench_write_json(FILE* out, bool archetype, bool group)
+{
+	fprintf(out, "{\n");
+	fprintf(out, "\t\"benchmark\": \"ecs\",\n");
+	fprintf(out, "\t\"storage_mode\": \"%s\",\n", archetype ? "archetype" : "sparse_set");
+	fprintf(out, "\t\"group\": %s,\n", group ? "true" : "false");
+	fprintf(out, "\t\"trials\": %d,\n", NUM_TRIALS);
+	fprintf(out, "\t\"results\": [\n");
+	for(int i = 0; i < stbds_arrlen(ctx_bench.results); ++i)
+	{
+		BenchResult* result = &ctx_bench.results[i];
+		fprintf(out,
+			"\t\t{ \"name\": \"%s\", \"entities\": %d, \"ops\": %d, \"min_ns\": %llu, \"avg_ns\": %llu, \"max_ns\": %llu, \"avg_ns_per_op\": %.3f }%s\n",
+			result->name, result->entities_count, result->ops_count,
+			(unsigned long long)result->min, (unsigned long long)result->avg, (unsigned long long)result->max,
+			result->ops_count ? (double)result->avg / result->ops_count : 0.0,
+			i + 1 < stbds_arrlen(ctx_bench.results) ? "," : ""
+		);
+	}
+	fprintf(out, "\t]\n");
+	fprintf(out, "}\n");
+}
+
+int main(int argc, char** argv)
+{
+	bool archetype = false;
+	bool group = false;
+	const char* path_out = NULL;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(SDL_strcmp(argv[i], "--archetype") == 0)
+			archetype = true;
+		else if(SDL_strcmp(argv[i], "--group") == 0)
+			group = true;
+		else if(SDL_strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			path_out = argv[++i];
+		else
+		{
+			fprintf(stderr, "usage: %s [--archetype] [--group] [--out results.json]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if(archetype)
+		itu_sys_estorage_set_storage_mode(ITU_ENTITY_STORAGE_MODE_ARCHETYPE);
+	itu_sys_estorage_init(1024, true);
+	itu_sys_estorage_tag_enable_members(BENCH_TAG);
+	if(group && itu_sys_estorage_group_add(component_mask(Transform) | component_mask(Sprite)) == -1)
+		return 1;
+
+	ctx_bench.context.delta = 1.0f / 60.0f;
+
+	int sizes[] = { 1000, 16 * 1024, 256 * 1024, 1024 * 1024 };
+	for(int s = 0; s < (int)array_count(sizes); ++s)
+	{
+		int entities_count = sizes[s];
+		fprintf(stderr, "running %d entities...\n", entities_count);
+
+		bench_create_destroy(entities_count);
+		bench_destroy_batch(entities_count);
+		bench_component_add_remove(entities_count);
+		bench_join2(entities_count);
+		bench_join3(entities_count);
+		bench_tag_filter(entities_count);
+		bench_sort_data(entities_count);
+		// NOTE: rollback is not supported in archetype mode
+		if(!archetype)
+		{
+			bench_rollback_save(entities_count);
+			bench_rollback_restore(entities_count);
+		}
+	}
+
+	FILE* out = stdout;
+	if(path_out)
+	{
+		out = fopen(path_out, "w");
+		if(!out)
+		{
+			fprintf(stderr, "could not open %s\n", path_out);
+			return 1;
+		}
+	}
+	bench_write_json(out, archetype, group);
+	if(out != stdout)
+		fclose(out);
+
+	// keeps `sink` alive
+	fprintf(stderr, "done (%f)\n", ctx_bench.sink);
+	return 0;
+}
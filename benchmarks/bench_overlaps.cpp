@@ -0,0 +1,401 @@
+// headless benchmarks for the batch tests in `itu_lib_overlaps`
+// every batch test is compared against the per-pair path it replaces: single-pair tests called in a loop over an array
+// of entity-like structs (array of structures), like ES02 does. Batch tests run once for every instruction set the CPU
+// supports (see `itu_lib_overlaps_simd_set`).
+// Results are written as JSON (stdout, or the file passed with `--out`), same format as `bench_ecs` plus the `variant` field.
+//
+// usage: bench_overlaps [--out results.json]
+//
+// - `circle_vs_n`/`rect_vs_n`: one shape against all shapes, `QUERIES_COUNT` times per trial
+// - `circles_n_vs_n`: all pairs inside groups of `entities` shapes (ie, the content of a broadphase cell), over
+//   `GROUPS_SHAPES_COUNT` shapes in total
+
+#define TEXTURE_PIXELS_PER_UNIT 128
+#define CAMERA_PIXELS_PER_UNIT  32
+
+#include <itu_unity_include.hpp>
+
+#include <stdio.h>
+
+#define NUM_TRIALS 10
+
+#define WORLD_SIZE          1024.0f
+#define QUERIES_COUNT       64
+#define GROUPS_SHAPES_COUNT (64 * 1024)
+
+#define array_count(arr) (sizeof(arr) / sizeof(arr[0]))
+
+struct BenchResult
+{
+	const char* name;
+	const char* variant;
+	int entities_count;
+	int ops_count;
+	Uint64 min;
+	Uint64 max;
+	Uint64 avg;
+};
+
+// what the per-pair path iterates over, roughly the size of an entity in the exercises
+struct BenchEntity
+{
+	vec2f position;
+	vec2f collider_offset;
+	float collider_radius;
+	vec2f rect_min;
+	vec2f rect_max;
+	Uint32 flags;
+};
+
+struct BenchContext
+{
+	stbds_arr(BenchEntity) entities;
+
+	// same shapes, as structure of arrays
+	stbds_arr(float) centers_x;
+	stbds_arr(float) centers_y;
+	stbds_arr(float) radii;
+	stbds_arr(float) rects_min_x;
+	stbds_arr(float) rects_min_y;
+	stbds_arr(float) rects_max_x;
+	stbds_arr(float) rects_max_y;
+
+	stbds_arr(Uint64) mask;
+	stbds_arr(ITU_OverlapsPair) pairs;
+	stbds_arr(BenchResult) results;
+	Uint32 rng_state;
+
+	// written by every trial, so that loops can't be optimized away
+	int sink;
+};
+
+static BenchContext ctx_bench;
+
+static const char* bench_simd_names[] = { "scalar", "sse2", "avx2" };
+
+static Uint32 bench_rand()
+{
+	// xorshift32, deterministic across platforms
+	Uint32 x = ctx_bench.rng_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	ctx_bench.rng_state = x;
+	return x;
+}
+
+static float bench_randf()
+{
+	return (float)(bench_rand() & 0xFFFFFF) / (float)0x1000000;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// setup
+
+// `world_size` controls density: everything is between 1 and 4 units big
+static void bench_shapes_populate(int shapes_count, float world_size)
+{
+	ctx_bench.rng_state = 0x9E3779B9;
+	stbds_arrsetlen(ctx_bench.entities, shapes_count);
+	stbds_arrsetlen(ctx_bench.centers_x, shapes_count);
+	stbds_arrsetlen(ctx_bench.centers_y, shapes_count);
+	stbds_arrsetlen(ctx_bench.radii, shapes_count);
+	stbds_arrsetlen(ctx_bench.rects_min_x, shapes_count);
+	stbds_arrsetlen(ctx_bench.rects_min_y, shapes_count);
+	stbds_arrsetlen(ctx_bench.rects_max_x, shapes_count);
+	stbds_arrsetlen(ctx_bench.rects_max_y, shapes_count);
+	stbds_arrsetlen(ctx_bench.mask, (shapes_count + 63) / 64);
+
+	for(int i = 0; i < shapes_count; ++i)
+	{
+		BenchEntity* entity = &ctx_bench.entities[i];
+		SDL_memset(entity, 0, sizeof(BenchEntity));
+		entity->position = vec2f { bench_randf(), bench_randf() } * world_size;
+		entity->collider_radius = 0.5f + bench_randf() * 1.5f;
+		entity->rect_min = entity->position - vec2f { entity->collider_radius, entity->collider_radius };
+		entity->rect_max = entity->position + vec2f { entity->collider_radius, entity->collider_radius } * 2.0f;
+
+		ctx_bench.centers_x[i] = entity->position.x + entity->collider_offset.x;
+		ctx_bench.centers_y[i] = entity->position.y + entity->collider_offset.y;
+		ctx_bench.radii[i] = entity->collider_radius;
+		ctx_bench.rects_min_x[i] = entity->rect_min.x;
+		ctx_bench.rects_min_y[i] = entity->rect_min.y;
+		ctx_bench.rects_max_x[i] = entity->rect_max.x;
+		ctx_bench.rects_max_y[i] = entity->rect_max.y;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// trials
+
+static void bench_result_begin(BenchResult* result, const char* name, const char* variant, int entities_count, int ops_count)
+{
+	result->name = name;
+	result->variant = variant;
+	result->entities_count = entities_count;
+	result->ops_count = ops_count;
+	result->min = (Uint64)-1;
+	result->max = 0;
+	result->avg = 0;
+}
+
+static void bench_result_sample(BenchResult* result, Uint64 elapsed)
+{
+	result->min = SDL_min(result->min, elapsed);
+	result->max = SDL_max(result->max, elapsed);
+	result->avg += elapsed;
+}
+
+static void bench_result_end(BenchResult* result)
+{
+	result->avg /= NUM_TRIALS;
+	stbds_arrput(ctx_bench.results, *result);
+}
+
+// sets the instruction set for batch tests, false if the CPU doesn't support it
+static bool bench_simd_set(int simd)
+{
+	itu_lib_overlaps_simd_set((ITU_OverlapsSimd)simd);
+	return itu_lib_overlaps_simd_get() == (ITU_OverlapsSimd)simd;
+}
+
+// the query shape of query `q`, the same for all variants
+static vec2f bench_query_position(int q)
+{
+	return ctx_bench.entities[(q * 7919) % stbds_arrlen(ctx_bench.entities)].position;
+}
+
+static void bench_circle_vs_n(int shapes_count)
+{
+	bench_shapes_populate(shapes_count, WORLD_SIZE);
+	int ops_count = shapes_count * QUERIES_COUNT;
+
+	BenchResult result;
+	bench_result_begin(&result, "circle_vs_n", "per_pair", shapes_count, ops_count);
+	int hits_expected = 0;
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		int hits = 0;
+		Uint64 time_beg = SDL_GetTicksNS();
+		for(int q = 0; q < QUERIES_COUNT; ++q)
+		{
+			vec2f center = bench_query_position(q);
+			for(int i = 0; i < shapes_count; ++i)
+			{
+				BenchEntity* entity = &ctx_bench.entities[i];
+				bool overlap = itu_lib_overlaps_circle_circle(center, 8.0f, entity->position + entity->collider_offset, entity->collider_radius);
+				if(i % 64 == 0)
+					ctx_bench.mask[i / 64] = 0;
+				ctx_bench.mask[i / 64] |= (Uint64)overlap << (i % 64);
+				hits += overlap;
+			}
+		}
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+		hits_expected = hits;
+	}
+	bench_result_end(&result);
+	ctx_bench.sink += hits_expected;
+
+	for(int simd = 0; simd < (int)array_count(bench_simd_names); ++simd)
+	{
+		if(!bench_simd_set(simd))
+			continue;
+
+		bench_result_begin(&result, "circle_vs_n", bench_simd_names[simd], shapes_count, ops_count);
+		for(int k = 0; k < NUM_TRIALS; ++k)
+		{
+			int hits = 0;
+			Uint64 time_beg = SDL_GetTicksNS();
+			for(int q = 0; q < QUERIES_COUNT; ++q)
+				hits += itu_lib_overlaps_circle_circles(bench_query_position(q), 8.0f, ctx_bench.centers_x, ctx_bench.centers_y, ctx_bench.radii, shapes_count, ctx_bench.mask);
+			bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+			SDL_assert(hits == hits_expected);
+		}
+		bench_result_end(&result);
+	}
+}
+
+static void bench_rect_vs_n(int shapes_count)
+{
+	bench_shapes_populate(shapes_count, WORLD_SIZE);
+	int ops_count = shapes_count * QUERIES_COUNT;
+
+	BenchResult result;
+	bench_result_begin(&result, "rect_vs_n", "per_pair", shapes_count, ops_count);
+	int hits_expected = 0;
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		int hits = 0;
+		Uint64 time_beg = SDL_GetTicksNS();
+		for(int q = 0; q < QUERIES_COUNT; ++q)
+		{
+			vec2f rect_min = bench_query_position(q);
+			vec2f rect_max = rect_min + vec2f { 16, 16 };
+			for(int i = 0; i < shapes_count; ++i)
+			{
+				BenchEntity* entity = &ctx_bench.entities[i];
+				bool overlap = itu_lib_overlaps_rect_rect(rect_min, rect_max, entity->rect_min, entity->rect_max);
+				if(i % 64 == 0)
+					ctx_bench.mask[i / 64] = 0;
+				ctx_bench.mask[i / 64] |= (Uint64)overlap << (i % 64);
+				hits += overlap;
+			}
+		}
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+		hits_expected = hits;
+	}
+	bench_result_end(&result);
+	ctx_bench.sink += hits_expected;
+
+	for(int simd = 0; simd < (int)array_count(bench_simd_names); ++simd)
+	{
+		if(!bench_simd_set(simd))
+			continue;
+
+		bench_result_begin(&result, "rect_vs_n", bench_simd_names[simd], shapes_count, ops_count);
+		for(int k = 0; k < NUM_TRIALS; ++k)
+		{
+			int hits = 0;
+			Uint64 time_beg = SDL_GetTicksNS();
+			for(int q = 0; q < QUERIES_COUNT; ++q)
+			{
+				vec2f rect_min = bench_query_position(q);
+				vec2f rect_max = rect_min + vec2f { 16, 16 };
+				hits += itu_lib_overlaps_rect_rects(rect_min, rect_max, ctx_bench.rects_min_x, ctx_bench.rects_min_y, ctx_bench.rects_max_x, ctx_bench.rects_max_y, shapes_count, ctx_bench.mask);
+			}
+			bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+			SDL_assert(hits == hits_expected);
+		}
+		bench_result_end(&result);
+	}
+}
+
+// `group_size` shapes packed in a small area, so that a good amount of them overlap (like a crowded broadphase cell)
+static void bench_circles_n_vs_n(int group_size)
+{
+	int groups_count = GROUPS_SHAPES_COUNT / group_size;
+	bench_shapes_populate(GROUPS_SHAPES_COUNT, SDL_sqrtf((float)group_size) * 2.0f);
+	int ops_count = groups_count * group_size * (group_size - 1) / 2;
+	int pairs_max = group_size * group_size;
+	stbds_arrsetlen(ctx_bench.pairs, pairs_max);
+
+	BenchResult result;
+	bench_result_begin(&result, "circles_n_vs_n", "per_pair", group_size, ops_count);
+	int pairs_expected = 0;
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		int pairs_total = 0;
+		Uint64 time_beg = SDL_GetTicksNS();
+		for(int g = 0; g < groups_count; ++g)
+		{
+			BenchEntity* group = &ctx_bench.entities[g * group_size];
+			int pairs_count = 0;
+			for(int i = 0; i < group_size - 1; ++i)
+				for(int j = i + 1; j < group_size; ++j)
+					if(itu_lib_overlaps_circle_circle(group[i].position + group[i].collider_offset, group[i].collider_radius, group[j].position + group[j].collider_offset, group[j].collider_radius))
+					{
+						ctx_bench.pairs[pairs_count].index_a = i;
+						ctx_bench.pairs[pairs_count].index_b = j;
+						++pairs_count;
+					}
+			pairs_total += pairs_count;
+		}
+		bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+		pairs_expected = pairs_total;
+	}
+	bench_result_end(&result);
+	ctx_bench.sink += pairs_expected;
+
+	for(int simd = 0; simd < (int)array_count(bench_simd_names); ++simd)
+	{
+		if(!bench_simd_set(simd))
+			continue;
+
+		bench_result_begin(&result, "circles_n_vs_n", bench_simd_names[simd], group_size, ops_count);
+		for(int k = 0; k < NUM_TRIALS; ++k)
+		{
+			int pairs_total = 0;
+			Uint64 time_beg = SDL_GetTicksNS();
+			for(int g = 0; g < groups_count; ++g)
+			{
+				int first = g * group_size;
+				pairs_total += itu_lib_overlaps_circles_circles(ctx_bench.centers_x + first, ctx_bench.centers_y + first, ctx_bench.radii + first, group_size, ctx_bench.pairs, pairs_max);
+			}
+			bench_result_sample(&result, SDL_GetTicksNS() - time_beg);
+			SDL_assert(pairs_total == pairs_expected);
+		}
+		bench_result_end(&result);
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// output
+
+static void bench_write_json(FILE* out)
+{
+	fprintf(out, "{\n");
+	fprintf(out, "\t\"benchmark\": \"overlaps\",\n");
+	fprintf(out, "\t\"trials\": %d,\n", NUM_TRIALS);
+	fprintf(out, "\t\"results\": [\n");
+	for(int i = 0; i < stbds_arrlen(ctx_bench.results); ++i)
+	{
+		BenchResult* result = &ctx_bench.results[i];
+		fprintf(out,
+			"\t\t{ \"name\": \"%s\", \"variant\": \"%s\", \"entities\": %d, \"ops\": %d, \"min_ns\": %llu, \"avg_ns\": %llu, \"max_ns\": %llu, \"avg_ns_per_op\": %.3f }%s\n",
+			result->name, result->variant, result->entities_count, result->ops_count,
+			(unsigned long long)result->min, (unsigned long long)result->avg, (unsigned long long)result->max,
+			result->ops_count ? (double)result->avg / result->ops_count : 0.0,
+			i + 1 < stbds_arrlen(ctx_bench.results) ? "," : ""
+		);
+	}
+	fprintf(out, "\t]\n");
+	fprintf(out, "}\n");
+}
+
+int main(int argc, char** argv)
+{
+	const char* path_out = NULL;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(SDL_strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			path_out = argv[++i];
+		else
+		{
+			fprintf(stderr, "usage: %s [--out results.json]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	int sizes[] = { 1000, 16 * 1024, 256 * 1024 };
+	for(int s = 0; s < (int)array_count(sizes); ++s)
+	{
+		fprintf(stderr, "running %d shapes...\n", sizes[s]);
+		bench_circle_vs_n(sizes[s]);
+		bench_rect_vs_n(sizes[s]);
+	}
+
+	int group_sizes[] = { 8, 32, 128 };
+	for(int s = 0; s < (int)array_count(group_sizes); ++s)
+	{
+		fprintf(stderr, "running groups of %d shapes...\n", group_sizes[s]);
+		bench_circles_n_vs_n(group_sizes[s]);
+	}
+
+	FILE* out = stdout;
+	if(path_out)
+	{
+		out = fopen(path_out, "w");
+		if(!out)
+		{
+			fprintf(stderr, "could not open %s\n", path_out);
+			return 1;
+		}
+	}
+	bench_write_json(out);
+	if(out != stdout)
+		fclose(out);
+
+	// keeps `sink` alive
+	fprintf(stderr, "done (%d)\n", ctx_bench.sink);
+	return 0;
+}
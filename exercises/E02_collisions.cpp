@@ -1,4 +1,5 @@
 #define STB_IMAGE_IMPLEMENTATION
+#define ITU_LIB_ARENA_IMPLEMENTATION
 #define ITU_LIB_ENGINE_IMPLEMENTATION
 #define ITU_LIB_RENDER_IMPLEMENTATION
 #define ITU_LIB_OVERLAPS_IMPLEMENTATION
@@ -1,13 +1,16 @@
 #define STB_IMAGE_IMPLEMENTATION
+#define ITU_LIB_ARENA_IMPLEMENTATION
 #define ITU_LIB_ENGINE_IMPLEMENTATION
 #define ITU_LIB_RENDER_IMPLEMENTATION
 #define ITU_LIB_OVERLAPS_IMPLEMENTATION
+#define ITU_LIB_BROADPHASE_IMPLEMENTATION
 
 #include <SDL3/SDL.h>
 
 #include <itu_common.hpp>
 #include <itu_lib_render.hpp>
 #include <itu_lib_overlaps.hpp>
+#include <itu_lib_broadphase.hpp>
 
 #define ENABLE_DIAGNOSTICS
 
@@ -25,20 +28,21 @@
 // - world partition,  4 cells (all dynamic)    ~2500       16   ms/f
 // - world partition, 16 cells (all dynamic)    ~3000       16   ms/f
 // - world partition, 64 cells (all dynamic)    ~4000       16   ms/f
+// - uniform grid broadphase (all dynamic)     100000       15   ms/f (broadphase alone, `benchmarks/bench_broadphase.cpp`, different machine)
 // 
 #define ENTITY_COUNT 1600
 
 #define MAX_COLLISIONS (ENTITY_COUNT * 6)   // num max collisions per frame
 
-#define WORLD_PARTITION_CELL_SPLITS 8
-
-// NOTE: this is actually an interesting design choice: how many entities can exist in a single cell *at the same time*
-//       In the worst case, all entities are in the same cell, and as unlikely as that this can we affort to do less?
-//       Maybe, but finding a reasonable number that you can enforce efficiently is not trivial, and this is why this "fixed split"
-//       method is never used in real-world application, and more refined algorithms exist.
-#define WORLD_PARTITION_CELL_MAX_ENTITY_COUNT   (ENTITY_COUNT)
+// NOTE: the old fixed world partition (8x8 cells covering the window) had two problems: every cell had room for all
+//       entities (since in the worst case they all end up in the same one), and pairs sharing more than one cell
+//       were tested (and separated!) more than once. The grid in `itu_lib_broadphase` is unbounded, stores every
+//       entity only in the cells it touches, and reports each pair once
+#define BROADPHASE_CELL_SIZE 16             // about twice the size of a collider
+#define MAX_BROADPHASE_PAIRS (ENTITY_COUNT * 8) // AABB pairs, more than the actual collisions
 
 
+bool DEBUG_use_broadphase        = true;
 bool DEBUG_separate_collisions   = true;
 bool DEBUG_render_colliders      = true;
 bool DEBUG_render_texture_border = false;
@@ -46,7 +50,6 @@ bool DEBUG_render_texture        = false;
 
 struct Entity;
 struct EntityCollisionInfo;
-struct WorldPartitionCell;
 
 struct MySDLContext
 {
@@ -80,9 +83,10 @@ struct GameState
 	EntityCollisionInfo* frame_collisions;
 	int frame_collisions_count;
 
-	WorldPartitionCell* world_partition_cells;
-	int                 world_partition_cells_count;
-	vec2f               world_partition_cell_size;
+	// proxy `i` is always entity `i` (see `game_reset`)
+	ITU_Broadphase      broadphase;
+	ITU_BroadphasePair* broadphase_pairs;
+	int                 broadphase_pairs_count;
 
 	// SDL-allocated structures
 	SDL_Texture* atlas;
@@ -183,114 +187,36 @@ static void entity_destroy(GameState* state, Entity* entity)
 
 
 // ********************************************************************************************************************
-// world partition
+// broadphase
 // ********************************************************************************************************************
 
-struct WorldPartitionCell
+static void broadphase_entity_aabb(Entity* entity, vec2f* out_min, vec2f* out_max)
 {
-	// NOTE: this is an array of pointers
-	Entity** entity_refs;
-	int      entity_refs_counts;
-
-	vec2f min;
-	vec2f max;
-};
+	vec2f center = entity->position + entity->collider_offset;
+	vec2f extents = vec2f{ entity->collider_radius, entity->collider_radius };
+	*out_min = center - extents;
+	*out_max = center + extents;
+}
 
-// fancy debug visualization for an incredibly simple world partition
-// the code is a mess tho, we will try to make it better when we talk about UIs
-static void world_partition_debug_cells(MySDLContext* context, GameState* state)
+// grid lines over the window, plus some stats
+static void broadphase_debug_render(MySDLContext* context, GameState* state)
 {
-	// render cell boundaries
-	SDL_SetRenderDrawColor(context->renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-	for(int i = 0; i < state->world_partition_cells_count; ++i)
-	{
-		WorldPartitionCell* cell = &state->world_partition_cells[i];
-		SDL_FRect rect = { cell->min.x, cell->min.y, state->world_partition_cell_size.x, state->world_partition_cell_size.y };
-		SDL_RenderRect(context->renderer, &rect);
+	ITU_Broadphase* broadphase = &state->broadphase;
 
-	}
+	SDL_SetRenderDrawColor(context->renderer, 0xFF, 0xFF, 0xFF, 0x20);
+	for(float x = 0; x < context->window_w; x += broadphase->cell_size)
+		SDL_RenderLine(context->renderer, x, 0, x, context->window_h);
+	for(float y = 0; y < context->window_h; y += broadphase->cell_size)
+		SDL_RenderLine(context->renderer, 0, y, context->window_w, y);
 
-	// render cell debug info
 	SDL_SetRenderDrawColor(context->renderer, 0x0, 0x00, 0x00, 0xCC);
-	SDL_FRect rect = SDL_FRect{ 250, 5, 230 + 225, state->world_partition_cells_count * 10.0f + 35.0f };
+	SDL_FRect rect = SDL_FRect{ 250, 5, 230, 45 };
 	SDL_RenderFillRect(context->renderer, &rect);
-	
-	SDL_SetRenderDrawColor(context->renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-	SDL_RenderDebugText(context->renderer, 255, 10, "cell   entities   rect min          rect max");
-	SDL_RenderLine(context->renderer, 255, 20, 250+230 + 220, 20);
 
-	float base_text_render_y = 40;
-	int entity_refs_total = 0;
-	for(int i = 0; i < state->world_partition_cells_count; ++i)
-	{
-		WorldPartitionCell* cell = &state->world_partition_cells[i];
-		entity_refs_total += cell->entity_refs_counts;
-		SDL_RenderDebugTextFormat(
-			context->renderer, 255, base_text_render_y + 10 * i,
-			"%4d   %4d       (%6.1f, %6.1f)   (%6.1f,  %6.1f)",
-			i, cell->entity_refs_counts, cell->min.x, cell->min.y, cell->max.x, cell->max.y
-		);
-	}
-	SDL_RenderDebugTextFormat(
-		context->renderer, 255, base_text_render_y -15,
-		" tot   %4d",
-		entity_refs_total
-	);
-	SDL_RenderLine(context->renderer, 255, base_text_render_y-5, 250+230 + 220, base_text_render_y + -5);
-}
-
-static void world_partition_cell_add_entity(Entity* entity, WorldPartitionCell* cell)
-{
-	SDL_assert(cell->entity_refs_counts < WORLD_PARTITION_CELL_MAX_ENTITY_COUNT);
-	cell->entity_refs[cell->entity_refs_counts] = entity;
-	cell->entity_refs_counts++;
-}
-
-// (overly) simple world partition logic, just split the world in 4 quadrant
-static void world_partition_assign_entity_to_cell(Entity* entity, GameState* state)
-{
-	vec2f p = entity->position + entity->collider_offset;
-
-	// get cell coordinates form collider center
-	int coord_x = SDL_clamp((int) p.x / state->world_partition_cell_size.x, 0, WORLD_PARTITION_CELL_SPLITS - 1);
-	int coord_y = SDL_clamp((int) p.y / state->world_partition_cell_size.y, 0, WORLD_PARTITION_CELL_SPLITS - 1);
-			
-	// get cell index from coordinates
-	int idx_center = coord_x + coord_y * WORLD_PARTITION_CELL_SPLITS;
-	SDL_assert(idx_center < state->world_partition_cells_count);
-	world_partition_cell_add_entity(entity, &state->world_partition_cells[idx_center]);
-
-	vec2f bounds[] = { p, p, p, p };
-	bounds[0].x += entity->collider_radius; 
-	bounds[1].y -= entity->collider_radius;
-	bounds[2].x -= entity->collider_radius;
-	bounds[3].y += entity->collider_radius;
-
-	for(int i = 0; i < 4; ++i)
-	{
-		vec2f p = bounds[i];
-		// get cell coordinates form entity extremes
-		int coord_x = SDL_clamp((int) p.x / state->world_partition_cell_size.x, 0, WORLD_PARTITION_CELL_SPLITS - 1);
-		int coord_y = SDL_clamp((int) p.y / state->world_partition_cell_size.y, 0, WORLD_PARTITION_CELL_SPLITS - 1);
-			
-		// get cell index from coordinates
-		int idx_bound = coord_x + coord_y * WORLD_PARTITION_CELL_SPLITS;
-		SDL_assert(idx_center < state->world_partition_cells_count);
-		if(idx_bound != idx_center)
-			world_partition_cell_add_entity(entity, &state->world_partition_cells[idx_bound]);
-	}
-}
-
-static void world_partition_assign_all_entitites(GameState* state)
-{
-	for(int i = 0; i < state->world_partition_cells_count; ++i)
-		state->world_partition_cells[i].entity_refs_counts = 0;
-
-	for(int i = 0; i < state->entities_alive_count; ++i)
-	{
-		Entity* entity = &state->entities[i];
-		world_partition_assign_entity_to_cell(entity, state);
-	}
+	SDL_SetRenderDrawColor(context->renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+	SDL_RenderDebugTextFormat(context->renderer, 255, 10, "proxies  : %d", broadphase->proxies_count - broadphase->proxies_free_count);
+	SDL_RenderDebugTextFormat(context->renderer, 255, 20, "entries  : %d (%d buckets)", broadphase->entries_count, broadphase->buckets_count);
+	SDL_RenderDebugTextFormat(context->renderer, 255, 30, "pairs    : %d", state->broadphase_pairs_count);
 }
 
 // ********************************************************************************************************************
@@ -306,64 +232,81 @@ struct EntityCollisionInfo
 	float separation;
 };
 
-static void collision_check_references(GameState* state, Entity** entity_refs, int entity_refs_count)
+// narrowphase on a single pair, returns false when there is no more room for collisions this frame
+static bool collision_check_pair(GameState* state, Entity* e1, Entity* e2)
 {
-	for(int i = 0; i < entity_refs_count - 1; ++i)
+	// `collision_separate` only moves e1 when e2 is static
+	if(e1->collider_is_static)
 	{
-		Entity* e1 = entity_refs[i];
+		if(e2->collider_is_static)
+			return true;
+		Entity* tmp = e1;
+		e1 = e2;
+		e2 = tmp;
+	}
 
-		if(e1->collider_is_static)
-			continue;
-		
-		for(int j = i + 1; j < entity_refs_count; ++j)
-		{
-			Entity* e2 = entity_refs[j];
+	// the manifold comes out of the same computation as the overlap test, no need to measure the distance again
+	ITU_OverlapsManifold manifold;
+	if(!itu_lib_overlaps_circle_circle_manifold(
+		e1->position + e1->collider_offset, e1->collider_radius,
+		e2->position + e2->collider_offset, e2->collider_radius,
+		&manifold
+	))
+		return true;
 
-			if(itu_lib_overlaps_circle_circle(
-				e1->position + e1->collider_offset, e1->collider_radius,
-				e2->position + e2->collider_offset, e2->collider_radius
-			))
-			{
-				// // epilepsy warning right there
-				// e1->sprite.tint = COLOR_RED;
-				// e2->sprite.tint = COLOR_RED;
+	// // epilepsy warning right there
+	// e1->sprite.tint = COLOR_RED;
+	// e2->sprite.tint = COLOR_RED;
 
-				if(state->frame_collisions_count >= MAX_COLLISIONS)
-				{
-					SDL_Log("[WARNING] too many collisions!");
-					return;
-				}
+	if(state->frame_collisions_count >= MAX_COLLISIONS)
+	{
+		SDL_Log("[WARNING] too many collisions!");
+		return false;
+	}
 
-				// NOTE: here we are redoing a bunch of work that we already done in the overlap test. An easy optimization is do to have the test return the collision info
-				vec2f v = (e2->position + e2->collider_offset) - (e1->position + e1->collider_offset);
-				float l = length(v);
-				float separation_vector = e1->collider_radius + e2->collider_radius - l;
-				int new_collision_idx = state->frame_collisions_count++;
+	int new_collision_idx = state->frame_collisions_count++;
 
-				state->frame_collisions[new_collision_idx].e1 = e1;
-				state->frame_collisions[new_collision_idx].e2 = e2;
-				state->frame_collisions[new_collision_idx].normal = v / l; // normalize vector (we already need the length, so we don't need to call normalize which would do that anyway)
-				state->frame_collisions[new_collision_idx].separation = separation_vector;
-			}
-		}
-	}
+	state->frame_collisions[new_collision_idx].e1 = e1;
+	state->frame_collisions[new_collision_idx].e2 = e2;
+	state->frame_collisions[new_collision_idx].normal = manifold.normal;
+	state->frame_collisions[new_collision_idx].separation = manifold.depth;
+	return true;
 }
+
 static void collision_check(GameState* state)
 {
 	state->frame_collisions_count = 0;
+	state->broadphase_pairs_count = 0;
 
-	if(state->world_partition_cells_count > 0)
+	if(DEBUG_use_broadphase)
 	{
-		// world partition
+		// NOTE: every entity moves every frame in this exercise, so we just move all proxies.
+		//       In a real game only things that actually moved would need to
+		for(int i = 0; i < state->entities_alive_count; ++i)
+		{
+			vec2f aabb_min, aabb_max;
+			broadphase_entity_aabb(&state->entities[i], &aabb_min, &aabb_max);
+			itu_lib_broadphase_move(&state->broadphase, i, aabb_min, aabb_max);
+		}
+		itu_lib_broadphase_update(&state->broadphase);
 
-		for(int i = 0; i < state->world_partition_cells_count; ++i)
+		int pairs_count = itu_lib_broadphase_pairs(&state->broadphase, state->broadphase_pairs, MAX_BROADPHASE_PAIRS);
+		if(pairs_count > MAX_BROADPHASE_PAIRS)
 		{
-			WorldPartitionCell* cell = &state->world_partition_cells[i];
+			SDL_Log("[WARNING] too many broadphase pairs! (%d)", pairs_count);
+			pairs_count = MAX_BROADPHASE_PAIRS;
+		}
+		state->broadphase_pairs_count = pairs_count;
 
-			collision_check_references(state, cell->entity_refs, cell->entity_refs_counts);
+		for(int i = 0; i < pairs_count; ++i)
+		{
+			ITU_BroadphasePair pair = state->broadphase_pairs[i];
+			if(!collision_check_pair(state, &state->entities[pair.user_id_a], &state->entities[pair.user_id_b]))
+				return;
 		}
 	}
-	else {
+	else
+	{
 		for(int i = 0; i < state->entities_alive_count - 1; ++i)
 		{
 			Entity* e1 = &state->entities[i];
@@ -371,32 +314,8 @@ static void collision_check(GameState* state)
 				continue;
 		
 			for(int j = i + 1; j < state->entities_alive_count; ++j)
-			{
-				Entity* e2 = &state->entities[j];
-
-				if(itu_lib_overlaps_circle_circle(
-					e1->position + e1->collider_offset, e1->collider_radius,
-					e2->position + e2->collider_offset, e2->collider_radius
-				))
-				{
-					if(state->frame_collisions_count >= MAX_COLLISIONS)
-					{
-						SDL_Log("[WARNING] too many collisions!");
-						return;
-					}
-
-					// NOTE: here we are redoing a bunch of work that we already done in the overlap test. An easy optimization is do to have the test return the collision info
-					vec2f v = (e2->position + e2->collider_offset) - (e1->position + e1->collider_offset);
-					float l = length(v);
-					float separation_vector = e1->collider_radius + e2->collider_radius - l;
-					int new_collision_idx = state->frame_collisions_count++;
-
-					state->frame_collisions[new_collision_idx].e1 = e1;
-					state->frame_collisions[new_collision_idx].e2 = e2;
-					state->frame_collisions[new_collision_idx].normal = v / l; // normalize vector (we already need the length, so we don't need to call normalize which would do that anyway)
-					state->frame_collisions[new_collision_idx].separation = separation_vector;
-				}
-			}
+				if(!collision_check_pair(state, e1, &state->entities[j]))
+					return;
 		}
 	}
 }
@@ -438,23 +357,10 @@ static void game_init(MySDLContext* context, GameState* state)
 	state->frame_collisions = (EntityCollisionInfo*)SDL_calloc(MAX_COLLISIONS, sizeof(EntityCollisionInfo));
 	SDL_assert(state->frame_collisions);
 
-	const int num_cells = 4;
-
-	// world partitioning data allocation
-	{
-		// we will split out game world in WORLD_PARTITION_CELL_SPLITS vertically and WORLD_PARTITION_CELL_SPLITS horizontally
-		state->world_partition_cells_count = WORLD_PARTITION_CELL_SPLITS * WORLD_PARTITION_CELL_SPLITS;
-
-		// allocate one integer for each cell (to know how many entities actually reside here)
-		state->world_partition_cells = (WorldPartitionCell*)SDL_calloc(state->world_partition_cells_count, sizeof(WorldPartitionCell));
+	state->broadphase_pairs = (ITU_BroadphasePair*)SDL_calloc(MAX_BROADPHASE_PAIRS, sizeof(ITU_BroadphasePair));
+	SDL_assert(state->broadphase_pairs);
 
-		// allocate actual array of references for the entities
-		for(int i = 0; i < state->world_partition_cells_count; ++i)
-		{
-			WorldPartitionCell* cell = &state->world_partition_cells[i];
-			cell->entity_refs = (Entity**)SDL_calloc(WORLD_PARTITION_CELL_MAX_ENTITY_COUNT, sizeof(Entity*));
-		}
-	}
+	itu_lib_broadphase_init(&state->broadphase, BROADPHASE_CELL_SIZE, ENTITY_COUNT);
 
 	// texture atlases
 	state->atlas = texture_create(context, "data/kenney/simpleSpace_tilesheet_2.png");
@@ -517,25 +423,18 @@ static void game_reset(MySDLContext* context, GameState* state)
 		}
 	}
 
-	// world partition
-	if(WORLD_PARTITION_CELL_SPLITS > 0)
+	// broadphase
+	// NOTE: entities are never destroyed during the game, so inserting them in order keeps proxy index == entity index
 	{
-		state->world_partition_cell_size.x = WINDOW_W / WORLD_PARTITION_CELL_SPLITS;
-		state->world_partition_cell_size.y = WINDOW_H / WORLD_PARTITION_CELL_SPLITS;
-		// initialize cells
-		for(int i = 0; i < state->world_partition_cells_count; ++i)
+		itu_lib_broadphase_clear(&state->broadphase);
+		for(int i = 0; i < state->entities_alive_count; ++i)
 		{
-			int cell_coord_x = i % WORLD_PARTITION_CELL_SPLITS;
-			int cell_coord_y = i / WORLD_PARTITION_CELL_SPLITS;
-
-			WorldPartitionCell* cell = &state->world_partition_cells[i];
-			cell->entity_refs_counts = 0;
-			cell->min.x = cell_coord_x * state->world_partition_cell_size.x;
-			cell->min.y = cell_coord_y * state->world_partition_cell_size.y;
-			cell->max.x = (cell_coord_x + 1) * state->world_partition_cell_size.x;
-			cell->max.y = (cell_coord_y + 1) * state->world_partition_cell_size.y;
+			Entity* entity = &state->entities[i];
+			vec2f aabb_min, aabb_max;
+			broadphase_entity_aabb(entity, &aabb_min, &aabb_max);
+			int proxy = itu_lib_broadphase_insert(&state->broadphase, aabb_min, aabb_max, i, entity->collider_is_static);
+			SDL_assert(proxy == i);
 		}
-		world_partition_assign_all_entitites(state);
 	}
 }
 
@@ -573,12 +472,6 @@ static void game_update(MySDLContext* context, GameState* state)
 	collision_check(state);
 	if(DEBUG_separate_collisions)
 		collision_separate(state);
-
-	// NOTE: here is where we would like to "update" our cells, checking if any Entity moved in or out of a cell
-	//       However, pointers make it really annoying to handle two-way references this way.
-	//       Surely, re-assigning every entity EVERY frame is a waste? We will discuss this next lecture
-	if(state->world_partition_cells_count > 0)
-		world_partition_assign_all_entitites(state);
 }
 
 static void game_render(MySDLContext* context, GameState* state)
@@ -601,10 +494,9 @@ static void game_render(MySDLContext* context, GameState* state)
 		}
 	}
 
-	// debug world partition
-	{
-		world_partition_debug_cells(context, state);
-	}
+	// debug broadphase
+	if(DEBUG_use_broadphase)
+		broadphase_debug_render(context, state);
 	// debug window
 	SDL_SetRenderDrawColor(context->renderer, 0xFF, 0x00, 0xFF, 0xff);
 	SDL_RenderRect(context->renderer, NULL);
@@ -684,6 +576,7 @@ int main(void)
 							case SDLK_F2: DEBUG_render_colliders      = !DEBUG_render_colliders;      break;
 							case SDLK_F3: DEBUG_render_texture_border = !DEBUG_render_texture_border; break;
 							case SDLK_F4: DEBUG_render_texture        = !DEBUG_render_texture;        break;
+							case SDLK_F5: DEBUG_use_broadphase        = !DEBUG_use_broadphase;        break;
 						}
 					}
 					break;
@@ -709,7 +602,7 @@ int main(void)
 #ifdef ENABLE_DIAGNOSTICS
 		{
 			SDL_SetRenderDrawColor(context.renderer, 0x0, 0x00, 0x00, 0xCC);
-			SDL_FRect rect = SDL_FRect{ 5, 5, 225, 85 };
+			SDL_FRect rect = SDL_FRect{ 5, 5, 225, 95 };
 			SDL_RenderFillRect(context.renderer, &rect);
 			SDL_SetRenderDrawColor(context.renderer, 0xFF, 0xFF, 0xFF, 0xFF);
 			SDL_RenderDebugTextFormat(context.renderer, 10, 10, "entities : %d", ENTITY_COUNT);
@@ -720,6 +613,7 @@ int main(void)
 			SDL_RenderDebugTextFormat(context.renderer, 10, 60, "[F2]  render colliders  %s", DEBUG_render_colliders      ? " ON" : "OFF");
 			SDL_RenderDebugTextFormat(context.renderer, 10, 70, "[F3]  render tex border %s", DEBUG_render_texture_border ? " ON" : "OFF");
 			SDL_RenderDebugTextFormat(context.renderer, 10, 80, "[F4]  render textures   %s", DEBUG_render_texture        ? " ON" : "OFF");
+			SDL_RenderDebugTextFormat(context.renderer, 10, 90, "[F5]  broadphase        %s", DEBUG_use_broadphase        ? " ON" : "OFF");
 		}
 #endif
 
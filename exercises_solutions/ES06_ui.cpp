@@ -524,38 +524,50 @@ static void game_reset(SDLContext* context, GameState* state)
 	}
 
 	// entities
-	for(int i = 0; i < ENTITY_COUNT; ++i)
 	{
-		ITU_EntityId id = itu_entity_create();
-		char name_buf[16];
-		SDL_snprintf(name_buf, 16, "asteroid_%d", i);
-		itu_entity_set_debug_name(id, name_buf);
-
-		Transform transform = { 0 };
-		Sprite sprite;
-
-		transform.scale = VEC2F_ONE;
-		transform.position.x = SDL_randf() * 16 - 8;
-		transform.position.y = SDL_randf() * 16 - 8;
+		ITU_Prefab prefab_asteroid = { 0 };
+		{
+			Transform transform = { 0 };
+			transform.scale = VEC2F_ONE;
 
-		itu_lib_sprite_init(&sprite, tex_space, itu_lib_sprite_get_rect(0, 4, 128, 128));
+			Sprite sprite;
+			itu_lib_sprite_init(&sprite, tex_space, itu_lib_sprite_get_rect(0, 4, 128, 128));
 
-		// FIXME this is thrash
-		PhysicsStaticData physics_data = { 0 };
-		body_def.position = value_cast(b2Vec2, transform.position);
-		body_def.type = b2_staticBody;
-		physics_data.body_id = itu_sys_physics_add_body(value_cast(void*, id), &body_def);
+			// NOTE: physics bodies are unique per entity, they are created after instantiating
+			PhysicsStaticData physics_data = { 0 };
+			ShapeData shape_data = { 0 };
 
-		
-		ShapeData shape_data;
-		shape_data.shape_id = b2CreateCircleShape(physics_data.body_id, &shape_def, &circle);
+			prefab_set_component(&prefab_asteroid, Transform,         transform);
+			prefab_set_component(&prefab_asteroid, Sprite,            sprite);
+			prefab_set_component(&prefab_asteroid, PhysicsStaticData, physics_data);
+			prefab_set_component(&prefab_asteroid, ShapeData,         shape_data);
+			itu_prefab_tag_add(&prefab_asteroid, TAG_ASTEROID);
+		}
 
-		entity_add_component(id, Transform,   transform);
-		entity_add_component(id, Sprite,      sprite);
-		entity_add_component(id, PhysicsStaticData, physics_data);
-		entity_add_component(id, ShapeData, shape_data);
-		itu_entity_tag_add(id, TAG_ASTEROID);
+		ITU_EntityId ids[ENTITY_COUNT];
+		itu_prefab_instantiate(&prefab_asteroid, ENTITY_COUNT, ids);
+		itu_prefab_free(&prefab_asteroid);
 
+		body_def.type = b2_staticBody;
+		for(int i = 0; i < ENTITY_COUNT; ++i)
+		{
+			ITU_EntityId id = ids[i];
+			char name_buf[16];
+			SDL_snprintf(name_buf, 16, "asteroid_%d", i);
+			itu_entity_set_debug_name(id, name_buf);
+
+			Transform* transform = entity_get_data(id, Transform);
+			transform->position.x = SDL_randf() * 16 - 8;
+			transform->position.y = SDL_randf() * 16 - 8;
+
+			// FIXME this is thrash
+			PhysicsStaticData* physics_data = entity_get_data(id, PhysicsStaticData);
+			body_def.position = value_cast(b2Vec2, transform->position);
+			physics_data->body_id = itu_sys_physics_add_body(value_cast(void*, id), &body_def);
+
+			ShapeData* shape_data = entity_get_data(id, ShapeData);
+			shape_data->shape_id = b2CreateCircleShape(physics_data->body_id, &shape_def, &circle);
+		}
 	}
 
 	// healtbar
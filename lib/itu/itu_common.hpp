@@ -85,6 +85,30 @@
 #define stbds_sm(TK, TV) struct { TK key; TV value; }*
 
 
+// *******************************************************************
+// bit manipulation
+// *******************************************************************
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// index of the lowest set bit ("count trailing zeros"). `x` must NOT be 0
+// to walk all set bits of a mask:
+//     for(Uint64 bits = mask; bits; bits &= bits - 1)
+//         int i = bit_index_lowest(bits);
+inline int bit_index_lowest(Uint64 x)
+{
+	SDL_assert(x);
+#ifdef _MSC_VER
+	unsigned long ret;
+	_BitScanForward64(&ret, x);
+	return (int)ret;
+#else
+	return __builtin_ctzll(x);
+#endif
+}
+
 
 
 // *******************************************************************
@@ -3,26 +3,83 @@
 #define PHYSICS_TIMESTEP_SECS   NS_TO_SECONDS(PHYSICS_TIMESTEP_NSECS)
 #define PHYSICS_MAX_TIMESTEPS_PER_FRAME 4
 #define PHYSICS_MAX_CONTACTS_PER_ENTITY 16
+#define PHYSICS_SYNC_BATCH_MIN 256
 
 
 void itu_system_sprite_render(SDLContext* context, ITU_EntityId* entity_ids, int entity_ids_count)
 {
-	for(int i = 0; i < entity_ids_count; ++i)
+	itu_view<Transform, Sprite> view(entity_ids, entity_ids_count);
+	for(int i = 0; i < view.count; ++i)
 	{
-		ITU_EntityId id = entity_ids[i];
-		Transform* transform = entity_get_data(id, Transform);
-		Sprite*    sprite = entity_get_data(id, Sprite);
+		Transform* transform = view.get<Transform>(i);
+		Sprite*    sprite = view.get<Sprite>(i);
 
 		itu_lib_sprite_render(context, sprite, transform);
 	}
 }
 
+struct ITU_PhysicsSyncJob
+{
+	itu_view<Transform, PhysicsData>* view;
+	float t;
+	float t_inv;
+};
+
+// reads back b2d state into the entities in [idx_beg, idx_end).
+// NOTE: only reads from b2d bodies, and every entity only touches its own components, so batches can run in parallel
+void itu_system_physics_sync_job(void* userdata, int idx_beg, int idx_end)
+{
+	ITU_PhysicsSyncJob* job = (ITU_PhysicsSyncJob*)userdata;
+	float t = job->t;
+	float t_inv = job->t_inv;
+
+	for(int i = idx_beg; i < idx_end; ++i)
+	{
+		Transform*  transform = job->view->get<Transform>(i);
+		PhysicsData* physics_data = job->view->get<PhysicsData>(i);
+
+		b2Vec2 physics_vel = b2Body_GetLinearVelocity(physics_data->body_id);
+		float  physics_trq = b2Body_GetAngularVelocity(physics_data->body_id);
+		b2Vec2 physics_pos = b2Body_GetPosition(physics_data->body_id);
+		b2Rot  physics_rot = b2Body_GetRotation(physics_data->body_id);
+
+		physics_data->velocity = value_cast(vec2f, physics_vel) * t + physics_data->fixed_step_velocity * t_inv;
+		physics_data->torque   = physics_trq * t + physics_data->fixed_step_torque * t_inv;
+
+
+		// only flag the transform as changed when it actually moved, so that sleeping/static bodies
+		// don't wake up systems filtering on changed transforms
+		bool moved = false;
+		if(!physics_data->ignore_position)
+		{
+			vec2f position = value_cast(vec2f, physics_pos) * t + physics_data->fixed_step_position * t_inv;
+			moved |= position.x != transform->position.x || position.y != transform->position.y;
+			transform->position = position;
+		}
+
+		if(!physics_data->ignore_rotation)
+		{
+			float rotation = b2Rot_GetAngle(physics_rot) * t + physics_data->fixed_step_rotation * t_inv;
+			moved |= rotation != transform->rotation;
+			transform->rotation = rotation;
+		}
+
+		if(moved)
+			job->view->mark_changed<Transform>(i);
+
+		physics_data->fixed_step_velocity = value_cast(vec2f, physics_vel);
+		physics_data->fixed_step_torque = physics_trq;
+		physics_data->fixed_step_position = value_cast(vec2f, physics_pos);
+		physics_data->fixed_step_rotation = b2Rot_GetAngle(physics_rot);
+	}
+}
+
 void itu_system_physics(SDLContext* context, ITU_EntityId* entity_ids, int entity_ids_count)
 {
-	for(int i = 0; i < entity_ids_count; ++i)
+	itu_view<Transform, PhysicsData> view(entity_ids, entity_ids_count);
+	for(int i = 0; i < view.count; ++i)
 	{
-		ITU_EntityId id = entity_ids[i];
-		PhysicsData* physics_data = entity_get_data(id, PhysicsData);
+		PhysicsData* physics_data = view.get<PhysicsData>(i);
 
 		b2Body_SetLinearVelocity(physics_data->body_id, value_cast(b2Vec2, physics_data->velocity));
 		b2Body_SetAngularVelocity(physics_data->body_id, physics_data->torque);
@@ -45,32 +102,8 @@ void itu_system_physics(SDLContext* context, ITU_EntityId* entity_ids, int entit
 		float t = (float)(context->accumulator_physics) / (float)PHYSICS_TIMESTEP_NSECS;
 		float t_inv = 1 - t;
 
-		for(int i = 0; i < entity_ids_count; ++i)
-		{
-			ITU_EntityId id = entity_ids[i];
-			Transform*  transform = entity_get_data(id, Transform);
-			PhysicsData* physics_data = entity_get_data(id, PhysicsData);
-
-			b2Vec2 physics_vel = b2Body_GetLinearVelocity(physics_data->body_id);
-			float  physics_trq = b2Body_GetAngularVelocity(physics_data->body_id);
-			b2Vec2 physics_pos = b2Body_GetPosition(physics_data->body_id);
-			b2Rot  physics_rot = b2Body_GetRotation(physics_data->body_id);
-
-			physics_data->velocity = value_cast(vec2f, physics_vel) * t + physics_data->fixed_step_velocity * t_inv;
-			physics_data->torque   = physics_trq * t + physics_data->fixed_step_torque * t_inv;
-
-
-			if(!physics_data->ignore_position)
-				transform->position = value_cast(vec2f, physics_pos) * t + physics_data->fixed_step_position * t_inv;
-
-			if(!physics_data->ignore_rotation)
-				transform->rotation = b2Rot_GetAngle(physics_rot) * t + physics_data->fixed_step_rotation * t_inv;
-
-			physics_data->fixed_step_velocity = value_cast(vec2f, physics_vel);
-			physics_data->fixed_step_torque = physics_trq;
-			physics_data->fixed_step_position = value_cast(vec2f, physics_pos);
-			physics_data->fixed_step_rotation = b2Rot_GetAngle(physics_rot);
-		}
+		ITU_PhysicsSyncJob job = { &view, t, t_inv };
+		itu_lib_jobs_parallel_for(itu_system_physics_sync_job, &job, view.count, PHYSICS_SYNC_BATCH_MIN);
 	}
 }
 
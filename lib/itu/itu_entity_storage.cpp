@@ -1,39 +1,65 @@
 ﻿#ifndef ITU_UNITY_BUILD
 #include <itu_entity_storage.hpp>
 #include <itu_lib_transform.hpp>
+#include <itu_lib_fileutils.hpp>
 #include <imgui/imgui.h>
 #endif
 
+// paged sparse array, maps EntityId.index to a location in some dense array (-1 if not present).
+// Pages are allocated the first time an index inside them is written, so a sparse set only pays for the index ranges
+// its entities actually use
+struct ITU_SparseIndex
+{
+	stbds_arr(Uint32*) pages; // NULL entries are pages that were never written
+};
+
 struct ITU_Component
 {
 	ITU_ComponentType type;
 	const char* name;
 	
 	Uint64 element_size;
-	int count_max;
+	int count_max;   // current capacity, doubles when full
 	int count_alive;
 
-	Uint64*       data_loc;   // maps EntityId.index to location in data array
-	ITU_EntityId* entity_ids; // maps data array location to an EntityId
-	void*         data;
+	ITU_SparseIndex data_loc;   // maps EntityId.index to location in data array
+	ITU_EntityId*   entity_ids; // maps data array location to an EntityId
+	void*           data;
+
+	// maps EntityId.index to the change tick of the last write (see `ITU_SystemDef::component_mask_changed`).
+	// Indexed by entity instead of by data location, so it doesn't need to follow the data when it moves around
+	// (swap-remove, sorting, archetype moves). Written when the component is added, so the page always exists afterwards
+	ITU_SparseIndex versions;
+
+	int group; // index in `ITU_EntityStorageContext::groups` of the group owning this pool, -1 if none
 
 	ITU_ComponendDebugUIRender fn_debug_ui_render;
 };
 
-struct ITU_ComponentTagStorage
+// optional dense list of all entities carrying a tag (see `itu_sys_estorage_tag_enable_members`).
+// Tag membership itself is always stored in `ITU_Entity::tag_mask`
+struct ITU_ComponentTag
 {
-	ITU_EntityId key;
+	bool tracked;
+
+	stbds_arr(ITU_EntityId) entity_ids;
+	ITU_SparseIndex         entity_loc; // maps EntityId.index to location in `entity_ids`
 };
 
-struct ITU_ComponentTag
+// pools sharing the entities that have all of `component_mask` (see `itu_sys_estorage_group_add`).
+// Those entities are the first `count` entries of every pool in the group, in the same order
+struct ITU_ComponentGroup
 {
-	ITU_ComponentType type;
-	const char* name;
-	
-	int count_max;
-	int count_alive;
+	Uint64 component_mask;
+	int count;
+};
 
-	ITU_ComponentTagStorage* entitiy_ids;
+// what a system did in one frame. Summed up if the system runs more than once in the same frame
+struct ITU_SystemStats
+{
+	float time_ms;      // wall time, including the `component_mask_changed` filter
+	int entities_count; // entities handed to `fn_update`
+	int calls_count;
 };
 
 struct ITU_System
@@ -45,6 +71,36 @@ struct ITU_System
 	ITU_TagType tags[SYSTEM_TAGS_MAX];
 	int tags_count;
 
+	Uint64 component_mask;
+	Uint64 tag_mask;
+
+	// declared access, both are ~0 for exclusive systems
+	Uint64 component_mask_read;
+	Uint64 component_mask_write;
+	bool   exclusive;
+	int    level; // systems in the same level don't conflict with each other and run in parallel
+
+	stbds_arr(ITU_EntityId) members; // dense list of matching entities, kept up to date as entities change
+	ITU_SparseIndex members_loc;     // maps EntityId.index to location in `members`
+
+	Uint64 component_mask_changed;
+	stbds_arr(ITU_EntityId) members_changed; // filtered `members`, rebuilt every run
+	Uint32 tick_last_run;
+	bool   ran_once;
+
+	int group; // group with exactly the same members as this system, -1 if none (see `itu_system_run`)
+
+	ITU_SystemScheduleMode schedule_mode;
+	float schedule_value;
+	bool  schedule_run_now;     // decided once per update, before the levels start
+	int   schedule_frames;      // updates since the last run
+	float schedule_time;        // FIXED_RATE: time owed to the system, carries over so that the average rate is right
+	float schedule_delta;       // what the system sees as `SDLContext::delta`
+	float schedule_time_since;  // time since the last run (or, for TIME_SLICED, since the current pass started)
+	int   schedule_cursor;      // TIME_SLICED: next member to process
+
+	ITU_SystemStats stats[SYSTEM_STATS_FRAMES_COUNT]; // ring buffer, see `ITU_EntityStorageContext::stats_frame`
+
 	ITU_SystemUpdateFunction fn_update;
 };
 
@@ -52,75 +108,365 @@ struct ITU_Entity
 {
 	ITU_EntityId id;
 	Uint64 component_mask;
+	Uint64 tag_mask;
+
+	// only used in ITU_ENTITY_STORAGE_MODE_ARCHETYPE
+	Uint32 archetype;
+	Uint32 archetype_row;
+};
+
+// all entities with the exact same component mask. Rows are kept dense (removal swaps the last row in),
+// and row `r` lives in chunk `r / chunk_capacity`, slot `r % chunk_capacity`.
+// Each chunk is a single allocation laid out as [entity ids][column 0][column 1]...
+struct ITU_Archetype
+{
+	Uint64 component_mask;
+	int count_alive;
+
+	int    chunk_capacity; // entities per chunk
+	Uint64 chunk_size;     // bytes per chunk
+	Uint32 column_offsets[COMPONENTS_COUNT_MAX]; // only meaningful for types set in `component_mask`
+
+	stbds_arr(unsigned char*) chunks;
+};
+
+enum ITU_EntityCommandType
+{
+	ITU_ENTITY_COMMAND_CREATE,
+	ITU_ENTITY_COMMAND_DESTROY,
+	ITU_ENTITY_COMMAND_COMPONENT_ADD,
+	ITU_ENTITY_COMMAND_COMPONENT_REMOVE,
+	ITU_ENTITY_COMMAND_TAG_ADD,
+	ITU_ENTITY_COMMAND_TAG_REMOVE,
+};
+
+struct ITU_EntityCommand
+{
+	Uint8 command_type;
+	Uint8 type; // component type or tag
+	ITU_EntityId id;
+	Uint32 data_offset; // COMPONENT_ADD only, location of the component data in `ITU_EntityCommandBuffer::data`, -1 for none
+};
+
+// only ever written by one thread (see `itu_lib_jobs_thread_index`)
+struct ITU_EntityCommandBuffer
+{
+	stbds_arr(ITU_EntityCommand) commands;
+	stbds_arr(unsigned char)     data;
+	int created_count;
 };
 
 struct ITU_EntityStorageContext
 {
+	ITU_EntityStorageMode storage_mode;
+
 	stbds_arr(ITU_Entity)   entities;
 	stbds_arr(ITU_EntityId) entities_free;
 
 	ITU_Component* components[COMPONENTS_COUNT_MAX];
 	int components_count;
 
-	ITU_ComponentTagStorage* tags[TAGS_COUNT_MAX];
+	ITU_Archetype* archetypes[ARCHETYPES_COUNT_MAX];
+	int archetypes_count;
+	stbds_hm(Uint64, int) archetypes_lookup; // component_mask -> index in `archetypes`
+
+	ITU_ComponentTag tags[TAGS_COUNT_MAX];
+
+	ITU_ComponentGroup groups[GROUPS_COUNT_MAX];
+	int groups_count;
 
 	ITU_System systems[SYSTEMS_COUNT_MAX];
 	int systems_count;
+	int systems_levels_count;
+
+	// set while non-exclusive systems are running, structural changes are not allowed
+	bool structural_lock;
+
+	// bumped before and after every level of systems, so that each level (and whatever happens between levels)
+	// writes with its own tick
+	Uint32 change_tick;
+
+	// per-system stats. A new frame starts whenever `SDLContext::uptime` moved since the last update, so that
+	// updating more than once per frame (e.g. fixed-step loops) adds up in the same frame
+	int   stats_frame;        // current slot in `ITU_System::stats`
+	int   stats_frames_count; // valid slots, up to `SYSTEM_STATS_FRAMES_COUNT`
+	float stats_uptime_last;
+
+	ITU_EntityCommandBuffer command_buffers[ITU_JOBS_WORKERS_MAX + 1];
+	stbds_arr(ITU_EntityId) deferred_created;  // maps placeholder ids to real ids while applying a buffer
+	stbds_arr(ITU_EntityId) deferred_touched;  // entities whose system membership has to be refreshed after applying
+	bool deferred_applying;
 
 	// debug properties
-	stbds_hm(ITU_EntityId, char*) entities_debug_names;
+	stbds_arr(const char*) entities_debug_names; // indexed by EntityId.index, strings are interned (see `itu_lib_strings_intern`)
 	stbds_hm(Sint32, const char*) tag_debug_names;
 };
 
 static ITU_ComponentType component_type_counter;
 ITU_EntityStorageContext ctx_estorage;
 
+Uint32 itu_sparse_index_get(ITU_SparseIndex* sparse, Uint32 index);
+void   itu_sparse_index_set(ITU_SparseIndex* sparse, Uint32 index, Uint32 loc);
+void   itu_sparse_index_clear(ITU_SparseIndex* sparse);
+
 ITU_Component* itu_component_pool_create(size_t element_size, Uint64 total_num_component, const char* component_name);
+void  itu_component_pool_reserve(ITU_Component* component_pool, int count);
 void  itu_component_pool_assign(ITU_Component* component_pool, ITU_EntityId entity);
 void  itu_component_pool_data_get(ITU_Component* component_pool, ITU_EntityId entity, void* out_data_copy);
 void  itu_component_pool_data_set(ITU_Component* component_pool, ITU_EntityId entity, void* in_data_copy);
 void  itu_component_pool_remove(ITU_Component* component_pool, ITU_EntityId entity);
 void  itu_component_pool_clear(ITU_Component* component_pool);
-int   itu_system_get_matching_entities(ITU_System* system, ITU_EntityId* out_entity_group);
+void  itu_systems_members_refresh(ITU_EntityId id);
+void  itu_system_members_remove(ITU_System* system, ITU_EntityId id);
+void  itu_system_members_clear(ITU_System* system);
+void  itu_tag_members_add(ITU_ComponentTag* tag_storage, ITU_EntityId id);
+void  itu_tag_members_remove(ITU_ComponentTag* tag_storage, ITU_EntityId id);
+static bool itu_component_is_transform3D(ITU_ComponentType component_type);
+
+int    itu_archetype_get_or_create(Uint64 component_mask);
+Uint32 itu_archetype_row_alloc(ITU_Archetype* archetype, ITU_EntityId entity);
+void   itu_archetype_row_remove(ITU_Archetype* archetype, Uint32 row);
+void*  itu_archetype_data_get(ITU_Archetype* archetype, Uint32 row, ITU_ComponentType component_type);
+void   itu_archetype_entity_move(ITU_Entity* entity, Uint64 component_mask_new);
+
+Uint32 itu_sparse_index_get(ITU_SparseIndex* sparse, Uint32 index)
+{
+	Uint32 page = index >> ENTITIES_SPARSE_PAGE_SHIFT;
+	if(page >= stbds_arrlen(sparse->pages) || !sparse->pages[page])
+		return -1;
+	return sparse->pages[page][index & ENTITIES_SPARSE_PAGE_MASK];
+}
 
-ITU_Component* itu_component_pool_create(Uint64 element_size, Uint64 total_num_component, const char* component_name)
+// allocates the page (all -1) the first time it's needed
+Uint32* itu_sparse_index_page_get_or_create(ITU_SparseIndex* sparse, Uint32 page)
+{
+	if(page >= stbds_arrlen(sparse->pages) || !sparse->pages[page])
+	{
+		while(stbds_arrlen(sparse->pages) <= page)
+			stbds_arrput(sparse->pages, NULL);
+		sparse->pages[page] = (Uint32*)SDL_malloc(sizeof(Uint32) * ENTITIES_SPARSE_PAGE_SIZE);
+		SDL_memset(sparse->pages[page], -1, sizeof(Uint32) * ENTITIES_SPARSE_PAGE_SIZE);
+	}
+	return sparse->pages[page];
+}
+
+void itu_sparse_index_set(ITU_SparseIndex* sparse, Uint32 index, Uint32 loc)
+{
+	Uint32 page = index >> ENTITIES_SPARSE_PAGE_SHIFT;
+
+	// nothing to clear in a page that doesn't exist
+	if(loc == (Uint32)-1 && (page >= stbds_arrlen(sparse->pages) || !sparse->pages[page]))
+		return;
+
+	itu_sparse_index_page_get_or_create(sparse, page)[index & ENTITIES_SPARSE_PAGE_MASK] = loc;
+}
+
+// NOTE: pages are kept allocated, they'll be reused by the next entities
+void itu_sparse_index_clear(ITU_SparseIndex* sparse)
 {
-	// common pattern: we are allocating enough space for the metadata (ITU_Component) + the array data
-	size_t size_metadata   = sizeof(ITU_Component);
-	size_t size_data_loc   = sizeof(Uint64) * ENTITIES_COUNT_MAX;
-	size_t size_entity_ids = sizeof(ITU_EntityId) * total_num_component;
-	size_t size_data       = element_size * total_num_component;
-	size_t total_size = size_metadata + size_data_loc + size_entity_ids + size_data;
+	for(int i = 0; i < stbds_arrlen(sparse->pages); ++i)
+		if(sparse->pages[i])
+			SDL_memset(sparse->pages[i], -1, sizeof(Uint32) * ENTITIES_SPARSE_PAGE_SIZE);
+}
 
-	ITU_Component* ret = (ITU_Component*)SDL_malloc(total_size);
-	SDL_memset(ret, -1, total_size);
+// `total_num_component` is only the starting capacity, pools grow on demand
+ITU_Component* itu_component_pool_create(Uint64 element_size, Uint64 total_num_component, const char* component_name)
+{
+	ITU_Component* ret = (ITU_Component*)SDL_malloc(sizeof(ITU_Component));
+	SDL_memset(ret, 0, sizeof(ITU_Component));
 
 	ret->name = component_name;
 	ret->element_size = element_size;
-	ret->count_max = total_num_component;
+	ret->count_max = 0;
 	ret->count_alive = 0;
+	ret->fn_debug_ui_render = NULL;
 
-	
-	//Uint64* valid = (Uint64*)((unsigned char*)ret + size_metadata);
+	ret->group = -1;
 
-	ret->data_loc   = pointer_offset(Uint64, ret, size_metadata);                 // first array starts at the end of the metadata
-	ret->entity_ids = pointer_offset(ITU_EntityId, ret->data_loc, size_data_loc); // second array starts at the end of first array
-	ret->data       = pointer_offset(void, ret->entity_ids, size_entity_ids);     // third array starts at the end of second array
+	// NOTE: in archetype mode component data lives in the archetype chunks, the pool only keeps metadata around
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_SPARSE_SET)
+		itu_component_pool_reserve(ret, SDL_max((int)total_num_component, COMPONENT_POOL_CAPACITY_MIN));
 
-	ret->fn_debug_ui_render = NULL;
+	return ret;
+}
+
+void itu_component_pool_reserve(ITU_Component* component_pool, int count)
+{
+	if(count <= component_pool->count_max)
+		return;
+
+	int count_max_new = SDL_max(component_pool->count_max, COMPONENT_POOL_CAPACITY_MIN);
+	while(count_max_new < count)
+		count_max_new *= 2;
+
+	// common pattern: one allocation for both parallel arrays
+	size_t size_entity_ids = sizeof(ITU_EntityId) * count_max_new;
+	size_t size_data       = component_pool->element_size * count_max_new;
+	ITU_EntityId* entity_ids = (ITU_EntityId*)SDL_malloc(size_entity_ids + size_data);
+	void*         data       = pointer_offset(void, entity_ids, size_entity_ids);
+
+	if(component_pool->entity_ids)
+	{
+		SDL_memcpy(entity_ids, component_pool->entity_ids, sizeof(ITU_EntityId) * component_pool->count_alive);
+		SDL_memcpy(data, component_pool->data, component_pool->element_size * component_pool->count_alive);
+
+		SDL_free(component_pool->entity_ids);
+	}
+
+	component_pool->entity_ids = entity_ids;
+	component_pool->data = data;
+	component_pool->count_max = count_max_new;
+}
+
+int itu_archetype_get_or_create(Uint64 component_mask)
+{
+	int loc = stbds_hmgeti(ctx_estorage.archetypes_lookup, component_mask);
+	if(loc != -1)
+		return ctx_estorage.archetypes_lookup[loc].value;
+
+	SDL_assert(ctx_estorage.archetypes_count < ARCHETYPES_COUNT_MAX);
+
+	ITU_Archetype* archetype = (ITU_Archetype*)SDL_malloc(sizeof(ITU_Archetype));
+	SDL_memset(archetype, 0, sizeof(ITU_Archetype));
+	archetype->component_mask = component_mask;
+
+	// NOTE: every column is 16-byte aligned, so we reserve the worst case padding before computing how many rows fit
+	const Uint64 column_alignment = 16;
+	Uint64 row_size = sizeof(ITU_EntityId);
+	int columns_count = 0;
+	for(int i = 0; i < ctx_estorage.components_count; ++i)
+		if(component_mask & (1ull << i))
+		{
+			row_size += ctx_estorage.components[i]->element_size;
+			++columns_count;
+		}
+
+	Uint64 size_padding = column_alignment * columns_count;
+	archetype->chunk_capacity = SDL_max(1, (int)((ARCHETYPE_CHUNK_SIZE - size_padding) / row_size));
+
+	Uint64 offset = sizeof(ITU_EntityId) * archetype->chunk_capacity;
+	for(int i = 0; i < ctx_estorage.components_count; ++i)
+		if(component_mask & (1ull << i))
+		{
+			offset = (offset + column_alignment - 1) & ~(column_alignment - 1);
+			archetype->column_offsets[i] = offset;
+			offset += ctx_estorage.components[i]->element_size * archetype->chunk_capacity;
+		}
+	archetype->chunk_size = offset;
+
+	int ret = ctx_estorage.archetypes_count++;
+	ctx_estorage.archetypes[ret] = archetype;
+	stbds_hmput(ctx_estorage.archetypes_lookup, component_mask, ret);
 
 	return ret;
 }
 
+Uint32 itu_archetype_row_alloc(ITU_Archetype* archetype, ITU_EntityId entity)
+{
+	Uint32 row = archetype->count_alive++;
+	int chunk_idx = row / archetype->chunk_capacity;
+	int slot      = row % archetype->chunk_capacity;
+
+	// chunks are never freed while the storage is alive, so we only allocate when we grow past the last one
+	if(chunk_idx == stbds_arrlen(archetype->chunks))
+		stbds_arrput(archetype->chunks, (unsigned char*)SDL_malloc(archetype->chunk_size));
+
+	unsigned char* chunk = archetype->chunks[chunk_idx];
+	((ITU_EntityId*)chunk)[slot] = entity;
+	for(int i = 0; i < ctx_estorage.components_count; ++i)
+		if(archetype->component_mask & (1ull << i))
+		{
+			Uint64 element_size = ctx_estorage.components[i]->element_size;
+			SDL_memset(chunk + archetype->column_offsets[i] + element_size * slot, 0, element_size);
+		}
+
+	return row;
+}
+
+void itu_archetype_row_remove(ITU_Archetype* archetype, Uint32 row)
+{
+	SDL_assert(row < (Uint32)archetype->count_alive);
+
+	Uint32 row_last = archetype->count_alive - 1;
+	if(row != row_last)
+	{
+		unsigned char* chunk_curr = archetype->chunks[row      / archetype->chunk_capacity];
+		unsigned char* chunk_last = archetype->chunks[row_last / archetype->chunk_capacity];
+		int slot_curr = row      % archetype->chunk_capacity;
+		int slot_last = row_last % archetype->chunk_capacity;
+
+		ITU_EntityId entity_swap = ((ITU_EntityId*)chunk_last)[slot_last];
+		((ITU_EntityId*)chunk_curr)[slot_curr] = entity_swap;
+		for(Uint64 bits = archetype->component_mask; bits; bits &= bits - 1)
+		{
+			int i = bit_index_lowest(bits);
+			Uint64 element_size = ctx_estorage.components[i]->element_size;
+			SDL_memcpy(
+				chunk_curr + archetype->column_offsets[i] + element_size * slot_curr,
+				chunk_last + archetype->column_offsets[i] + element_size * slot_last,
+				element_size
+			);
+		}
+
+		ctx_estorage.entities[entity_swap.index].archetype_row = row;
+	}
+
+	archetype->count_alive--;
+}
+
+void* itu_archetype_data_get(ITU_Archetype* archetype, Uint32 row, ITU_ComponentType component_type)
+{
+	SDL_assert(archetype->component_mask & (1ull << component_type));
+
+	unsigned char* chunk = archetype->chunks[row / archetype->chunk_capacity];
+	int slot = row % archetype->chunk_capacity;
+	return chunk + archetype->column_offsets[component_type] + ctx_estorage.components[component_type]->element_size * slot;
+}
+
+// moves all the data shared by the current and the new archetype, newly added components are zero-initialized
+void itu_archetype_entity_move(ITU_Entity* entity, Uint64 component_mask_new)
+{
+	ITU_Archetype* archetype_old = ctx_estorage.archetypes[entity->archetype];
+	Uint32 row_old = entity->archetype_row;
+
+	int archetype_new_idx = itu_archetype_get_or_create(component_mask_new);
+	ITU_Archetype* archetype_new = ctx_estorage.archetypes[archetype_new_idx];
+	Uint32 row_new = itu_archetype_row_alloc(archetype_new, entity->id);
+
+	Uint64 component_mask_shared = archetype_old->component_mask & component_mask_new;
+	for(int i = 0; i < ctx_estorage.components_count; ++i)
+		if(component_mask_shared & (1ull << i))
+			SDL_memcpy(
+				itu_archetype_data_get(archetype_new, row_new, i),
+				itu_archetype_data_get(archetype_old, row_old, i),
+				ctx_estorage.components[i]->element_size
+			);
+
+	itu_archetype_row_remove(archetype_old, row_old);
+
+	entity->archetype = archetype_new_idx;
+	entity->archetype_row = row_new;
+}
+
 ITU_ComponentType itu_sys_estorage_add_component_pool(Uint64 element_size, Uint64 total_num_component, ITU_ComponentType* ref_component_type, const char* component_name);
 void itu_sys_estorage_add_component_debug_ui_render(ITU_ComponentType component_type, ITU_ComponendDebugUIRender fn_debug_ui_render)
 ;
 
+void itu_sys_estorage_set_storage_mode(ITU_EntityStorageMode storage_mode)
+{
+	if(ctx_estorage.components_count > 0 || stbds_arrlen(ctx_estorage.entities) > 0)
+	{
+		SDL_Log("WARNING storage mode has to be set before any component pool or entity is created");
+		return;
+	}
+
+	ctx_estorage.storage_mode = storage_mode;
+}
+
 void itu_sys_estorage_init(int starting_entities_count, bool enable_standard_components=true)
 {
 	// allocate a minimum of elements at initialization time, to minimize early reallocs
 	stbds_arrsetcap(ctx_estorage.entities, starting_entities_count);
-	//stbds_hmset(ctx_estorage.entities_debug_names, starting_entities_count);
 
 	if(enable_standard_components)
 	{
@@ -138,7 +484,7 @@ void itu_sys_estorage_init(int starting_entities_count, bool enable_standard_com
 		add_component_debug_ui_render(PhysicsStaticData, itu_debug_ui_render_physicsstaticdata);
 		add_component_debug_ui_render(Transform3D, itu_debug_ui_render_transform3D);
 
-		add_system(itu_system_physics       , component_mask(PhysicsData)                                  , 0);
+		add_system(itu_system_physics       , component_mask(Transform)   | component_mask(PhysicsData)    , 0);
 		add_system(itu_system_sprite_render , component_mask(Transform)   | component_mask(Sprite)         , 0);
 	}
 }
@@ -164,842 +510,3383 @@ void itu_sys_estorage_clear_all_entities()
 {
 	stbds_arrfree(ctx_estorage.entities);
 	stbds_arrfree(ctx_estorage.entities_free);
+	stbds_arrsetlen(ctx_estorage.entities_debug_names, 0);
+	transform_hierarchy_clear();
+
+	for(int i = 0; i < TAGS_COUNT_MAX; ++i)
+		if(ctx_estorage.tags[i].tracked)
+		{
+			stbds_arrsetlen(ctx_estorage.tags[i].entity_ids, 0);
+			itu_sparse_index_clear(&ctx_estorage.tags[i].entity_loc);
+		}
+	for(int i = 0; i < ctx_estorage.systems_count; ++i)
+		itu_system_members_clear(&ctx_estorage.systems[i]);
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_SPARSE_SET)
+		for(int i = 0; i < ctx_estorage.components_count; ++i)
+			itu_component_pool_clear(ctx_estorage.components[i]);
+	for(int i = 0; i < ctx_estorage.groups_count; ++i)
+		ctx_estorage.groups[i].count = 0;
+
+	// NOTE: chunks are kept allocated, they'll be reused by the next entities
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		for(int i = 0; i < ctx_estorage.archetypes_count; ++i)
+			ctx_estorage.archetypes[i]->count_alive = 0;
+		for(int i = 0; i < ctx_estorage.components_count; ++i)
+			ctx_estorage.components[i]->count_alive = 0;
+	}
 }
 
-struct ComponentCompareWrapperData
+// swaps two entries of a pool, keeping `data_loc` in sync
+static void itu_component_pool_swap(ITU_Component* component, Uint32 loc_a, Uint32 loc_b)
 {
-	ITU_Component* component;
-	SDL_CompareCallback fn_compare;
-};
+	if(loc_a == loc_b)
+		return;
 
-int component_compare_wrapper(void* userdata, const void *a, const void* b)
+	ITU_EntityId id_a = component->entity_ids[loc_a];
+	ITU_EntityId id_b = component->entity_ids[loc_b];
+	component->entity_ids[loc_a] = id_b;
+	component->entity_ids[loc_b] = id_a;
+	itu_sparse_index_set(&component->data_loc, id_a.index, loc_b);
+	itu_sparse_index_set(&component->data_loc, id_b.index, loc_a);
+
+	unsigned char* data_a = pointer_index(component->data, loc_a, component->element_size);
+	unsigned char* data_b = pointer_index(component->data, loc_b, component->element_size);
+	unsigned char tmp[64];
+	for(Uint64 offset = 0; offset < component->element_size; offset += sizeof(tmp))
+	{
+		Uint64 size = SDL_min((Uint64)sizeof(tmp), component->element_size - offset);
+		SDL_memcpy(tmp, data_a + offset, size);
+		SDL_memcpy(data_a + offset, data_b + offset, size);
+		SDL_memcpy(data_b + offset, tmp, size);
+	}
+}
+
+// any pool of the group works as reference, this is the one handing out the group's entity ids
+static ITU_Component* itu_group_pool_first(ITU_ComponentGroup* group)
 {
-	ComponentCompareWrapperData* data = (ComponentCompareWrapperData*)userdata;
-	const int idx_a = *(const int*)a;
-	const int idx_b = *(const int*)b;
-	const void* data_a = pointer_offset(const void*, data->component->data, data->component->element_size * idx_a);
-	const void* data_b = pointer_offset(const void*, data->component->data, data->component->element_size * idx_b);
-	return data->fn_compare(data_a, data_b);
+	return ctx_estorage.components[bit_index_lowest(group->component_mask)];
 }
 
-void itu_sys_estorage_component_sort_data(ITU_ComponentType component_type, SDL_CompareCallback fn_compare)
+static bool itu_group_contains(ITU_ComponentGroup* group, ITU_EntityId id)
 {
-	SDL_assert(component_type < ctx_estorage.components_count);
+	Uint32 loc = itu_sparse_index_get(&itu_group_pool_first(group)->data_loc, id.index);
+	return loc != (Uint32)-1 && loc < (Uint32)group->count;
+}
 
-	// sort parallel arrays
-	ITU_Component* component = ctx_estorage.components[component_type];
+// the entity has to be in every pool of the group already
+static void itu_group_enter(ITU_ComponentGroup* group, ITU_EntityId id)
+{
+	for(Uint64 bits = group->component_mask; bits; bits &= bits - 1)
+	{
+		ITU_Component* component = ctx_estorage.components[bit_index_lowest(bits)];
+		itu_component_pool_swap(component, itu_sparse_index_get(&component->data_loc, id.index), group->count);
+	}
+	group->count++;
+}
 
-	int idxs[ENTITIES_COUNT_MAX];
-	for(int i = 0; i < component->count_alive; ++i)
-		idxs[i] = i;
+// the entity has to still be in every pool of the group
+static void itu_group_leave(ITU_ComponentGroup* group, ITU_EntityId id)
+{
+	group->count--;
+	for(Uint64 bits = group->component_mask; bits; bits &= bits - 1)
+	{
+		ITU_Component* component = ctx_estorage.components[bit_index_lowest(bits)];
+		itu_component_pool_swap(component, itu_sparse_index_get(&component->data_loc, id.index), group->count);
+	}
+}
 
-	ComponentCompareWrapperData data = { component, fn_compare };
-	SDL_qsort_r(idxs, component->count_alive, sizeof(int), component_compare_wrapper, &data);
+// has to be called after `component_type` was added to `id` (sparse set mode only)
+static void itu_groups_component_added(ITU_EntityId id, ITU_ComponentType component_type)
+{
+	int group_idx = ctx_estorage.components[component_type]->group;
+	if(group_idx == -1)
+		return;
 
+	ITU_ComponentGroup* group = &ctx_estorage.groups[group_idx];
+	if((ctx_estorage.entities[id.index].component_mask & group->component_mask) == group->component_mask)
+		itu_group_enter(group, id);
+}
 
-	// FIXME stupid hack to avoid malloc a swap entity, needed because the following loop works under
-	//       the assumption that we will never have all entries in ITU_Component::data filled so
-	//       we can use the last one as swap location
-	//       this would not be a problem if we had a scratch arena, but proper allocation strategie had to be cut
-	//       from the course and I don't have time to create one under the hood just for this
-	SDL_assert(component->count_alive != component->count_max);
-	int   idx_data_swap = component->count_max;
-	void* ptr_data_swap = pointer_offset(void*, component->data, component->element_size * idx_data_swap);
+// has to be called before `component_type` is removed from `id` (sparse set mode only)
+static void itu_groups_component_removed(ITU_EntityId id, ITU_ComponentType component_type)
+{
+	int group_idx = ctx_estorage.components[component_type]->group;
+	if(group_idx != -1 && itu_group_contains(&ctx_estorage.groups[group_idx], id))
+		itu_group_leave(&ctx_estorage.groups[group_idx], id);
+}
 
-	for(int i = 0; i < component->count_alive; ++i)
-		if(i != idxs[i])
-		{
-			void* ptr_data_0 = pointer_offset(void*, component->data, component->element_size * i);
-			void* ptr_data_1 = pointer_offset(void*, component->data, component->element_size * idxs[i]);
-			SDL_memcpy(ptr_data_swap, ptr_data_0   , component->element_size);
-			SDL_memcpy(ptr_data_0   , ptr_data_1   , component->element_size);
-			SDL_memcpy(ptr_data_1   , ptr_data_swap, component->element_size);
-
-			ITU_EntityId id_swap = component->entity_ids[i];
-			component->entity_ids[i] = component->entity_ids[idxs[i]];
-			component->entity_ids[idxs[i]] = id_swap;
-
-			component->data_loc[component->entity_ids[i].index] = i;
-			component->data_loc[component->entity_ids[idxs[i]].index] = idxs[i];
-		}
+// only systems with exactly the same members as a group can use the group's entity ids in place of their own
+static int itu_group_find_for_system(ITU_System* system)
+{
+	if(system->tag_mask || system->component_mask_changed)
+		return -1;
+
+	for(int i = 0; i < ctx_estorage.groups_count; ++i)
+		if(ctx_estorage.groups[i].component_mask == system->component_mask)
+			return i;
+	return -1;
 }
 
-void itu_sys_estorage_set_systems(ITU_SystemDef* systems, int systems_count)
+struct ComponentCompareWrapperData
 {
-	SDL_assert(systems_count <= SYSTEMS_COUNT_MAX);
+	ITU_Component* component;
+	SDL_CompareCallback fn_compare;
+};
 
-	ctx_estorage.systems_count = systems_count;
-	for(int i = 0; i < systems_count; ++i)
+// reorders the pool so that element `i` becomes the one that was at `idxs[i]`.
+// Walks each cycle of the permutation once, so every element is copied exactly once (plus one scratch copy per cycle).
+// `data_scratch` has to fit one element.
+// NOTE: `idxs` is used to mark visited elements, its content is garbage afterwards
+void itu_component_pool_permute(ITU_Component* component, Uint32* idxs, void* data_scratch)
+{
+	Uint64 element_size = component->element_size;
+
+	for(int i = 0; i < component->count_alive; ++i)
 	{
-		ITU_System* system_runtime = &ctx_estorage.systems[i];
-		ITU_SystemDef* system_def  = &systems[i];
+		if(idxs[i] == (Uint32)i)
+			continue;
 
-		// build component pool pointers (this requires component pools to be alredy set up)
-		for(int j = 0; j < COMPONENTS_COUNT_MAX; ++j)
-		{
-			Uint64 component_bitmask = 1ll << j;
-			if(system_def->component_mask & component_bitmask)
-				system_runtime->components[system_runtime->components_count++] = ctx_estorage.components[j];
-		}
-		for(int j = 0; j < TAGS_COUNT_MAX; ++j)
+		// hold the first element of the cycle, then pull every other one into the hole left by the previous
+		ITU_EntityId id_scratch = component->entity_ids[i];
+		SDL_memcpy(data_scratch, pointer_index(component->data, i, element_size), element_size);
+
+		Uint32 curr = i;
+		for(;;)
 		{
-			Uint64 tag_bitmask = 1ll << j;
-			if(system_def->tag_mask & tag_bitmask)
-				system_runtime->tags[system_runtime->tags_count++] = j;
+			Uint32 next = idxs[curr];
+			idxs[curr] = curr;
+			if(next == (Uint32)i)
+			{
+				component->entity_ids[curr] = id_scratch;
+				SDL_memcpy(pointer_index(component->data, curr, element_size), data_scratch, element_size);
+				itu_sparse_index_set(&component->data_loc, id_scratch.index, curr);
+				break;
+			}
+
+			component->entity_ids[curr] = component->entity_ids[next];
+			SDL_memcpy(pointer_index(component->data, curr, element_size), pointer_index(component->data, next, element_size), element_size);
+			itu_sparse_index_set(&component->data_loc, component->entity_ids[curr].index, curr);
+			curr = next;
 		}
-		system_runtime->fn_update = system_def->fn_update;
-		system_runtime->name = system_def->name;
 	}
 }
 
-void itu_sys_estorage_add_system(ITU_SystemDef system_def)
+// applies the result of a sort (`idxs`, see `itu_component_pool_permute`) without breaking groups:
+// group members stay at the front of the pool (in sorted order, followed by the sorted rest),
+// and every other pool of the group gets their new order too
+static void itu_component_pool_permute_sorted(ITU_Component* component, Uint32* idxs, ITU_Arena* arena)
 {
-	if(ctx_estorage.systems_count == SYSTEMS_COUNT_MAX)
+	void* data_scratch = itu_lib_arena_push(arena, component->element_size, 16);
+	if(component->group == -1)
 	{
-		SDL_Log("WARNING maximum number of systes reached");
+		itu_component_pool_permute(component, idxs, data_scratch);
 		return;
 	}
 
-	ITU_System* system_runtime = &ctx_estorage.systems[ctx_estorage.systems_count++];
-
-	// build component pool pointers (this requires component pools to be alredy set up)
-	for(int j = 0; j < COMPONENTS_COUNT_MAX; ++j)
+	ITU_ComponentGroup* group = &ctx_estorage.groups[component->group];
+	Uint32* idxs_partitioned = arena_push_array(arena, Uint32, component->count_alive);
+	int members_count = 0;
+	int others_count = group->count;
+	for(int i = 0; i < component->count_alive; ++i)
 	{
-		Uint64 component_bitmask = 1ll << j;
-		if(system_def.component_mask & component_bitmask)
-			system_runtime->components[system_runtime->components_count++] = ctx_estorage.components[j];
+		if(idxs[i] < (Uint32)group->count)
+			idxs_partitioned[members_count++] = idxs[i];
+		else
+			idxs_partitioned[others_count++] = idxs[i];
 	}
-	for(int j = 0; j < TAGS_COUNT_MAX; ++j)
+
+	for(Uint64 bits = group->component_mask; bits; bits &= bits - 1)
 	{
-		Uint64 tag_bitmask = 1ll << j;
-		if(system_def.tag_mask & tag_bitmask)
-			system_runtime->tags[system_runtime->tags_count++] = j;
+		ITU_Component* component_other = ctx_estorage.components[bit_index_lowest(bits)];
+		if(component_other == component)
+			continue;
+
+		// entries past the group are not related to this pool, they stay where they are
+		Uint32* idxs_other = arena_push_array(arena, Uint32, component_other->count_alive);
+		for(int i = 0; i < component_other->count_alive; ++i)
+			idxs_other[i] = i < group->count ? idxs_partitioned[i] : i;
+
+		void* data_scratch_other = itu_lib_arena_push(arena, component_other->element_size, 16);
+		itu_component_pool_permute(component_other, idxs_other, data_scratch_other);
 	}
-	system_runtime->fn_update = system_def.fn_update;
-	system_runtime->name = system_def.name;
+
+	itu_component_pool_permute(component, idxs_partitioned, data_scratch);
+}
+
+int component_compare_wrapper(void* userdata, const void *a, const void* b)
+{
+	ComponentCompareWrapperData* data = (ComponentCompareWrapperData*)userdata;
+	const int idx_a = *(const int*)a;
+	const int idx_b = *(const int*)b;
+	const void* data_a = pointer_offset(const void*, data->component->data, data->component->element_size * idx_a);
+	const void* data_b = pointer_offset(const void*, data->component->data, data->component->element_size * idx_b);
+	return data->fn_compare(data_a, data_b);
 }
 
+struct ArchetypeCompareWrapperData
+{
+	ITU_Archetype* archetype;
+	ITU_ComponentType component_type;
+	SDL_CompareCallback fn_compare;
+};
 
-int itu_system_get_matching_entities(ITU_System* system, ITU_EntityId* out_entity_group)
+int archetype_compare_wrapper(void* userdata, const void *a, const void* b)
 {
-	ITU_EntityId* min_component;
-	Uint64  min_component_size = ENTITIES_COUNT_MAX + 1;
-	int system_ids_count = 0;
+	ArchetypeCompareWrapperData* data = (ArchetypeCompareWrapperData*)userdata;
+	const Uint32 row_a = *(const Uint32*)a;
+	const Uint32 row_b = *(const Uint32*)b;
+	return data->fn_compare(
+		itu_archetype_data_get(data->archetype, row_a, data->component_type),
+		itu_archetype_data_get(data->archetype, row_b, data->component_type)
+	);
+}
 
-	for(int j = 0; j < system->components_count; ++j)
-		if(system->components[j]->count_alive < min_component_size)
-		{
-			min_component = system->components[j]->entity_ids;
-			min_component_size = system->components[j]->count_alive;
-		}
+// moves rows so that row `i` ends up holding what was in row `rows[i]`. Every column (entity ids included) is
+// gathered in the new order into scratch memory and copied back
+static void itu_archetype_rows_permute(ITU_Archetype* archetype, Uint32* rows, ITU_Arena* arena)
+{
+	int count = archetype->count_alive;
 
-	for(int j = 0; j < system->tags_count; ++j)
+	ITU_EntityId* ids = arena_push_array(arena, ITU_EntityId, count);
+	for(int i = 0; i < count; ++i)
+		ids[i] = ((ITU_EntityId*)archetype->chunks[rows[i] / archetype->chunk_capacity])[rows[i] % archetype->chunk_capacity];
+	for(int i = 0; i < count; ++i)
 	{
-		auto tmp = ctx_estorage.tags[system->tags[j]];
-		if(!tmp)
-			continue;
-		if(stbds_hmlen(tmp) < min_component_size)
-		{
-			min_component = (ITU_EntityId*)tmp;
-			min_component_size = stbds_hmlen(tmp);
-		}
+		((ITU_EntityId*)archetype->chunks[i / archetype->chunk_capacity])[i % archetype->chunk_capacity] = ids[i];
+		ctx_estorage.entities[ids[i].index].archetype_row = i;
 	}
 
-	// filter entities
-	for(int k = 0; k < min_component_size; ++k)
+	for(Uint64 bits = archetype->component_mask; bits; bits &= bits - 1)
 	{
-		ITU_EntityId entity_curr = min_component[k];
-		bool filter_out = false;
-		for(int j = 0; j < system->components_count; ++j)
-		{
-			ITU_Component* filtered_component = system->components[j];
-
-			if(filtered_component->data_loc[entity_curr.index] == -1)
-			{
-				filter_out = true;
-				break;
-			}
-		}
-
-		for(int j = 0; j < system->tags_count; ++j)
-		{
-			ITU_TagType filtered_tag = system->tags[j];
-				
-			if(stbds_hmgeti(ctx_estorage.tags[filtered_tag], entity_curr) == -1)
-			{
-				filter_out = true;
-				break;
-			}
-		}
-		if(!filter_out)
-			out_entity_group[system_ids_count++] = entity_curr;
+		ITU_ComponentType component_type = bit_index_lowest(bits);
+		Uint64 element_size = ctx_estorage.components[component_type]->element_size;
+
+		unsigned char* column = (unsigned char*)itu_lib_arena_push(arena, element_size * count, 16);
+		for(int i = 0; i < count; ++i)
+			SDL_memcpy(column + element_size * i, itu_archetype_data_get(archetype, rows[i], component_type), element_size);
+		for(int i = 0; i < count; ++i)
+			SDL_memcpy(itu_archetype_data_get(archetype, i, component_type), column + element_size * i, element_size);
 	}
-
-	return system_ids_count;
 }
 
-void itu_sys_estorage_systems_update(SDLContext* context)
+void itu_sys_estorage_component_sort_data(ITU_ComponentType component_type, SDL_CompareCallback fn_compare)
 {
-	for(int i = 0; i < ctx_estorage.systems_count; ++i)
+	SDL_assert(component_type < ctx_estorage.components_count);
+
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
 	{
-		ITU_System* system = &ctx_estorage.systems[i];
-		ITU_EntityId system_ids[ENTITIES_COUNT_MAX];
-		int system_ids_count = itu_system_get_matching_entities(system, system_ids);
+		// rows can't leave their archetype, so each one is sorted on its own
+		for(int i = 0; i < ctx_estorage.archetypes_count; ++i)
+		{
+			ITU_Archetype* archetype = ctx_estorage.archetypes[i];
+			if(!(archetype->component_mask & (1ull << component_type)) || archetype->count_alive < 2)
+				continue;
+
+			ITU_ArenaTemp scratch = itu_lib_arena_scratch_begin(NULL);
+			Uint32* rows = arena_push_array(scratch.arena, Uint32, archetype->count_alive);
+			for(int row = 0; row < archetype->count_alive; ++row)
+				rows[row] = row;
 
-		system->fn_update(context, system_ids, system_ids_count);
+			ArchetypeCompareWrapperData data = { archetype, component_type, fn_compare };
+			SDL_qsort_r(rows, archetype->count_alive, sizeof(Uint32), archetype_compare_wrapper, &data);
+
+			itu_archetype_rows_permute(archetype, rows, scratch.arena);
+			itu_lib_arena_scratch_end(scratch);
+		}
+		return;
 	}
+
+	// sort parallel arrays
+	ITU_Component* component = ctx_estorage.components[component_type];
+
+	ITU_ArenaTemp scratch = itu_lib_arena_scratch_begin(NULL);
+	int* idxs = arena_push_array(scratch.arena, int, component->count_alive);
+	for(int i = 0; i < component->count_alive; ++i)
+		idxs[i] = i;
+
+	ComponentCompareWrapperData data = { component, fn_compare };
+	SDL_qsort_r(idxs, component->count_alive, sizeof(int), component_compare_wrapper, &data);
+
+	itu_component_pool_permute_sorted(component, (Uint32*)idxs, scratch.arena);
+	itu_lib_arena_scratch_end(scratch);
 }
 
-enum ITU_SysEstorageDebugDetailCategory { ITU_SYS_ESTORAGE_DETAIL_CATEGORY_ENTITY, ITU_SYS_ESTORAGE_DETAIL_CATEGORY_SYSTEM, ITU_SYS_ESTORAGE_DETAIL_CATEGORY_COMPONENT, ITU_SYS_ESTORAGE_DETAIL_CATEGORY_MAX };
+// elements with less than this many descents (key[i] < key[i-1]) per 64 elements are considered "nearly sorted"
+// and go through insertion sort instead of radix sort
+#define COMPONENT_SORT_DESCENTS_PER_64_MAX 1
 
-struct ITU_DebugWindowCtx
+// sorts `keys` (ascending, stable) and returns where each one was before, or NULL if they were sorted already
+static Uint32* itu_sort_keys_indices(Uint32* keys, int count, ITU_Arena* arena)
 {
-	
-	// TODO make this into a context struct
-	ITU_SysEstorageDebugDetailCategory detail_category = ITU_SYS_ESTORAGE_DETAIL_CATEGORY_MAX;
-	int loc_selected = -1;
-};
-ITU_DebugWindowCtx ctx_debug_window = { ITU_SYS_ESTORAGE_DETAIL_CATEGORY_MAX, -1 };
+	Uint32* idxs     = arena_push_array(arena, Uint32, count);
+	Uint32* keys_tmp = arena_push_array(arena, Uint32, count);
+	Uint32* idxs_tmp = arena_push_array(arena, Uint32, count);
 
-void itu_sys_estorage_debug_render_detail_entity(SDLContext* context, ITU_EntityId id)
-{
-	if(!itu_entity_is_valid(id))
+	int descents_count = 0;
+	for(int i = 0; i < count; ++i)
 	{
-		ImGui::Text("INVALID ENTITY");
-		return;
+		idxs[i] = i;
+		if(i > 0 && keys[i] < keys[i - 1])
+			++descents_count;
 	}
-	// TODO wrap tag list rendering in appropriate function
+
+	if(descents_count == 0)
+		return NULL;
+
+	if(descents_count <= (count / 64 + 1) * COMPONENT_SORT_DESCENTS_PER_64_MAX)
 	{
-		ImGui::CollapsingHeader("tags", ImGuiTreeNodeFlags_Leaf);
-		int num_tags = 0;
-		for(int i = 0; i < TAGS_COUNT_MAX; ++i)
+		// incremental path: a few elements out of place from last frame, insertion sort is linear-ish here
+		for(int i = 1; i < count; ++i)
 		{
-			if(stbds_hmgeti(ctx_estorage.tags[i], id) == -1)
-				continue;
-
-			++num_tags;
-			// TODO also wrap single tag (idx + name) rendering in appropriate function
-			int loc_tag_name = stbds_hmgeti(ctx_estorage.tag_debug_names, i);
-			if(loc_tag_name == -1)
-				ImGui::Text("%3d", i);
-			else
-				ImGui::Text("%3d: %s", i, ctx_estorage.tag_debug_names[loc_tag_name].value);
+			Uint32 key = keys[i];
+			Uint32 idx = idxs[i];
+			int j = i - 1;
+			while(j >= 0 && keys[j] > key)
+			{
+				keys[j + 1] = keys[j];
+				idxs[j + 1] = idxs[j];
+				--j;
+			}
+			keys[j + 1] = key;
+			idxs[j + 1] = idx;
 		}
-		if(num_tags == 0)
-			ImGui::Text("none");
 	}
-
-	for(int i = 0; i < ctx_estorage.components_count; ++i)
+	else
 	{
-		void* component_data = itu_entity_data_get(id, i);
+		// LSD radix sort, 8 bits per pass. Passes where every key has the same digit are skipped,
+		// so small keys (e.g. a layer index) only pay for the bytes they actually use
+		for(int shift = 0; shift < 32; shift += 8)
+		{
+			int histogram[256] = { 0 };
+			for(int i = 0; i < count; ++i)
+				++histogram[(keys[i] >> shift) & 0xFF];
+			if(histogram[(keys[0] >> shift) & 0xFF] == count)
+				continue;
 
-		if(!component_data)
-			continue;
+			int offset = 0;
+			for(int i = 0; i < 256; ++i)
+			{
+				int bucket_count = histogram[i];
+				histogram[i] = offset;
+				offset += bucket_count;
+			}
 
-		ImGui::CollapsingHeader(ctx_estorage.components[i]->name, ImGuiTreeNodeFlags_Leaf);
-		{
-			if(ctx_estorage.components[i]->fn_debug_ui_render)
-				ctx_estorage.components[i]->fn_debug_ui_render(context, component_data);
-			else
-				ImGui::Text("TODO NotYetImplemented");
+			for(int i = 0; i < count; ++i)
+			{
+				int loc = histogram[(keys[i] >> shift) & 0xFF]++;
+				keys_tmp[loc] = keys[i];
+				idxs_tmp[loc] = idxs[i];
+			}
+
+			Uint32* swap;
+			swap = keys; keys = keys_tmp; keys_tmp = swap;
+			swap = idxs; idxs = idxs_tmp; idxs_tmp = swap;
 		}
 	}
+
+	return idxs;
 }
 
-void itu_sys_estorage_debug_render_detail_system(SDLContext* context, ITU_System* system, ITU_EntityId* system_ids, int system_ids_count)
+void itu_sys_estorage_component_sort_keys(ITU_ComponentType component_type, ITU_ComponentSortKeyFunction fn_key)
 {
-	ImGui::CollapsingHeader("components", ImGuiTreeNodeFlags_Leaf);
-	for(int i = 0; i < system->components_count; ++i)
-		ImGui::Text("%s", system->components[i]->name);
+	SDL_assert(component_type < ctx_estorage.components_count);
 
-	// TODO wrap tag list rendering in appropriate function
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
 	{
-		ImGui::CollapsingHeader("tags", ImGuiTreeNodeFlags_Leaf);
-		int num_tags = 0;
-		for(int i = 0; i < system->tags_count; ++i)
+		// same as `itu_sys_estorage_component_sort_data`, each archetype on its own
+		for(int i = 0; i < ctx_estorage.archetypes_count; ++i)
 		{
-			++num_tags;
-			// TODO also wrap single tag (idx + name) rendering in appropriate function
-			int tag = system->tags[i];
-			int loc_tag_name = stbds_hmgeti(ctx_estorage.tag_debug_names, tag);
-			if(loc_tag_name == -1)
-				ImGui::Text("%3d", tag);
-			else
-				ImGui::Text("%3d: %s", tag, ctx_estorage.tag_debug_names[loc_tag_name].value);
+			ITU_Archetype* archetype = ctx_estorage.archetypes[i];
+			int count = archetype->count_alive;
+			if(!(archetype->component_mask & (1ull << component_type)) || count < 2)
+				continue;
+
+			ITU_ArenaTemp scratch = itu_lib_arena_scratch_begin(NULL);
+			Uint32* keys = arena_push_array(scratch.arena, Uint32, count);
+			for(int row = 0; row < count; ++row)
+				keys[row] = fn_key(itu_archetype_data_get(archetype, row, component_type));
+
+			Uint32* rows = itu_sort_keys_indices(keys, count, scratch.arena);
+			if(rows)
+				itu_archetype_rows_permute(archetype, rows, scratch.arena);
+			itu_lib_arena_scratch_end(scratch);
 		}
-		if(num_tags == 0)
-			ImGui::Text("none");
+		return;
 	}
 
-	ImGui::CollapsingHeader("currently iterated entities", ImGuiTreeNodeFlags_Leaf);
-	ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
-	for(int i = 0; i < system_ids_count; ++i)
-	{
-		char buf[8];
-		SDL_snprintf(buf, 8, "%d", i);
-		itu_debug_ui_widget_entityid((char*)buf, system_ids[i]);
-	}
-	ImGui::PopStyleVar();
+	ITU_Component* component = ctx_estorage.components[component_type];
+	int count = component->count_alive;
+	if(count < 2)
+		return;
+
+	ITU_ArenaTemp scratch = itu_lib_arena_scratch_begin(NULL);
+	Uint32* keys = arena_push_array(scratch.arena, Uint32, count);
+	for(int i = 0; i < count; ++i)
+		keys[i] = fn_key(pointer_index(component->data, i, component->element_size));
+
+	Uint32* idxs = itu_sort_keys_indices(keys, count, scratch.arena);
+	if(idxs)
+		itu_component_pool_permute_sorted(component, idxs, scratch.arena);
+	itu_lib_arena_scratch_end(scratch);
 }
 
-void itu_sys_estorage_debug_render_detail_component(SDLContext* context, ITU_Component* component)
+bool itu_system_matches_entity(ITU_System* system, ITU_EntityId id)
 {
-	// sparse array
-	{
-		if(ImGui::BeginTable("entities", 2, ImGuiTableFlags_SizingFixedFit))
-		{
-			ImGui::TableSetupColumn("entity");
-			ImGui::TableSetupColumn("location");
-			ImGui::TableHeadersRow();
+	ITU_Entity* entity = &ctx_estorage.entities[id.index];
+	return (entity->component_mask & system->component_mask) == system->component_mask
+	    && (entity->tag_mask       & system->tag_mask      ) == system->tag_mask;
+}
 
-			for(int i = 0; i < component->count_alive; ++i)
-			{
-				ITU_EntityId id = component->entity_ids[i];
-				ImGui::TableNextRow();
+void itu_system_members_add(ITU_System* system, ITU_EntityId id)
+{
+	SDL_assert(itu_sparse_index_get(&system->members_loc, id.index) == (Uint32)-1);
 
-				ImGui::TableNextColumn();
-				itu_debug_ui_widget_entityid_tablerow(id);
+	itu_sparse_index_set(&system->members_loc, id.index, stbds_arrlen(system->members));
+	stbds_arrput(system->members, id);
+}
 
-				ImGui::TableNextColumn();
-				ImGui::Text("%d", i);
-			}
-			ImGui::EndTable();
-		}
+void itu_system_members_remove(ITU_System* system, ITU_EntityId id)
+{
+	Uint32 loc_curr = itu_sparse_index_get(&system->members_loc, id.index);
+	SDL_assert(loc_curr != (Uint32)-1);
+
+	// same swap-with-last as component pools
+	ITU_EntityId entity_swap = stbds_arrpop(system->members);
+	if(loc_curr < stbds_arrlen(system->members))
+	{
+		system->members[loc_curr] = entity_swap;
+		itu_sparse_index_set(&system->members_loc, entity_swap.index, loc_curr);
 	}
+	itu_sparse_index_set(&system->members_loc, id.index, -1);
+}
 
-	//ImGui::SameLine();
-	//// locations
-	//{
-	//}
-	// data?
+void itu_system_members_clear(ITU_System* system)
+{
+	stbds_arrsetlen(system->members, 0);
+	itu_sparse_index_clear(&system->members_loc);
 }
 
-int itu_sys_estorage_list_entities_alive(ITU_EntityId* arr_entities, int arr_entities_max)
+// re-evaluates the membership of `id` for every system. Has to be called every time the component mask or the tags of an entity change
+void itu_systems_members_refresh(ITU_EntityId id)
 {
-	int entities_count = stbds_arrlen(ctx_estorage.entities);
+	// batched, see `itu_sys_estorage_deferred_apply`
+	if(ctx_estorage.deferred_applying)
+	{
+		stbds_arrput(ctx_estorage.deferred_touched, id);
+		return;
+	}
 
-	int ret = 0;
-	for(int i = 0; i < entities_count; ++i)
-		if(itu_entity_is_valid(ctx_estorage.entities[i].id))
-			arr_entities[ret++] = ctx_estorage.entities[i].id;
+	for(int i = 0; i < ctx_estorage.systems_count; ++i)
+	{
+		ITU_System* system = &ctx_estorage.systems[i];
+		bool is_member = itu_sparse_index_get(&system->members_loc, id.index) != (Uint32)-1;
+		bool matches   = itu_system_matches_entity(system, id);
 
-	return ret;
+		if(matches && !is_member)
+			itu_system_members_add(system, id);
+		else if(!matches && is_member)
+			itu_system_members_remove(system, id);
+	}
 }
 
-void itu_sys_estorage_debug_render_entity_table()
+void itu_system_members_rebuild(ITU_System* system)
 {
+	itu_system_members_clear(system);
+
 	int entities_count = stbds_arrlen(ctx_estorage.entities);
-	if(ImGui::BeginTable("debug_estorage_master_entities", 5, ImGuiTableFlags_SizingFixedFit))
+	for(int i = 0; i < entities_count; ++i)
 	{
-		ImGui::TableSetupColumn("##col_del");
-		ImGui::TableSetupColumn("##col_idx");
-		ImGui::TableSetupColumn("name");
-		ImGui::TableSetupColumn("gen");
-		ImGui::TableSetupColumn("idx");
-		ImGui::TableHeadersRow();
-		int row_idx = 0;
-		for(int i = 0; i < entities_count; ++i)
-		{
-			ITU_EntityId id = ctx_estorage.entities[i].id;
-			if(!itu_entity_is_valid(id))
-				continue;
-			ImGui::TableNextRow();
-
-			ImGui::TableNextColumn();
-			char buf_del[48];
-			ImGui::PushID(i);
-			//SDL_snprintf(buf_del, 48, "X##%3ddebug_estorage_master_entities", row_idx);
-			if(ImGui::Button("X"))
-			{
-				itu_entity_destroy(id);
-				ctx_debug_window.loc_selected = -1;
-			}
-
-			ImGui::TableNextColumn();
-			char buf_id[48];
-			SDL_snprintf(buf_id, 48, "%3d##debug_estorage_master_entities", row_idx);
-			if(ImGui::Selectable(
-				"",
-				ctx_debug_window.detail_category == ITU_SYS_ESTORAGE_DETAIL_CATEGORY_ENTITY && row_idx == ctx_debug_window.loc_selected,
-				ImGuiSelectableFlags_SpanAllColumns
-			))
-			{
-				ctx_debug_window.loc_selected = i;
-				ctx_debug_window.detail_category = ITU_SYS_ESTORAGE_DETAIL_CATEGORY_ENTITY;
-			}
+		ITU_EntityId id = ctx_estorage.entities[i].id;
+		if(itu_entity_is_valid(id) && itu_system_matches_entity(system, id))
+			itu_system_members_add(system, id);
+	}
+}
 
-			ImGui::TableNextColumn();
-			int pos_debug_name = stbds_hmgeti(ctx_estorage.entities_debug_names, id);
-			if(pos_debug_name != -1)
-				ImGui::Text("%s", ctx_estorage.entities_debug_names[pos_debug_name].value);
+void itu_system_schedule_set(ITU_System* system, ITU_SystemScheduleMode schedule_mode, float schedule_value)
+{
+	if(schedule_mode != ITU_SYSTEM_SCHEDULE_EVERY_FRAME && schedule_value <= 0)
+	{
+		SDL_Log("WARNING system %s: invalid schedule value %f, running every frame\n", system->name, schedule_value);
+		schedule_mode = ITU_SYSTEM_SCHEDULE_EVERY_FRAME;
+	}
+	// the changed list is rebuilt every run, there is nothing stable to walk across updates
+	if(schedule_mode != ITU_SYSTEM_SCHEDULE_EVERY_FRAME && system->component_mask_changed)
+	{
+		SDL_Log("WARNING system %s: scheduling is not supported together with `component_mask_changed`, running every frame\n", system->name);
+		schedule_mode = ITU_SYSTEM_SCHEDULE_EVERY_FRAME;
+	}
 
+	system->schedule_mode = schedule_mode;
+	system->schedule_value = schedule_value;
+	system->schedule_frames = 0;
+	system->schedule_time = 0;
+	system->schedule_time_since = 0;
+	system->schedule_delta = 0;
+	system->schedule_cursor = 0;
+}
 
-			ImGui::TableNextColumn();
-			ImGui::Text("%d", id.generation);
+// decides whether the system runs in this update, and what `delta` it sees
+void itu_system_schedule_update(ITU_System* system, float delta)
+{
+	system->schedule_time_since += delta;
+	system->schedule_frames++;
 
-			ImGui::TableNextColumn();
-			ImGui::Text("%d", id.index);
-			ImGui::PopID();
-			++row_idx;
+	switch(system->schedule_mode)
+	{
+		case ITU_SYSTEM_SCHEDULE_EVERY_FRAME:
+			system->schedule_run_now = true;
+			break;
+		case ITU_SYSTEM_SCHEDULE_EVERY_N_FRAMES:
+			system->schedule_run_now = system->schedule_frames >= (int)system->schedule_value;
+			break;
+		case ITU_SYSTEM_SCHEDULE_FIXED_RATE:
+		{
+			float period = 1.0f / system->schedule_value;
+			system->schedule_time += delta;
+			system->schedule_run_now = system->schedule_time >= period;
+			if(system->schedule_run_now)
+				// never owe more than one run, a long frame shouldn't cause a burst afterwards
+				system->schedule_time = SDL_min(system->schedule_time - period, period);
+			break;
 		}
+		case ITU_SYSTEM_SCHEDULE_TIME_SLICED:
+			// `schedule_delta` is only updated when a full pass completes (see `itu_system_run_sliced`),
+			// until the first one the system sees the normal delta
+			system->schedule_run_now = true;
+			if(system->schedule_delta == 0)
+				system->schedule_delta = delta;
+			return;
+	}
 
-		ImGui::EndTable();
+	if(system->schedule_run_now)
+	{
+		system->schedule_delta = system->schedule_time_since;
+		system->schedule_time_since = 0;
+		system->schedule_frames = 0;
 	}
 }
 
-void do_transform_tree_recursive(ITU_Component* transform_component, Transform3D* curr)
+void itu_system_init(ITU_System* system_runtime, ITU_SystemDef* system_def)
 {
-	if(!curr)
-		return;
+	// NOTE: member storage is kept around when a system slot is reused
+	stbds_arr(ITU_EntityId) members = system_runtime->members;
+	ITU_SparseIndex     members_loc = system_runtime->members_loc;
+	stbds_arr(ITU_EntityId) members_changed = system_runtime->members_changed;
+	SDL_memset(system_runtime, 0, sizeof(ITU_System));
 
-	int loc = (curr - (Transform3D*)transform_component->data);
-
-	ITU_EntityId id = transform_component->entity_ids[loc];
-	const char* entity_name = stbds_hmget(ctx_estorage.entities_debug_names, id);
-	ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_DrawLinesToNodes | ImGuiTreeNodeFlags_OpenOnArrow;
-	if(!curr->child_first)
-		flags |= ImGuiTreeNodeFlags_Leaf;
-	if(id.index == ctx_debug_window.loc_selected)
-		flags |= ImGuiTreeNodeFlags_Selected;
-
-	ImGui::PushID(loc);
-
-	// TODO FIXME this is terrible, but we can't afford NULL strings passed as id to Imgui
-	char buf_id[64];
-	if(entity_name)
-		SDL_snprintf(buf_id, 64, "%s", entity_name);
-	else
-		SDL_snprintf(buf_id, 64, "(%d %d)", id.generation, id.index);
-	
-	bool is_open = ImGui::TreeNodeEx(buf_id, flags);
-	if(ImGui::IsItemClicked())
+	// build component pool pointers (this requires component pools to be alredy set up)
+	for(int j = 0; j < COMPONENTS_COUNT_MAX; ++j)
 	{
-		SDL_Log("%s clicked", entity_name);
-		ctx_debug_window.detail_category = ITU_SYS_ESTORAGE_DETAIL_CATEGORY_ENTITY;
-		ctx_debug_window.loc_selected = id.index;
+		Uint64 component_bitmask = 1ll << j;
+		if(system_def->component_mask & component_bitmask)
+			system_runtime->components[system_runtime->components_count++] = ctx_estorage.components[j];
+	}
+	for(int j = 0; j < TAGS_COUNT_MAX; ++j)
+	{
+		Uint64 tag_bitmask = 1ll << j;
+		if(system_def->tag_mask & tag_bitmask)
+			system_runtime->tags[system_runtime->tags_count++] = j;
 	}
+	system_runtime->component_mask = system_def->component_mask;
+	system_runtime->tag_mask = system_def->tag_mask;
+	system_runtime->fn_update = system_def->fn_update;
+	system_runtime->name = system_def->name;
 
-	if(is_open)
+	system_runtime->exclusive = !system_def->component_mask_read && !system_def->component_mask_write;
+	if(system_runtime->exclusive)
 	{
-		if(curr->child_first)
-			do_transform_tree_recursive(transform_component, curr->child_first);
-		ImGui::TreePop();
-		ImGui::PopID();
+		system_runtime->component_mask_read  = ~0ull;
+		system_runtime->component_mask_write = ~0ull;
+	}
+	else
+	{
+		// writing implies reading
+		system_runtime->component_mask_read  = system_def->component_mask_read | system_def->component_mask_write;
+		system_runtime->component_mask_write = system_def->component_mask_write;
 	}
 
-	if(curr->sibling_next)
-		do_transform_tree_recursive(transform_component, curr->sibling_next);
+	SDL_assert((system_def->component_mask_changed & system_def->component_mask) == system_def->component_mask_changed);
+	system_runtime->component_mask_changed = system_def->component_mask_changed;
+	system_runtime->group = itu_group_find_for_system(system_runtime);
+	itu_system_schedule_set(system_runtime, system_def->schedule_mode, system_def->schedule_value);
+
+	system_runtime->members     = members;
+	system_runtime->members_loc = members_loc;
+	system_runtime->members_changed = members_changed;
+	// systems can be added after entities are created, so we need a full scan once
+	itu_system_members_rebuild(system_runtime);
 }
 
-void itu_sys_estorage_debug_render(SDLContext* context)
+bool itu_systems_conflict(ITU_System* a, ITU_System* b)
 {
-	ITU_EntityId selected_system_ids[ENTITIES_COUNT_MAX];
-	int selected_system_ids_count;
+	return (a->component_mask_write & b->component_mask_read)
+	    || (b->component_mask_write & a->component_mask_read);
+}
 
-	ImGui::BeginChild("debug_estorage_master", ImVec2(200, 0), ImGuiChildFlags_Border | ImGuiChildFlags_ResizeX);
+// builds the dependency graph between systems and flattens it into levels.
+// A system depends on every system registered before it that it conflicts with, so it's placed one level after the
+// latest of those. Systems that don't conflict keep running in registration order relative to their dependencies only.
+// Exclusive systems conflict with everything, so they always end up alone in their level
+void itu_systems_schedule()
+{
+	ctx_estorage.systems_levels_count = 0;
+	for(int i = 0; i < ctx_estorage.systems_count; ++i)
 	{
-		if(ImGui::CollapsingHeader("Transform Hierarchy", ImGuiTreeNodeFlags_DefaultOpen))
+		ITU_System* system = &ctx_estorage.systems[i];
+		system->level = 0;
+		for(int j = 0; j < i; ++j)
+		{
+			ITU_System* other = &ctx_estorage.systems[j];
+			if(itu_systems_conflict(system, other))
+				system->level = SDL_max(system->level, other->level + 1);
+		}
+		ctx_estorage.systems_levels_count = SDL_max(ctx_estorage.systems_levels_count, system->level + 1);
+	}
+}
+
+void itu_sys_estorage_set_systems(ITU_SystemDef* systems, int systems_count)
+{
+	SDL_assert(systems_count <= SYSTEMS_COUNT_MAX);
+
+	ctx_estorage.systems_count = systems_count;
+	for(int i = 0; i < systems_count; ++i)
+		itu_system_init(&ctx_estorage.systems[i], &systems[i]);
+
+	itu_systems_schedule();
+}
+
+void itu_sys_estorage_add_system(ITU_SystemDef system_def)
+{
+	if(ctx_estorage.systems_count == SYSTEMS_COUNT_MAX)
+	{
+		SDL_Log("WARNING maximum number of systes reached");
+		return;
+	}
+
+	itu_system_init(&ctx_estorage.systems[ctx_estorage.systems_count++], &system_def);
+	itu_systems_schedule();
+}
+
+// NOTE: wrap-around safe, ticks are only compared relative to each other
+inline bool itu_tick_is_newer(Uint32 tick, Uint32 tick_since)
+{
+	return tick != (Uint32)-1 && (Sint32)(tick - tick_since) > 0;
+}
+
+// runs the next batches of members until the budget runs out (or all of them got their turn).
+// Returns how many members were processed
+int itu_system_run_sliced(SDLContext* context, ITU_System* system, ITU_EntityId* entity_ids, int entity_ids_count)
+{
+	if(system->schedule_cursor >= entity_ids_count)
+		// members went away since the last update, start over
+		system->schedule_cursor = 0;
+
+	Uint64 time_beg = SDL_GetTicksNS();
+	Uint64 budget = (Uint64)(system->schedule_value * 1000.0f);
+	int processed_count = 0;
+	while(processed_count < entity_ids_count)
+	{
+		int batch_count = SDL_min(SYSTEM_TIME_SLICE_BATCH, entity_ids_count - system->schedule_cursor);
+		system->fn_update(context, entity_ids + system->schedule_cursor, batch_count);
+		system->schedule_cursor += batch_count;
+		processed_count += batch_count;
+
+		if(system->schedule_cursor == entity_ids_count)
+		{
+			// pass complete, that's how long every member waited between two updates
+			system->schedule_cursor = 0;
+			system->schedule_delta = system->schedule_time_since;
+			system->schedule_time_since = 0;
+		}
+		if(SDL_GetTicksNS() - time_beg >= budget)
+			break;
+	}
+
+	return processed_count;
+}
+
+// hands `entity_ids` to the system, according to its schedule. Returns how many members were processed
+int itu_system_run_update(SDLContext* context, ITU_System* system, ITU_EntityId* entity_ids, int entity_ids_count)
+{
+	if(system->schedule_mode == ITU_SYSTEM_SCHEDULE_EVERY_FRAME)
+	{
+		system->fn_update(context, entity_ids, entity_ids_count);
+		return entity_ids_count;
+	}
+
+	// exclusive systems run alone on the calling thread and may write to the context, so they get the real one.
+	// Everybody else gets a copy, since other systems could be reading `delta` at the same time
+	SDLContext context_scheduled;
+	float delta_prev = context->delta;
+	if(system->exclusive)
+		context->delta = system->schedule_delta;
+	else
+	{
+		context_scheduled = *context;
+		context_scheduled.delta = system->schedule_delta;
+		context = &context_scheduled;
+	}
+
+	int ret = entity_ids_count;
+	if(system->schedule_mode == ITU_SYSTEM_SCHEDULE_TIME_SLICED)
+		ret = itu_system_run_sliced(context, system, entity_ids, entity_ids_count);
+	else
+		system->fn_update(context, entity_ids, entity_ids_count);
+
+	if(system->exclusive)
+		context->delta = delta_prev;
+	return ret;
+}
+
+void itu_system_run(SDLContext* context, ITU_System* system)
+{
+	Uint64 time_beg = SDL_GetTicksNS();
+	int entities_count;
+
+	if(system->component_mask_changed && system->ran_once)
+	{
+		ITU_SparseIndex* versions[COMPONENTS_COUNT_MAX];
+		int versions_count = 0;
+		for(int i = 0; i < ctx_estorage.components_count; ++i)
+			if(system->component_mask_changed & (1ull << i))
+				versions[versions_count++] = &ctx_estorage.components[i]->versions;
+
+		// this is also a copy, so it works for exclusive systems too
+		stbds_arrsetlen(system->members_changed, 0);
+		for(int i = 0; i < stbds_arrlen(system->members); ++i)
+		{
+			ITU_EntityId id = system->members[i];
+			for(int j = 0; j < versions_count; ++j)
+				if(itu_tick_is_newer(itu_sparse_index_get(versions[j], id.index), system->tick_last_run))
+				{
+					stbds_arrput(system->members_changed, id);
+					break;
+				}
+		}
+
+		entities_count = itu_system_run_update(context, system, system->members_changed, stbds_arrlen(system->members_changed));
+	}
+	else if(system->exclusive)
+	{
+		// NOTE: exclusive systems are allowed to create/destroy entities and add/remove components, which changes
+		//       member lists while we iterate them, so they get a copy
+		//       (when copying from a group, data is still accessed in pool order)
+		int system_ids_count = stbds_arrlen(system->members);
+		ITU_ArenaTemp scratch = itu_lib_arena_scratch_begin(NULL);
+		ITU_EntityId* system_ids = arena_push_array(scratch.arena, ITU_EntityId, system_ids_count);
+		ITU_EntityId* system_ids_src = system->group == -1 ? system->members : itu_group_pool_first(&ctx_estorage.groups[system->group])->entity_ids;
+		SDL_memcpy(system_ids, system_ids_src, sizeof(ITU_EntityId) * system_ids_count);
+		entities_count = itu_system_run_update(context, system, system_ids, system_ids_count);
+		itu_lib_arena_scratch_end(scratch);
+	}
+	else
+	{
+		// member lists can't change while the structural lock is on, no need to copy.
+		// Systems matching a group get the group's ids instead, so that `itu_view` can index its pools directly
+		int system_ids_count = stbds_arrlen(system->members);
+		ITU_EntityId* system_ids = system->members;
+		if(system->group != -1)
+		{
+			ITU_ComponentGroup* group = &ctx_estorage.groups[system->group];
+			SDL_assert(group->count == system_ids_count);
+			system_ids = itu_group_pool_first(group)->entity_ids;
+		}
+		entities_count = itu_system_run_update(context, system, system_ids, system_ids_count);
+	}
+
+	system->tick_last_run = ctx_estorage.change_tick;
+	system->ran_once = true;
+
+	// every system runs on one thread only, nobody else is writing to its stats
+	ITU_SystemStats* stats = &system->stats[ctx_estorage.stats_frame];
+	stats->time_ms += (float)(SDL_GetTicksNS() - time_beg) / (float)MILLIS(1);
+	stats->entities_count += entities_count;
+	stats->calls_count++;
+}
+
+struct ITU_SystemsLevelJob
+{
+	SDLContext* context;
+	ITU_System* systems[SYSTEMS_COUNT_MAX];
+};
+
+void itu_systems_level_job(void* userdata, int idx_beg, int idx_end)
+{
+	ITU_SystemsLevelJob* job = (ITU_SystemsLevelJob*)userdata;
+	for(int i = idx_beg; i < idx_end; ++i)
+		itu_system_run(job->context, job->systems[i]);
+}
+
+void itu_sys_estorage_systems_update(SDLContext* context)
+{
+	ITU_SystemsLevelJob job;
+	job.context = context;
+
+	if(ctx_estorage.stats_frames_count == 0 || context->uptime != ctx_estorage.stats_uptime_last)
+	{
+		ctx_estorage.stats_frame = (ctx_estorage.stats_frame + 1) % SYSTEM_STATS_FRAMES_COUNT;
+		ctx_estorage.stats_frames_count = SDL_min(ctx_estorage.stats_frames_count + 1, SYSTEM_STATS_FRAMES_COUNT);
+		ctx_estorage.stats_uptime_last = context->uptime;
+		for(int i = 0; i < ctx_estorage.systems_count; ++i)
+			SDL_zero(ctx_estorage.systems[i].stats[ctx_estorage.stats_frame]);
+	}
+
+	for(int i = 0; i < ctx_estorage.systems_count; ++i)
+		itu_system_schedule_update(&ctx_estorage.systems[i], context->delta);
+
+	for(int level = 0; level < ctx_estorage.systems_levels_count; ++level)
+	{
+		int systems_count = 0;
+		for(int i = 0; i < ctx_estorage.systems_count; ++i)
+			if(ctx_estorage.systems[i].level == level && ctx_estorage.systems[i].schedule_run_now)
+				job.systems[systems_count++] = &ctx_estorage.systems[i];
+		if(systems_count == 0)
+			continue;
+
+		ctx_estorage.change_tick++;
+		if(systems_count == 1 && job.systems[0]->exclusive)
+		{
+			itu_system_run(context, job.systems[0]);
+		}
+		else
+		{
+			// a single system runs on the calling thread, so that it can still go wide with `itu_lib_jobs_parallel_for`
+			ctx_estorage.structural_lock = true;
+			if(systems_count == 1)
+				itu_system_run(context, job.systems[0]);
+			else
+				itu_lib_jobs_parallel_for(itu_systems_level_job, &job, systems_count, 1);
+			ctx_estorage.structural_lock = false;
+		}
+
+		// sync point: next level sees all the changes recorded by this one
+		ctx_estorage.change_tick++;
+		itu_sys_estorage_deferred_apply();
+	}
+}
+
+void itu_sys_estorage_system_set_schedule(ITU_SystemUpdateFunction fn_update, ITU_SystemScheduleMode schedule_mode, float schedule_value)
+{
+	for(int i = 0; i < ctx_estorage.systems_count; ++i)
+		if(ctx_estorage.systems[i].fn_update == fn_update)
+		{
+			itu_system_schedule_set(&ctx_estorage.systems[i], schedule_mode, schedule_value);
+			return;
+		}
+
+	SDL_Log("WARNING system not found\n");
+}
+
+bool itu_sys_estorage_chunks_next(ITU_EntityChunkIterator* it, ITU_EntityChunk* out_chunk)
+{
+	if(ctx_estorage.storage_mode != ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		SDL_Log("WARNING chunk iteration is only available in archetype storage mode");
+		return false;
+	}
+
+	for(; it->archetype_idx < ctx_estorage.archetypes_count; ++it->archetype_idx, it->chunk_idx = 0)
+	{
+		ITU_Archetype* archetype = ctx_estorage.archetypes[it->archetype_idx];
+		if((archetype->component_mask & it->component_mask) != it->component_mask)
+			continue;
+
+		int row_first = it->chunk_idx * archetype->chunk_capacity;
+		if(row_first >= archetype->count_alive)
+			continue;
+
+		unsigned char* chunk = archetype->chunks[it->chunk_idx];
+		out_chunk->count          = SDL_min(archetype->chunk_capacity, archetype->count_alive - row_first);
+		out_chunk->component_mask = archetype->component_mask;
+		out_chunk->entity_ids     = (ITU_EntityId*)chunk;
+		out_chunk->data           = chunk;
+		out_chunk->column_offsets = archetype->column_offsets;
+
+		++it->chunk_idx;
+		return true;
+	}
+
+	return false;
+}
+
+void* itu_entity_chunk_column(ITU_EntityChunk* chunk, ITU_ComponentType component_type)
+{
+	SDL_assert(chunk->component_mask & (1ull << component_type));
+	return chunk->data + chunk->column_offsets[component_type];
+}
+
+void itu_sys_estorage_component_view(ITU_ComponentType component_type, ITU_ComponentView* out_view)
+{
+	SDL_assert(component_type < ctx_estorage.components_count);
+	ITU_Component* component = ctx_estorage.components[component_type];
+
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		out_view->data = NULL;
+		out_view->data_loc_pages = NULL;
+		out_view->version_pages = component->versions.pages;
+		out_view->group_entity_ids = NULL;
+		out_view->group_count = 0;
+		return;
+	}
+
+	out_view->data = (unsigned char*)component->data;
+	out_view->data_loc_pages = component->data_loc.pages;
+	out_view->version_pages = component->versions.pages;
+	out_view->group_entity_ids = NULL;
+	out_view->group_count = 0;
+	if(component->group != -1)
+	{
+		ITU_ComponentGroup* group = &ctx_estorage.groups[component->group];
+		out_view->group_entity_ids = itu_group_pool_first(group)->entity_ids;
+		out_view->group_count = group->count;
+	}
+}
+
+int itu_sys_estorage_component_count(ITU_ComponentType component_type)
+{
+	SDL_assert(component_type < ctx_estorage.components_count);
+	return ctx_estorage.components[component_type]->count_alive;
+}
+
+int itu_sys_estorage_group_add(Uint64 component_mask)
+{
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
+
+	if(ctx_estorage.storage_mode != ITU_ENTITY_STORAGE_MODE_SPARSE_SET)
+	{
+		SDL_Log("WARNING component groups are only supported in sparse set storage mode");
+		return -1;
+	}
+	if((component_mask & (component_mask - 1)) == 0)
+	{
+		SDL_Log("WARNING component groups need at least two components");
+		return -1;
+	}
+	if(ctx_estorage.groups_count >= GROUPS_COUNT_MAX)
+	{
+		SDL_Log("WARNING too many component groups");
+		return -1;
+	}
+	for(Uint64 bits = component_mask; bits; bits &= bits - 1)
+	{
+		int i = bit_index_lowest(bits);
+		if(i >= ctx_estorage.components_count)
+		{
+			SDL_Log("WARNING component type %d is not enabled\n", i);
+			return -1;
+		}
+		if(ctx_estorage.components[i]->group != -1)
+		{
+			SDL_Log("WARNING component %s is already in a group\n", ctx_estorage.components[i]->name);
+			return -1;
+		}
+		// NOTE: the hierarchy keeps its own order in the Transform3D pool (see `transform_hierarchy_sort`)
+		if(itu_component_is_transform3D(i))
+		{
+			SDL_Log("WARNING Transform3D can't be in a component group\n");
+			return -1;
+		}
+	}
+
+	int group_idx = ctx_estorage.groups_count++;
+	ITU_ComponentGroup* group = &ctx_estorage.groups[group_idx];
+	group->component_mask = component_mask;
+	group->count = 0;
+
+	ITU_Component* component_smallest = NULL;
+	for(Uint64 bits = component_mask; bits; bits &= bits - 1)
+	{
+		ITU_Component* component = ctx_estorage.components[bit_index_lowest(bits)];
+		component->group = group_idx;
+		if(!component_smallest || component->count_alive < component_smallest->count_alive)
+			component_smallest = component;
+	}
+
+	// groups can be added after entities are created. Entering shuffles the pools, so we walk a copy
+	ITU_ArenaTemp scratch = itu_lib_arena_scratch_begin(NULL);
+	int ids_count = component_smallest->count_alive;
+	ITU_EntityId* ids = arena_push_array(scratch.arena, ITU_EntityId, ids_count);
+	SDL_memcpy(ids, component_smallest->entity_ids, sizeof(ITU_EntityId) * ids_count);
+	for(int i = 0; i < ids_count; ++i)
+		if((ctx_estorage.entities[ids[i].index].component_mask & component_mask) == component_mask)
+			itu_group_enter(group, ids[i]);
+	itu_lib_arena_scratch_end(scratch);
+
+	for(int i = 0; i < ctx_estorage.systems_count; ++i)
+		ctx_estorage.systems[i].group = itu_group_find_for_system(&ctx_estorage.systems[i]);
+
+	return group_idx;
+}
+
+int itu_sys_estorage_group_get(int group_idx, ITU_EntityId** out_entity_ids)
+{
+	SDL_assert(group_idx >= 0 && group_idx < ctx_estorage.groups_count);
+	ITU_ComponentGroup* group = &ctx_estorage.groups[group_idx];
+	*out_entity_ids = itu_group_pool_first(group)->entity_ids;
+	return group->count;
+}
+
+enum ITU_SysEstorageDebugDetailCategory { ITU_SYS_ESTORAGE_DETAIL_CATEGORY_ENTITY, ITU_SYS_ESTORAGE_DETAIL_CATEGORY_SYSTEM, ITU_SYS_ESTORAGE_DETAIL_CATEGORY_COMPONENT, ITU_SYS_ESTORAGE_DETAIL_CATEGORY_MAX };
+
+struct ITU_DebugWindowCtx
+{
+	
+	// TODO make this into a context struct
+	ITU_SysEstorageDebugDetailCategory detail_category = ITU_SYS_ESTORAGE_DETAIL_CATEGORY_MAX;
+	int loc_selected = -1;
+};
+ITU_DebugWindowCtx ctx_debug_window = { ITU_SYS_ESTORAGE_DETAIL_CATEGORY_MAX, -1 };
+
+void itu_sys_estorage_debug_render_detail_entity(SDLContext* context, ITU_EntityId id)
+{
+	if(!itu_entity_is_valid(id))
+	{
+		ImGui::Text("INVALID ENTITY");
+		return;
+	}
+	// TODO wrap tag list rendering in appropriate function
+	{
+		ImGui::CollapsingHeader("tags", ImGuiTreeNodeFlags_Leaf);
+		int num_tags = 0;
+		Uint64 tag_mask = ctx_estorage.entities[id.index].tag_mask;
+		for(int i = 0; i < TAGS_COUNT_MAX; ++i)
+		{
+			if(!(tag_mask & (1ull << i)))
+				continue;
+
+			++num_tags;
+			// TODO also wrap single tag (idx + name) rendering in appropriate function
+			int loc_tag_name = stbds_hmgeti(ctx_estorage.tag_debug_names, i);
+			if(loc_tag_name == -1)
+				ImGui::Text("%3d", i);
+			else
+				ImGui::Text("%3d: %s", i, ctx_estorage.tag_debug_names[loc_tag_name].value);
+		}
+		if(num_tags == 0)
+			ImGui::Text("none");
+	}
+
+	for(int i = 0; i < ctx_estorage.components_count; ++i)
+	{
+		void* component_data = itu_entity_data_get(id, i);
+
+		if(!component_data)
+			continue;
+
+		ImGui::CollapsingHeader(ctx_estorage.components[i]->name, ImGuiTreeNodeFlags_Leaf);
+		{
+			if(ctx_estorage.components[i]->fn_debug_ui_render)
+				ctx_estorage.components[i]->fn_debug_ui_render(context, component_data);
+			else
+				ImGui::Text("TODO NotYetImplemented");
+		}
+	}
+}
+
+// over the frames currently in the stats ring buffer where the system actually ran (scheduled systems skip frames,
+// and counting those as 0 ms would drag min and avg down). Returns how many frames were used
+int itu_system_stats_time_range(ITU_System* system, float* out_min, float* out_avg, float* out_max)
+{
+	*out_min = *out_avg = *out_max = 0;
+	int frames_ran_count = 0;
+	float time_min = FLT_MAX;
+	for(int i = 0; i < ctx_estorage.stats_frames_count; ++i)
+	{
+		ITU_SystemStats* stats = &system->stats[(ctx_estorage.stats_frame - i + SYSTEM_STATS_FRAMES_COUNT) % SYSTEM_STATS_FRAMES_COUNT];
+		if(stats->calls_count == 0)
+			continue;
+
+		time_min = SDL_min(time_min, stats->time_ms);
+		*out_max = SDL_max(*out_max, stats->time_ms);
+		*out_avg += stats->time_ms;
+		++frames_ran_count;
+	}
+
+	if(frames_ran_count == 0)
+		return 0;
+
+	*out_min = time_min;
+	*out_avg /= frames_ran_count;
+	return frames_ran_count;
+}
+
+float itu_system_stats_get_entities_count(void* data, int idx)
+{
+	return (float)((ITU_SystemStats*)data)[idx].entities_count;
+}
+
+// oldest frame first, so that the plot scrolls to the left
+void itu_system_stats_plot_time(const char* label, ITU_System* system, ImVec2 size)
+{
+	int oldest = (ctx_estorage.stats_frame + 1) % SYSTEM_STATS_FRAMES_COUNT;
+	ImGui::PlotLines(label, &system->stats[0].time_ms, SYSTEM_STATS_FRAMES_COUNT, oldest, NULL, 0, FLT_MAX, size, sizeof(ITU_SystemStats));
+}
+
+void itu_sys_estorage_debug_render_detail_system(SDLContext* context, ITU_System* system)
+{
+	ImGui::CollapsingHeader("timing", ImGuiTreeNodeFlags_Leaf);
+	{
+		ITU_SystemStats* stats_last = &system->stats[ctx_estorage.stats_frame];
+		float time_min, time_avg, time_max;
+		int frames_ran_count = itu_system_stats_time_range(system, &time_min, &time_avg, &time_max);
+		ImGui::Text("last frame: %6.3f ms, %d entities, %d calls", stats_last->time_ms, stats_last->entities_count, stats_last->calls_count);
+		ImGui::Text("ran in %d of the last %d frames: %6.3f min %6.3f avg %6.3f max (ms)", frames_ran_count, ctx_estorage.stats_frames_count, time_min, time_avg, time_max);
+		itu_system_stats_plot_time("ms", system, ImVec2(0, 48));
+
+		int oldest = (ctx_estorage.stats_frame + 1) % SYSTEM_STATS_FRAMES_COUNT;
+		ImGui::PlotLines("entities", itu_system_stats_get_entities_count, system->stats, SYSTEM_STATS_FRAMES_COUNT, oldest, NULL, 0, FLT_MAX, ImVec2(0, 48));
+	}
+
+	ImGui::CollapsingHeader("schedule", ImGuiTreeNodeFlags_Leaf);
+	switch(system->schedule_mode)
+	{
+		case ITU_SYSTEM_SCHEDULE_EVERY_FRAME:   ImGui::Text("every frame"); break;
+		case ITU_SYSTEM_SCHEDULE_EVERY_N_FRAMES: ImGui::Text("every %d frames", (int)system->schedule_value); break;
+		case ITU_SYSTEM_SCHEDULE_FIXED_RATE:    ImGui::Text("%.1f Hz", system->schedule_value); break;
+		case ITU_SYSTEM_SCHEDULE_TIME_SLICED:
+			ImGui::Text("time sliced, %.0f us budget", system->schedule_value);
+			ImGui::Text("next member: %d/%d, last full pass: %.3f s", system->schedule_cursor, (int)stbds_arrlen(system->members), system->schedule_delta);
+			break;
+	}
+
+	ImGui::CollapsingHeader("components", ImGuiTreeNodeFlags_Leaf);
+	for(int i = 0; i < system->components_count; ++i)
+		ImGui::Text("%s", system->components[i]->name);
+
+	ImGui::CollapsingHeader("access", ImGuiTreeNodeFlags_Leaf);
+	if(system->exclusive)
+		ImGui::Text("exclusive");
+	else
+		for(int i = 0; i < ctx_estorage.components_count; ++i)
+		{
+			Uint64 component_bit = 1ull << i;
+			if(system->component_mask_write & component_bit)
+				ImGui::Text("%s (write)", ctx_estorage.components[i]->name);
+			else if(system->component_mask_read & component_bit)
+				ImGui::Text("%s (read)", ctx_estorage.components[i]->name);
+		}
+
+	if(system->component_mask_changed)
+	{
+		ImGui::CollapsingHeader("changed filter", ImGuiTreeNodeFlags_Leaf);
+		for(int i = 0; i < ctx_estorage.components_count; ++i)
+			if(system->component_mask_changed & (1ull << i))
+				ImGui::Text("%s", ctx_estorage.components[i]->name);
+		ImGui::Text("last run: %d/%d entities", (int)stbds_arrlen(system->members_changed), (int)stbds_arrlen(system->members));
+	}
+
+	// TODO wrap tag list rendering in appropriate function
+	{
+		ImGui::CollapsingHeader("tags", ImGuiTreeNodeFlags_Leaf);
+		int num_tags = 0;
+		for(int i = 0; i < system->tags_count; ++i)
+		{
+			++num_tags;
+			// TODO also wrap single tag (idx + name) rendering in appropriate function
+			int tag = system->tags[i];
+			int loc_tag_name = stbds_hmgeti(ctx_estorage.tag_debug_names, tag);
+			if(loc_tag_name == -1)
+				ImGui::Text("%3d", tag);
+			else
+				ImGui::Text("%3d: %s", tag, ctx_estorage.tag_debug_names[loc_tag_name].value);
+		}
+		if(num_tags == 0)
+			ImGui::Text("none");
+	}
+
+	ImGui::CollapsingHeader("currently iterated entities", ImGuiTreeNodeFlags_Leaf);
+	ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
+	for(int i = 0; i < stbds_arrlen(system->members); ++i)
+	{
+		char buf[8];
+		SDL_snprintf(buf, 8, "%d", i);
+		itu_debug_ui_widget_entityid((char*)buf, system->members[i]);
+	}
+	ImGui::PopStyleVar();
+}
+
+void itu_sys_estorage_debug_render_detail_component(SDLContext* context, ITU_Component* component)
+{
+	// archetype chunks
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		if(ImGui::BeginTable("entities", 2, ImGuiTableFlags_SizingFixedFit))
+		{
+			ImGui::TableSetupColumn("entity");
+			ImGui::TableSetupColumn("archetype:row");
+			ImGui::TableHeadersRow();
+
+			ITU_EntityChunkIterator it = { 1ull << component->type };
+			ITU_EntityChunk chunk;
+			while(itu_sys_estorage_chunks_next(&it, &chunk))
+				for(int i = 0; i < chunk.count; ++i)
+				{
+					ITU_EntityId id = chunk.entity_ids[i];
+					ImGui::TableNextRow();
+
+					ImGui::TableNextColumn();
+					itu_debug_ui_widget_entityid_tablerow(id);
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%d:%d", ctx_estorage.entities[id.index].archetype, ctx_estorage.entities[id.index].archetype_row);
+				}
+			ImGui::EndTable();
+		}
+		return;
+	}
+
+	// sparse array
+	{
+		if(component->group != -1)
+			ImGui::Text("group %d: first %d entities shared with the other pools in the group", component->group, ctx_estorage.groups[component->group].count);
+
+		if(ImGui::BeginTable("entities", 2, ImGuiTableFlags_SizingFixedFit))
+		{
+			ImGui::TableSetupColumn("entity");
+			ImGui::TableSetupColumn("location");
+			ImGui::TableHeadersRow();
+
+			for(int i = 0; i < component->count_alive; ++i)
+			{
+				ITU_EntityId id = component->entity_ids[i];
+				ImGui::TableNextRow();
+
+				ImGui::TableNextColumn();
+				itu_debug_ui_widget_entityid_tablerow(id);
+
+				ImGui::TableNextColumn();
+				ImGui::Text("%d", i);
+			}
+			ImGui::EndTable();
+		}
+	}
+
+	//ImGui::SameLine();
+	//// locations
+	//{
+	//}
+	// data?
+}
+
+int itu_sys_estorage_list_entities_alive(ITU_EntityId* arr_entities, int arr_entities_max)
+{
+	int entities_count = stbds_arrlen(ctx_estorage.entities);
+
+	int ret = 0;
+	for(int i = 0; i < entities_count; ++i)
+		if(itu_entity_is_valid(ctx_estorage.entities[i].id))
+			arr_entities[ret++] = ctx_estorage.entities[i].id;
+
+	return ret;
+}
+
+void itu_sys_estorage_debug_render_entity_table()
+{
+	int entities_count = stbds_arrlen(ctx_estorage.entities);
+	if(ImGui::BeginTable("debug_estorage_master_entities", 5, ImGuiTableFlags_SizingFixedFit))
+	{
+		ImGui::TableSetupColumn("##col_del");
+		ImGui::TableSetupColumn("##col_idx");
+		ImGui::TableSetupColumn("name");
+		ImGui::TableSetupColumn("gen");
+		ImGui::TableSetupColumn("idx");
+		ImGui::TableHeadersRow();
+		int row_idx = 0;
+		for(int i = 0; i < entities_count; ++i)
+		{
+			ITU_EntityId id = ctx_estorage.entities[i].id;
+			if(!itu_entity_is_valid(id))
+				continue;
+			ImGui::TableNextRow();
+
+			ImGui::TableNextColumn();
+			char buf_del[48];
+			ImGui::PushID(i);
+			//SDL_snprintf(buf_del, 48, "X##%3ddebug_estorage_master_entities", row_idx);
+			if(ImGui::Button("X"))
+			{
+				itu_entity_destroy(id);
+				ctx_debug_window.loc_selected = -1;
+			}
+
+			ImGui::TableNextColumn();
+			char buf_id[48];
+			SDL_snprintf(buf_id, 48, "%3d##debug_estorage_master_entities", row_idx);
+			if(ImGui::Selectable(
+				"",
+				ctx_debug_window.detail_category == ITU_SYS_ESTORAGE_DETAIL_CATEGORY_ENTITY && row_idx == ctx_debug_window.loc_selected,
+				ImGuiSelectableFlags_SpanAllColumns
+			))
+			{
+				ctx_debug_window.loc_selected = i;
+				ctx_debug_window.detail_category = ITU_SYS_ESTORAGE_DETAIL_CATEGORY_ENTITY;
+			}
+
+			ImGui::TableNextColumn();
+			const char* debug_name = itu_entity_get_debug_name(id);
+			if(debug_name)
+				ImGui::Text("%s", debug_name);
+
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%d", id.generation);
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%d", id.index);
+			ImGui::PopID();
+			++row_idx;
+		}
+
+		ImGui::EndTable();
+	}
+}
+
+void do_transform_tree_recursive(Uint32 index)
+{
+	if(index == TRANSFORM3D_INDEX_NULL)
+		return;
+
+	ITU_EntityId id = itu_entity_id_from_index(index);
+	Transform3D* curr = transform_hierarchy_get(index);
+	const char* entity_name = itu_entity_get_debug_name(id);
+	ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_DrawLinesToNodes | ImGuiTreeNodeFlags_OpenOnArrow;
+	if(curr->child_first == TRANSFORM3D_INDEX_NULL)
+		flags |= ImGuiTreeNodeFlags_Leaf;
+	if(id.index == ctx_debug_window.loc_selected)
+		flags |= ImGuiTreeNodeFlags_Selected;
+
+	ImGui::PushID(index);
+
+	// TODO FIXME this is terrible, but we can't afford NULL strings passed as id to Imgui
+	char buf_id[64];
+	if(entity_name)
+		SDL_snprintf(buf_id, 64, "%s", entity_name);
+	else
+		SDL_snprintf(buf_id, 64, "(%d %d)", id.generation, id.index);
+	
+	bool is_open = ImGui::TreeNodeEx(buf_id, flags);
+	if(ImGui::IsItemClicked())
+	{
+		SDL_Log("%s clicked", entity_name);
+		ctx_debug_window.detail_category = ITU_SYS_ESTORAGE_DETAIL_CATEGORY_ENTITY;
+		ctx_debug_window.loc_selected = id.index;
+	}
+
+	if(is_open)
+	{
+		do_transform_tree_recursive(curr->child_first);
+		ImGui::TreePop();
+		ImGui::PopID();
+	}
+
+	do_transform_tree_recursive(curr->sibling_next);
+}
+
+void itu_sys_estorage_debug_render(SDLContext* context)
+{
+	ImGui::BeginChild("debug_estorage_master", ImVec2(200, 0), ImGuiChildFlags_Border | ImGuiChildFlags_ResizeX);
+	{
+		if(itu_component_is_transform3D(ITU_COMPONENT_TYPE_Transform3D) && ImGui::CollapsingHeader("Transform Hierarchy", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			// tree structure with index links
+			do_transform_tree_recursive(ctx_transform.root_first);
+		}
+
+		if(ImGui::CollapsingHeader("Entities", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			// linear tabulated list of entities
+			itu_sys_estorage_debug_render_entity_table();
+		}
+
+		if(ImGui::CollapsingHeader("Systems", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			if(ImGui::BeginTable("debug_estorage_master_systems", 10, ImGuiTableFlags_SizingFixedFit))
+			{
+				ImGui::TableSetupColumn("");
+				ImGui::TableSetupColumn("name");
+				ImGui::TableSetupColumn("comp");
+				ImGui::TableSetupColumn("tags");
+				ImGui::TableSetupColumn("entities");
+				ImGui::TableSetupColumn("level");
+				ImGui::TableSetupColumn("ms min");
+				ImGui::TableSetupColumn("ms avg");
+				ImGui::TableSetupColumn("ms max");
+				ImGui::TableSetupColumn("history");
+				ImGui::TableHeadersRow();
+				for(int i = 0; i < ctx_estorage.systems_count; ++i)
+				{
+					ITU_System* system = &ctx_estorage.systems[i];
+					ImGui::TableNextRow();
+
+					ImGui::TableNextColumn();
+					char buf_id[48];
+					SDL_snprintf(buf_id, 48, "%3d##debug_estorage_master_systems", i);
+					if(ImGui::Selectable(
+						buf_id,
+						ctx_debug_window.detail_category == ITU_SYS_ESTORAGE_DETAIL_CATEGORY_SYSTEM && i == ctx_debug_window.loc_selected,
+						ImGuiSelectableFlags_SpanAllColumns
+					))
+					{
+						ctx_debug_window.loc_selected = i;
+						ctx_debug_window.detail_category = ITU_SYS_ESTORAGE_DETAIL_CATEGORY_SYSTEM;
+					}
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", system->name);
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", system->components_count);
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", system->tags_count);
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", (int)stbds_arrlen(system->members));
+
+					ImGui::TableNextColumn();
+					if(system->exclusive)
+						ImGui::Text("%d (excl)", system->level);
+					else
+						ImGui::Text("%d", system->level);
+
+					float time_min, time_avg, time_max;
+					itu_system_stats_time_range(system, &time_min, &time_avg, &time_max);
+					ImGui::TableNextColumn();
+					ImGui::Text("%6.3f", time_min);
+					ImGui::TableNextColumn();
+					ImGui::Text("%6.3f", time_avg);
+					ImGui::TableNextColumn();
+					ImGui::Text("%6.3f", time_max);
+
+					ImGui::TableNextColumn();
+					SDL_snprintf(buf_id, 48, "##debug_estorage_master_systems_history%d", i);
+					itu_system_stats_plot_time(buf_id, system, ImVec2(80, ImGui::GetTextLineHeight()));
+				}
+
+				ImGui::EndTable();
+			}
+		}
+
+		if(ImGui::CollapsingHeader("Components", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			if(ImGui::BeginTable("debug_estorage_master_components", 4, ImGuiTableFlags_SizingFixedFit))
+			{
+				ImGui::TableSetupColumn("");
+				ImGui::TableSetupColumn("name");
+				ImGui::TableSetupColumn("alive");
+				ImGui::TableSetupColumn("capacity");
+				ImGui::TableHeadersRow();
+				for(int i = 0; i < ctx_estorage.components_count; ++i)
+				{
+					ITU_Component* component = ctx_estorage.components[i];
+					ImGui::TableNextRow();
+
+					ImGui::TableNextColumn();
+					char buf_id[48];
+					SDL_snprintf(buf_id, 48, "%3d##debug_estorage_master_components", i);
+					if(ImGui::Selectable(
+						buf_id,
+						ctx_debug_window.detail_category == ITU_SYS_ESTORAGE_DETAIL_CATEGORY_COMPONENT && i == ctx_debug_window.loc_selected,
+						ImGuiSelectableFlags_SpanAllColumns
+					))
+					{
+						ctx_debug_window.loc_selected = i;
+						ctx_debug_window.detail_category = ITU_SYS_ESTORAGE_DETAIL_CATEGORY_COMPONENT;
+					}
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", component->name);
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", component->count_alive);
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", component->count_max);
+				}
+
+				ImGui::EndTable();
+			}
+		}
+
+		if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE && ImGui::CollapsingHeader("Archetypes", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			if(ImGui::BeginTable("debug_estorage_master_archetypes", 4, ImGuiTableFlags_SizingFixedFit))
+			{
+				ImGui::TableSetupColumn("mask");
+				ImGui::TableSetupColumn("alive");
+				ImGui::TableSetupColumn("chunks");
+				ImGui::TableSetupColumn("per chunk");
+				ImGui::TableHeadersRow();
+				for(int i = 0; i < ctx_estorage.archetypes_count; ++i)
+				{
+					ITU_Archetype* archetype = ctx_estorage.archetypes[i];
+					ImGui::TableNextRow();
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%016llx", (unsigned long long)archetype->component_mask);
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", archetype->count_alive);
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", (int)stbds_arrlen(archetype->chunks));
+
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", archetype->chunk_capacity);
+				}
+
+				ImGui::EndTable();
+			}
+		}
+		ImGui::EndChild();
+	}
+	ImGui::SameLine();
+
+	ImGui::BeginChild("debug_estorage_detail", ImVec2(0, 0), ImGuiChildFlags_Border);
+	{
+		if(ctx_debug_window.loc_selected != -1)
+			switch(ctx_debug_window.detail_category)
+			{
+				case ITU_SYS_ESTORAGE_DETAIL_CATEGORY_ENTITY   : itu_sys_estorage_debug_render_detail_entity(context, ctx_estorage.entities[ctx_debug_window.loc_selected].id); break;
+				case ITU_SYS_ESTORAGE_DETAIL_CATEGORY_SYSTEM   : itu_sys_estorage_debug_render_detail_system(context, &ctx_estorage.systems[ctx_debug_window.loc_selected]); break;
+				case ITU_SYS_ESTORAGE_DETAIL_CATEGORY_COMPONENT: itu_sys_estorage_debug_render_detail_component(context, ctx_estorage.components[ctx_debug_window.loc_selected]); break;
+				default: /* do nothing */ break;
+			}
+		ImGui::EndChild();
+	}
+	
+	//ImGui::End();
+}
+
+void itu_sys_estorage_tag_set_debug_name(int tag, const char* tag_debug_name)
+{
+	stbds_hmput(ctx_estorage.tag_debug_names, tag, tag_debug_name);
+}
+
+void itu_sys_estorage_tag_enable_members(ITU_TagType tag)
+{
+	SDL_assert(tag < TAGS_COUNT_MAX);
+	ITU_ComponentTag* tag_storage = &ctx_estorage.tags[tag];
+	if(tag_storage->tracked)
+		return;
+
+	tag_storage->tracked = true;
+
+	// tag can be enabled after entities are already tagged
+	int entities_count = stbds_arrlen(ctx_estorage.entities);
+	for(int i = 0; i < entities_count; ++i)
+	{
+		ITU_EntityId id = ctx_estorage.entities[i].id;
+		if(itu_entity_is_valid(id) && (ctx_estorage.entities[i].tag_mask & (1ull << tag)))
+			itu_tag_members_add(tag_storage, id);
+	}
+}
+
+int itu_sys_estorage_tag_get_members(ITU_TagType tag, ITU_EntityId** out_entity_ids)
+{
+	SDL_assert(tag < TAGS_COUNT_MAX);
+	ITU_ComponentTag* tag_storage = &ctx_estorage.tags[tag];
+	if(!tag_storage->tracked)
+	{
+		SDL_Log("WARNING tag %d is not tracked, call `itu_sys_estorage_tag_enable_members` first", tag);
+		*out_entity_ids = NULL;
+		return 0;
+	}
+
+	*out_entity_ids = tag_storage->entity_ids;
+	return stbds_arrlen(tag_storage->entity_ids);
+}
+
+void itu_component_pool_assign(ITU_Component* component_pool, ITU_EntityId entity)
+{
+	SDL_assert(component_pool);
+	itu_component_pool_reserve(component_pool, component_pool->count_alive + 1);
+
+	// TODO check that requested entry is actually free
+
+	Uint32 i = component_pool->count_alive++;
+	itu_sparse_index_set(&component_pool->data_loc, entity.index, i);
+	component_pool->entity_ids[i] = entity;
+	SDL_memset((unsigned char*)component_pool->data + component_pool->element_size * i, 0, component_pool->element_size);
+}
+
+void itu_component_pool_data_get(ITU_Component* component_pool, ITU_EntityId entity, void* out_data_copy)
+{
+	SDL_assert(component_pool);
+
+	Uint32 loc = itu_sparse_index_get(&component_pool->data_loc, entity.index);
+	void* data = pointer_offset(void, component_pool->data, component_pool->element_size * loc);
+	SDL_memcpy(out_data_copy, data, component_pool->element_size);
+}
+
+void itu_component_pool_data_set(ITU_Component* component_pool, ITU_EntityId entity, void* in_data_copy)
+{
+	SDL_assert(component_pool);
+
+	Uint32 loc = itu_sparse_index_get(&component_pool->data_loc, entity.index);
+	void* data = pointer_offset(void, component_pool->data, component_pool->element_size * loc);
+	SDL_memcpy(data, in_data_copy, component_pool->element_size);
+}
+
+void itu_component_pool_remove(ITU_Component* component_pool, ITU_EntityId entity)
+{
+	SDL_assert(component_pool);
+	Uint32 loc_curr = itu_sparse_index_get(&component_pool->data_loc, entity.index);
+	Uint32 loc_last = component_pool->count_alive - 1;
+	SDL_assert(loc_curr != (Uint32)-1);
+	SDL_assert(loc_curr < (Uint32)component_pool->count_alive);
+
+	ITU_EntityId entity_swap = component_pool->entity_ids[loc_last];
+	component_pool->entity_ids[loc_curr] = component_pool->entity_ids[loc_last];
+
+	void* ptr_curr = pointer_offset(void, component_pool->data, loc_curr * component_pool->element_size);
+	void* ptr_last = pointer_offset(void, component_pool->data, loc_last * component_pool->element_size);
+	SDL_memcpy(ptr_curr, ptr_last, component_pool->element_size);
+	itu_sparse_index_set(&component_pool->data_loc, entity_swap.index, loc_curr);
+	itu_sparse_index_set(&component_pool->data_loc, entity.index, -1);
+
+	component_pool->count_alive--;
+}
+
+void itu_component_pool_clear(ITU_Component* component_pool)
+{
+	SDL_assert(component_pool);
+
+	component_pool->count_alive = 0;
+	itu_sparse_index_clear(&component_pool->data_loc);
+}
+
+
+// new entities start in the archetype with no components, so systems that only filter by tags still find them
+void itu_entity_archetype_place(ITU_Entity* entity)
+{
+	int archetype_idx = itu_archetype_get_or_create(0);
+	entity->archetype = archetype_idx;
+	entity->archetype_row = itu_archetype_row_alloc(ctx_estorage.archetypes[archetype_idx], entity->id);
+}
+
+ITU_EntityId itu_entity_create()
+{
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
+	if(stbds_arrlen(ctx_estorage.entities_free) > 0)
+	{
+		ITU_EntityId id_recycled = stbds_arrpop(ctx_estorage.entities_free);
+		ctx_estorage.entities[id_recycled.index].id.index = id_recycled.index;
+		ctx_estorage.entities[id_recycled.index].id.generation = id_recycled.generation + 1;
+		if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+			itu_entity_archetype_place(&ctx_estorage.entities[id_recycled.index]);
+		itu_systems_members_refresh(ctx_estorage.entities[id_recycled.index].id);
+		return ctx_estorage.entities[id_recycled.index].id;
+	}
+
+	ITU_Entity entity_data;
+	entity_data.id.generation = 0;
+	entity_data.id.index = stbds_arrlen(ctx_estorage.entities);
+	entity_data.component_mask = 0;
+	entity_data.tag_mask = 0;
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+		itu_entity_archetype_place(&entity_data);
+	stbds_arrput(ctx_estorage.entities, entity_data);
+	itu_systems_members_refresh(entity_data.id);
+
+	return entity_data.id;
+}
+
+void  itu_entity_set_debug_name(ITU_EntityId id, const char* debug_name)
+{
+	if(!itu_entity_is_valid(id))
+	{
+		SDL_Log("WARNING invalid entity\n");
+		return;
+	}
+
+	// names array only grows when somebody actually uses names, entities without one don't pay for it
+	int len = stbds_arrlen(ctx_estorage.entities_debug_names);
+	if(id.index >= (Uint32)len)
+	{
+		stbds_arrsetlen(ctx_estorage.entities_debug_names, stbds_arrlen(ctx_estorage.entities));
+		SDL_memset(ctx_estorage.entities_debug_names + len, 0, sizeof(const char*) * (stbds_arrlen(ctx_estorage.entities_debug_names) - len));
+	}
+
+	ctx_estorage.entities_debug_names[id.index] = itu_lib_strings_intern(debug_name);
+}
+
+const char* itu_entity_get_debug_name(ITU_EntityId id)
+{
+	if(!itu_entity_is_valid(id) || id.index >= (Uint32)stbds_arrlen(ctx_estorage.entities_debug_names))
+		return NULL;
+	return ctx_estorage.entities_debug_names[id.index];
+}
+
+bool itu_entity_equals(ITU_EntityId a, ITU_EntityId b)
+{
+	return a.generation == b.generation && a.index == b.index;
+}
+
+bool itu_entity_is_valid(ITU_EntityId id)
+{
+	return id.index < stbds_arrlen(ctx_estorage.entities) && ctx_estorage.entities[id.index].id.generation == id.generation;
+}
+
+ITU_EntityId itu_entity_id_from_index(Uint32 index)
+{
+	SDL_assert(index < stbds_arrlen(ctx_estorage.entities));
+	ITU_EntityId ret;
+	ret.index = index;
+	ret.generation = ctx_estorage.entities[index].id.generation;
+	return ret;
+}
+
+// Transform3D data holds the hierarchy links, they have to be kept up to date on add/remove.
+// (comparing names because the component type is 0 when Transform3D is not enabled)
+static bool itu_component_is_transform3D(ITU_ComponentType component_type)
+{
+	return component_type < ctx_estorage.components_count && ctx_estorage.components[component_type]->name == ITU_COMPONENT_NAME_Transform3D;
+}
+
+void itu_entity_id_to_stringid(ITU_EntityId id, char* buffer, int max_len)
+{
+	// NOTE: this is super slow, but we have to do this if we want to leverage imgui for out UI toolkit
+	SDL_snprintf(buffer, max_len, "%d-%d", id.generation, id.index);
+}
+
+// `in_data_copy`: default component init. Can be null
+void itu_entity_component_add(ITU_EntityId id, ITU_ComponentType component_type, void* in_data_copy)
+{
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
+	SDL_assert(component_type < COMPONENTS_COUNT_MAX);
+	Uint64 component_bit = 1ll << component_type;
+
+	if(!itu_entity_is_valid(id))
+	{
+		SDL_Log("WARNING invalid entity\n");
+		return;
+	}
+
+	if(ctx_estorage.entities[id.index].component_mask & component_bit)
+	{
+		SDL_Log("WARNING entity %d alread has component type %d\n", id.index, component_type);
+		return;
+	}
+
+	ctx_estorage.entities[id.index].component_mask |= component_bit;
+
+	ITU_Component* component = ctx_estorage.components[component_type];
+	itu_sparse_index_set(&component->versions, id.index, ctx_estorage.change_tick);
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		ITU_Entity* entity = &ctx_estorage.entities[id.index];
+		itu_archetype_entity_move(entity, entity->component_mask);
+		component->count_alive++;
+		if(in_data_copy)
+			SDL_memcpy(itu_archetype_data_get(ctx_estorage.archetypes[entity->archetype], entity->archetype_row, component_type), in_data_copy, component->element_size);
+	}
+	else
+	{
+		itu_component_pool_assign(component, id);
+		if(in_data_copy)
+			itu_component_pool_data_set(component, id, in_data_copy);
+		itu_groups_component_added(id, component_type);
+	}
+
+	if(itu_component_is_transform3D(component_type))
+		transform_hierarchy_link_new(id.index);
+
+	itu_systems_members_refresh(id);
+}
+
+void itu_entity_component_remove(ITU_EntityId id, ITU_ComponentType component_type)
+{
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
+	SDL_assert(component_type < COMPONENTS_COUNT_MAX);
+	Uint64 component_bit = 1ll << component_type;
+	
+	if(!itu_entity_is_valid(id))
+	{
+		SDL_Log("WARNING invalid entity\n");
+		return;
+	}
+
+	if(!(ctx_estorage.entities[id.index].component_mask & component_bit))
+	{
+		SDL_Log("WARNING entity %d does NOT has component type %d\n", id.index, component_type);
+		return;
+	}
+
+	if(itu_component_is_transform3D(component_type))
+		transform_hierarchy_detach(id.index);
+
+	ctx_estorage.entities[id.index].component_mask &= ~component_bit; // keeps all bits of `id.component_mask` the same except for component_bit, which is set to 0
+
+	ITU_Component* component = ctx_estorage.components[component_type];
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		ITU_Entity* entity = &ctx_estorage.entities[id.index];
+		itu_archetype_entity_move(entity, entity->component_mask);
+		component->count_alive--;
+	}
+	else
+	{
+		itu_groups_component_removed(id, component_type);
+		itu_component_pool_remove(component, id);
+	}
+
+	itu_systems_members_refresh(id);
+}
+
+void* itu_entity_data_get(ITU_EntityId id, ITU_ComponentType component_type)
+{
+	SDL_assert(component_type < COMPONENTS_COUNT_MAX);
+
+	if(!itu_entity_is_valid(id))
+	{
+		//SDL_Log("WARNING invalid entity\n");
+		return NULL;
+	}
+
+	Uint64 component_bit = 1ll << component_type;
+	if(!(ctx_estorage.entities[id.index].component_mask & component_bit))
+	{
+		//SDL_Log("WARNING entity %d does NOT have component type %d\n", id.index, component_type);
+		return NULL;
+	}
+
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		ITU_Entity* entity = &ctx_estorage.entities[id.index];
+		return itu_archetype_data_get(ctx_estorage.archetypes[entity->archetype], entity->archetype_row, component_type);
+	}
+
+	ITU_Component* component = ctx_estorage.components[component_type];
+	
+	Uint32 loc = itu_sparse_index_get(&component->data_loc, id.index);
+	return pointer_index(component->data, loc, component->element_size);
+}
+
+// same as `itu_entity_data_get`, but the caller guarantees that the entity is alive and has the component
+void* itu_entity_data_get_unchecked(ITU_EntityId id, ITU_ComponentType component_type)
+{
+	SDL_assert(itu_entity_is_valid(id));
+	SDL_assert(ctx_estorage.entities[id.index].component_mask & (1ull << component_type));
+
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		ITU_Entity* entity = &ctx_estorage.entities[id.index];
+		return itu_archetype_data_get(ctx_estorage.archetypes[entity->archetype], entity->archetype_row, component_type);
+	}
+
+	ITU_Component* component = ctx_estorage.components[component_type];
+	return pointer_index(component->data, itu_sparse_index_get(&component->data_loc, id.index), component->element_size);
+}
+
+// same as `itu_entity_data_get`, but flags the component as changed (see `ITU_SystemDef::component_mask_changed`)
+void* itu_entity_data_get_mut(ITU_EntityId id, ITU_ComponentType component_type)
+{
+	void* ret = itu_entity_data_get(id, component_type);
+	if(ret)
+		itu_sparse_index_set(&ctx_estorage.components[component_type]->versions, id.index, ctx_estorage.change_tick);
+	return ret;
+}
+
+void itu_entity_data_mark_changed(ITU_EntityId id, ITU_ComponentType component_type)
+{
+	SDL_assert(component_type < ctx_estorage.components_count);
+	if(!itu_entity_is_valid(id) || !(ctx_estorage.entities[id.index].component_mask & (1ull << component_type)))
+		return;
+
+	itu_sparse_index_set(&ctx_estorage.components[component_type]->versions, id.index, ctx_estorage.change_tick);
+}
+
+Uint32 itu_sys_estorage_change_tick()
+{
+	return ctx_estorage.change_tick;
+}
+
+void itu_tag_members_add(ITU_ComponentTag* tag_storage, ITU_EntityId id)
+{
+	itu_sparse_index_set(&tag_storage->entity_loc, id.index, stbds_arrlen(tag_storage->entity_ids));
+	stbds_arrput(tag_storage->entity_ids, id);
+}
+
+void itu_tag_members_remove(ITU_ComponentTag* tag_storage, ITU_EntityId id)
+{
+	Uint32 loc_curr = itu_sparse_index_get(&tag_storage->entity_loc, id.index);
+	ITU_EntityId entity_swap = stbds_arrpop(tag_storage->entity_ids);
+	if(loc_curr < stbds_arrlen(tag_storage->entity_ids))
+	{
+		tag_storage->entity_ids[loc_curr] = entity_swap;
+		itu_sparse_index_set(&tag_storage->entity_loc, entity_swap.index, loc_curr);
+	}
+	itu_sparse_index_set(&tag_storage->entity_loc, id.index, -1);
+}
+
+void itu_entity_tag_add(ITU_EntityId id, ITU_TagType tag)
+{
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
+	SDL_assert(tag < TAGS_COUNT_MAX);
+	Uint64 tag_bit = 1ull << tag;
+
+	if(!itu_entity_is_valid(id))
+	{
+		SDL_Log("WARNING invalid entity\n");
+		return;
+	}
+
+	if(ctx_estorage.entities[id.index].tag_mask & tag_bit)
+		return;
+
+	ctx_estorage.entities[id.index].tag_mask |= tag_bit;
+
+	ITU_ComponentTag* tag_storage = &ctx_estorage.tags[tag];
+	if(tag_storage->tracked)
+		itu_tag_members_add(tag_storage, id);
+
+	itu_systems_members_refresh(id);
+}
+
+void itu_entity_tag_remove(ITU_EntityId id, ITU_TagType tag)
+{
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
+	SDL_assert(tag < TAGS_COUNT_MAX);
+	Uint64 tag_bit = 1ull << tag;
+
+	if(!itu_entity_is_valid(id) || !(ctx_estorage.entities[id.index].tag_mask & tag_bit))
+		return;
+
+	ctx_estorage.entities[id.index].tag_mask &= ~tag_bit;
+
+	ITU_ComponentTag* tag_storage = &ctx_estorage.tags[tag];
+	if(tag_storage->tracked)
+		itu_tag_members_remove(tag_storage, id);
+
+	itu_systems_members_refresh(id);
+}
+
+bool itu_entity_tag_has(ITU_EntityId id, ITU_TagType tag)
+{
+	SDL_assert(tag < TAGS_COUNT_MAX);
+	return itu_entity_is_valid(id) && (ctx_estorage.entities[id.index].tag_mask & (1ull << tag));
+}
+
+// first half of destroying an entity: everything that needs its data to still be reachable.
+// Sparse set pools are left alone, the caller removes the entity from them
+static void itu_entity_destroy_detach(ITU_EntityId id)
+{
+	ITU_Entity* entity = &ctx_estorage.entities[id.index];
+	Uint64 component_mask = entity->component_mask;
+
+	if(itu_component_is_transform3D(ITU_COMPONENT_TYPE_Transform3D) && (component_mask & component_mask(Transform3D)))
+		transform_hierarchy_detach(id.index);
+
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		// all components live in the same row, no need to move the entity through the intermediate archetypes
+		for(Uint64 bits = component_mask; bits; bits &= bits - 1)
+			ctx_estorage.components[bit_index_lowest(bits)]->count_alive--;
+
+		itu_archetype_row_remove(ctx_estorage.archetypes[entity->archetype], entity->archetype_row);
+	}
+	else
+	{
+		// leave groups while the entity is still in all of their pools (every group only once)
+		Uint32 groups_left = 0;
+		for(Uint64 bits = component_mask; bits; bits &= bits - 1)
+		{
+			int group_idx = ctx_estorage.components[bit_index_lowest(bits)]->group;
+			if(group_idx == -1 || (groups_left & (1u << group_idx)))
+				continue;
+
+			groups_left |= 1u << group_idx;
+			if(itu_group_contains(&ctx_estorage.groups[group_idx], id))
+				itu_group_leave(&ctx_estorage.groups[group_idx], id);
+		}
+	}
+}
+
+// last half of destroying an entity: the slot goes back to the free list.
+// Afterwards `itu_entity_is_dead` is true for it, until the slot is recycled
+static void itu_entity_destroy_release(ITU_EntityId id)
+{
+	// clear debug name (the string itself is interned, nothing to free)
+	if(id.index < (Uint32)stbds_arrlen(ctx_estorage.entities_debug_names))
+		ctx_estorage.entities_debug_names[id.index] = NULL;
+
+	ctx_estorage.entities[id.index].id.index = -1;
+	ctx_estorage.entities[id.index].id.generation++;
+	ctx_estorage.entities[id.index].component_mask = 0;
+	ctx_estorage.entities[id.index].tag_mask = 0;
+	stbds_arrput(ctx_estorage.entities_free, id);
+}
+
+static bool itu_entity_is_dead(ITU_EntityId id)
+{
+	return ctx_estorage.entities[id.index].id.index == (Uint32)-1;
+}
+
+// removes every dead entity from a dense list with a single linear pass (order of the survivors is preserved).
+// Used instead of one swap-remove per entity when a large part of the list goes away at once
+static void itu_entity_list_remove_dead(stbds_arr(ITU_EntityId) list, int* count, ITU_SparseIndex* loc)
+{
+	int count_alive = 0;
+	for(int i = 0; i < *count; ++i)
+	{
+		ITU_EntityId id = list[i];
+		if(itu_entity_is_dead(id))
+		{
+			itu_sparse_index_set(loc, id.index, -1);
+			continue;
+		}
+		if(count_alive != i)
+		{
+			list[count_alive] = id;
+			itu_sparse_index_set(loc, id.index, count_alive);
+		}
+		++count_alive;
+	}
+	*count = count_alive;
+}
+
+// same as `itu_entity_list_remove_dead`, moving component data along with the entity ids
+static void itu_component_pool_remove_dead(ITU_Component* component_pool)
+{
+	int count_alive = 0;
+	for(int i = 0; i < component_pool->count_alive; ++i)
+	{
+		ITU_EntityId id = component_pool->entity_ids[i];
+		if(itu_entity_is_dead(id))
+		{
+			itu_sparse_index_set(&component_pool->data_loc, id.index, -1);
+			continue;
+		}
+		if(count_alive != i)
+		{
+			component_pool->entity_ids[count_alive] = id;
+			SDL_memcpy(
+				pointer_index(component_pool->data, count_alive, component_pool->element_size),
+				pointer_index(component_pool->data, i, component_pool->element_size),
+				component_pool->element_size
+			);
+			itu_sparse_index_set(&component_pool->data_loc, id.index, count_alive);
+		}
+		++count_alive;
+	}
+	component_pool->count_alive = count_alive;
+}
+
+void itu_entity_destroy(ITU_EntityId id)
+{
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
+	if(!itu_entity_is_valid(id))
+	{
+		SDL_Log("WARNING invalid entity\n");
+		return;
+	}
+
+	ITU_Entity* entity = &ctx_estorage.entities[id.index];
+	Uint64 component_mask = entity->component_mask;
+	Uint64 tag_mask = entity->tag_mask;
+
+	itu_entity_destroy_detach(id);
+
+	// free all components
+	// NOTE: straight to the pools, system membership is dealt with once below
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_SPARSE_SET)
+		for(Uint64 bits = component_mask; bits; bits &= bits - 1)
+			itu_component_pool_remove(ctx_estorage.components[bit_index_lowest(bits)], id);
+
+	// free all tags (only tracked tags need any work)
+	for(Uint64 bits = tag_mask; bits; bits &= bits - 1)
+	{
+		ITU_ComponentTag* tag = &ctx_estorage.tags[bit_index_lowest(bits)];
+		if(tag->tracked)
+			itu_tag_members_remove(tag, id);
+	}
+
+	// leave whatever system is still matching
+	for(int i = 0; i < ctx_estorage.systems_count; ++i)
+		if(itu_sparse_index_get(&ctx_estorage.systems[i].members_loc, id.index) != (Uint32)-1)
+			itu_system_members_remove(&ctx_estorage.systems[i], id);
+
+	itu_entity_destroy_release(id);
+}
+
+void itu_entity_destroy_batch(ITU_EntityId* ids, int count)
+{
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
+
+	ITU_ArenaTemp scratch = itu_lib_arena_scratch_begin(NULL);
+	ITU_EntityId* destroyed = arena_push_array(scratch.arena, ITU_EntityId, count);
+	Uint64* destroyed_component_masks = arena_push_array(scratch.arena, Uint64, count);
+	Uint64* destroyed_tag_masks       = arena_push_array(scratch.arena, Uint64, count);
+	ITU_EntityId* removed = arena_push_array(scratch.arena, ITU_EntityId, count);
+	int destroyed_count = 0;
+
+	int removed_counts[COMPONENTS_COUNT_MAX] = { };
+	int removed_tag_counts[TAGS_COUNT_MAX] = { };
+
+	// release every entity first, so that later passes can tell which entries are going away with `itu_entity_is_dead`.
+	// NOTE: already dead and repeated ids are skipped
+	for(int i = 0; i < count; ++i)
+	{
+		ITU_EntityId id = ids[i];
+		if(!itu_entity_is_valid(id))
+			continue;
+
+		ITU_Entity* entity = &ctx_estorage.entities[id.index];
+		destroyed[destroyed_count] = id;
+		destroyed_component_masks[destroyed_count] = entity->component_mask;
+		destroyed_tag_masks[destroyed_count] = entity->tag_mask;
+		++destroyed_count;
+
+		for(Uint64 bits = entity->component_mask; bits; bits &= bits - 1)
+			removed_counts[bit_index_lowest(bits)]++;
+		for(Uint64 bits = entity->tag_mask; bits; bits &= bits - 1)
+			removed_tag_counts[bit_index_lowest(bits)]++;
+
+		// NOTE: the hierarchy has to be fixed up here, while every other entity in the batch is still alive
+		itu_entity_destroy_detach(id);
+		itu_entity_destroy_release(id);
+	}
+
+	// one pool at a time. When a large part of the pool goes away, compacting it in a single pass is cheaper than
+	// swap-removing every entity (and keeps the order of the survivors, e.g. after `itu_sys_estorage_component_sort_data`)
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_SPARSE_SET)
+	{
+		for(int i = 0; i < ctx_estorage.components_count; ++i)
+		{
+			if(!removed_counts[i])
+				continue;
+
+			ITU_Component* component = ctx_estorage.components[i];
+			if(removed_counts[i] * 4 >= component->count_alive)
+				itu_component_pool_remove_dead(component);
+			else
+				for(int j = 0; j < destroyed_count; ++j)
+					if(destroyed_component_masks[j] & (1ull << i))
+						itu_component_pool_remove(component, destroyed[j]);
+		}
+	}
+
+	for(int i = 0; i < TAGS_COUNT_MAX; ++i)
+	{
+		ITU_ComponentTag* tag = &ctx_estorage.tags[i];
+		if(!removed_tag_counts[i] || !tag->tracked)
+			continue;
+
+		int members_count = stbds_arrlen(tag->entity_ids);
+		if(removed_tag_counts[i] * 4 >= members_count)
+		{
+			itu_entity_list_remove_dead(tag->entity_ids, &members_count, &tag->entity_loc);
+			stbds_arrsetlen(tag->entity_ids, members_count);
+		}
+		else
+			for(int j = 0; j < destroyed_count; ++j)
+				if(destroyed_tag_masks[j] & (1ull << i))
+					itu_tag_members_remove(tag, destroyed[j]);
+	}
+
+	for(int i = 0; i < ctx_estorage.systems_count; ++i)
+	{
+		ITU_System* system = &ctx_estorage.systems[i];
+
+		// NOTE: checking membership directly instead of matching the masks, since membership refreshes can be
+		//       postponed (see `itu_sys_estorage_deferred_apply`)
+		int removed_count = 0;
+		for(int j = 0; j < destroyed_count; ++j)
+			if(itu_sparse_index_get(&system->members_loc, destroyed[j].index) != (Uint32)-1)
+				removed[removed_count++] = destroyed[j];
+		if(!removed_count)
+			continue;
+
+		int members_count = stbds_arrlen(system->members);
+		if(removed_count * 4 >= members_count)
+		{
+			itu_entity_list_remove_dead(system->members, &members_count, &system->members_loc);
+			stbds_arrsetlen(system->members, members_count);
+		}
+		else
+			for(int j = 0; j < removed_count; ++j)
+				itu_system_members_remove(system, removed[j]);
+	}
+
+	itu_lib_arena_scratch_end(scratch);
+}
+
+
+ITU_EntityCommandBuffer* itu_command_buffer_get()
+{
+	return &ctx_estorage.command_buffers[itu_lib_jobs_thread_index()];
+}
+
+void itu_command_buffer_push(ITU_EntityCommandType command_type, ITU_EntityId id, Uint8 type, void* in_data_copy)
+{
+	ITU_EntityCommandBuffer* buffer = itu_command_buffer_get();
+
+	ITU_EntityCommand command;
+	command.command_type = command_type;
+	command.type = type;
+	command.id = id;
+	command.data_offset = -1;
+
+	if(in_data_copy)
+	{
+		// keep every component copy 16-byte aligned, same as archetype columns
+		Uint64 element_size = ctx_estorage.components[type]->element_size;
+		Uint32 offset = (stbds_arrlen(buffer->data) + 15) & ~15;
+		stbds_arrsetlen(buffer->data, offset + element_size);
+		SDL_memcpy(buffer->data + offset, in_data_copy, element_size);
+		command.data_offset = offset;
+	}
+
+	stbds_arrput(buffer->commands, command);
+}
+
+ITU_EntityId itu_entity_create_deferred()
+{
+	ITU_EntityCommandBuffer* buffer = itu_command_buffer_get();
+	ITU_EntityId ret = { ITU_ENTITY_GENERATION_DEFERRED, (Uint32)buffer->created_count++ };
+
+	itu_command_buffer_push(ITU_ENTITY_COMMAND_CREATE, ret, 0, NULL);
+	return ret;
+}
+
+void itu_entity_destroy_deferred(ITU_EntityId id)
+{
+	itu_command_buffer_push(ITU_ENTITY_COMMAND_DESTROY, id, 0, NULL);
+}
+
+void itu_entity_component_add_deferred(ITU_EntityId id, ITU_ComponentType component_type, void* in_data_copy)
+{
+	SDL_assert(component_type < ctx_estorage.components_count);
+	itu_command_buffer_push(ITU_ENTITY_COMMAND_COMPONENT_ADD, id, component_type, in_data_copy);
+}
+
+void itu_entity_component_remove_deferred(ITU_EntityId id, ITU_ComponentType component_type)
+{
+	SDL_assert(component_type < ctx_estorage.components_count);
+	itu_command_buffer_push(ITU_ENTITY_COMMAND_COMPONENT_REMOVE, id, component_type, NULL);
+}
+
+void itu_entity_tag_add_deferred(ITU_EntityId id, ITU_TagType tag)
+{
+	SDL_assert(tag < TAGS_COUNT_MAX);
+	itu_command_buffer_push(ITU_ENTITY_COMMAND_TAG_ADD, id, tag, NULL);
+}
+
+void itu_entity_tag_remove_deferred(ITU_EntityId id, ITU_TagType tag)
+{
+	SDL_assert(tag < TAGS_COUNT_MAX);
+	itu_command_buffer_push(ITU_ENTITY_COMMAND_TAG_REMOVE, id, tag, NULL);
+}
+
+void itu_command_buffer_apply(ITU_EntityCommandBuffer* buffer)
+{
+	int commands_count = stbds_arrlen(buffer->commands);
+
+	// pre-size everything for the whole batch, so that pools grow at most once
+	int components_added[COMPONENTS_COUNT_MAX] = { 0 };
+	for(int i = 0; i < commands_count; ++i)
+		if(buffer->commands[i].command_type == ITU_ENTITY_COMMAND_COMPONENT_ADD)
+			++components_added[buffer->commands[i].type];
+
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_SPARSE_SET)
+		for(int i = 0; i < ctx_estorage.components_count; ++i)
+			if(components_added[i])
+				itu_component_pool_reserve(ctx_estorage.components[i], ctx_estorage.components[i]->count_alive + components_added[i]);
+	stbds_arrsetcap(ctx_estorage.entities, stbds_arrlen(ctx_estorage.entities) + buffer->created_count);
+
+	stbds_arrsetlen(ctx_estorage.deferred_created, buffer->created_count);
+	for(int i = 0; i < commands_count; ++i)
+	{
+		ITU_EntityCommand* command = &buffer->commands[i];
+
+		ITU_EntityId id = command->id;
+		if(id.generation == ITU_ENTITY_GENERATION_DEFERRED)
 		{
-			// tree structure with tree pointers
-			ITU_Component* transform_component = ctx_estorage.components[ITU_COMPONENT_TYPE_Transform3D];
-			do_transform_tree_recursive(transform_component, (Transform3D*)TMP_transform_root.child_first);
+			if(command->command_type == ITU_ENTITY_COMMAND_CREATE)
+			{
+				ctx_estorage.deferred_created[id.index] = itu_entity_create();
+				continue;
+			}
+			id = ctx_estorage.deferred_created[id.index];
 		}
 
-		if(ImGui::CollapsingHeader("Entities", ImGuiTreeNodeFlags_DefaultOpen))
+		switch(command->command_type)
 		{
-			// linear tabulated list of entities
-			itu_sys_estorage_debug_render_entity_table();
+			case ITU_ENTITY_COMMAND_DESTROY:
+				// the same entity can be destroyed by more than one system in the same frame
+				if(itu_entity_is_valid(id))
+					itu_entity_destroy(id);
+				break;
+			case ITU_ENTITY_COMMAND_COMPONENT_ADD:
+				itu_entity_component_add(id, command->type, command->data_offset == (Uint32)-1 ? NULL : buffer->data + command->data_offset);
+				break;
+			case ITU_ENTITY_COMMAND_COMPONENT_REMOVE:
+				itu_entity_component_remove(id, command->type);
+				break;
+			case ITU_ENTITY_COMMAND_TAG_ADD:
+				itu_entity_tag_add(id, command->type);
+				break;
+			case ITU_ENTITY_COMMAND_TAG_REMOVE:
+				itu_entity_tag_remove(id, command->type);
+				break;
+			default:
+				SDL_assert(false);
 		}
+	}
 
-		if(ImGui::CollapsingHeader("Systems", ImGuiTreeNodeFlags_DefaultOpen))
+	stbds_arrsetlen(buffer->commands, 0);
+	stbds_arrsetlen(buffer->data, 0);
+	buffer->created_count = 0;
+}
+
+void itu_sys_estorage_deferred_apply()
+{
+	SDL_assert(!ctx_estorage.structural_lock);
+
+	// system membership is only refreshed once per touched entity, instead of after every single operation
+	ctx_estorage.deferred_applying = true;
+	for(int i = 0; i < ITU_JOBS_WORKERS_MAX + 1; ++i)
+		if(stbds_arrlen(ctx_estorage.command_buffers[i].commands))
+			itu_command_buffer_apply(&ctx_estorage.command_buffers[i]);
+	ctx_estorage.deferred_applying = false;
+
+	for(int i = 0; i < stbds_arrlen(ctx_estorage.deferred_touched); ++i)
+	{
+		ITU_EntityId id = ctx_estorage.deferred_touched[i];
+		if(itu_entity_is_valid(id))
+			itu_systems_members_refresh(id);
+	}
+	stbds_arrsetlen(ctx_estorage.deferred_touched, 0);
+}
+
+void itu_prefab_component_set(ITU_Prefab* prefab, ITU_ComponentType component_type, void* in_data_copy)
+{
+	SDL_assert(component_type < ctx_estorage.components_count);
+	Uint64 element_size = ctx_estorage.components[component_type]->element_size;
+
+	if(!(prefab->component_mask & (1ull << component_type)))
+	{
+		// keep every component 16-byte aligned, same as archetype columns
+		Uint32 offset = (stbds_arrlen(prefab->data) + 15) & ~15;
+		stbds_arrsetlen(prefab->data, offset + element_size);
+		prefab->data_offsets[component_type] = offset;
+		prefab->component_mask |= 1ull << component_type;
+	}
+
+	unsigned char* data = prefab->data + prefab->data_offsets[component_type];
+	if(in_data_copy)
+		SDL_memcpy(data, in_data_copy, element_size);
+	else
+		SDL_memset(data, 0, element_size);
+}
+
+void itu_prefab_tag_add(ITU_Prefab* prefab, ITU_TagType tag)
+{
+	SDL_assert(tag < TAGS_COUNT_MAX);
+	prefab->tag_mask |= 1ull << tag;
+}
+
+void itu_prefab_free(ITU_Prefab* prefab)
+{
+	stbds_arrfree(prefab->data);
+	SDL_memset(prefab, 0, sizeof(ITU_Prefab));
+}
+
+// fills `count` consecutive elements of `dst` with copies of `src`, doubling the copied range every time
+// so that we only do log2(count) memcpy calls
+void itu_memfill(void* dst, const void* src, Uint64 element_size, int count)
+{
+	if(count <= 0)
+		return;
+
+	SDL_memcpy(dst, src, element_size);
+	Uint64 size_total = element_size * count;
+	Uint64 size_done  = element_size;
+	while(size_done < size_total)
+	{
+		Uint64 size_copy = SDL_min(size_done, size_total - size_done);
+		SDL_memcpy((unsigned char*)dst + size_done, dst, size_copy);
+		size_done += size_copy;
+	}
+}
+
+void itu_prefab_instantiate(ITU_Prefab* prefab, int count, ITU_EntityId* out_entity_ids)
+{
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
+	SDL_assert(out_entity_ids);
+	if(count <= 0)
+		return;
+
+	// entities (recycled first, same as `itu_entity_create`)
+	int count_recycled = SDL_min(count, (int)stbds_arrlen(ctx_estorage.entities_free));
+	stbds_arrsetcap(ctx_estorage.entities, stbds_arrlen(ctx_estorage.entities) + count - count_recycled);
+	for(int i = 0; i < count; ++i)
+	{
+		ITU_Entity* entity;
+		if(i < count_recycled)
 		{
-			if(ImGui::BeginTable("debug_estorage_master_systems", 5, ImGuiTableFlags_SizingFixedFit))
-			{
-				ImGui::TableSetupColumn("");
-				ImGui::TableSetupColumn("name");
-				ImGui::TableSetupColumn("comp");
-				ImGui::TableSetupColumn("tags");
-				ImGui::TableSetupColumn("entities");
-				ImGui::TableHeadersRow();
-				for(int i = 0; i < ctx_estorage.systems_count; ++i)
+			ITU_EntityId id_recycled = stbds_arrpop(ctx_estorage.entities_free);
+			entity = &ctx_estorage.entities[id_recycled.index];
+			entity->id.index = id_recycled.index;
+			entity->id.generation = id_recycled.generation + 1;
+		}
+		else
+		{
+			ITU_Entity entity_data;
+			entity_data.id.generation = 0;
+			entity_data.id.index = stbds_arrlen(ctx_estorage.entities);
+			stbds_arrput(ctx_estorage.entities, entity_data);
+			entity = &stbds_arrlast(ctx_estorage.entities);
+		}
+		entity->component_mask = prefab->component_mask;
+		entity->tag_mask = prefab->tag_mask;
+		out_entity_ids[i] = entity->id;
+	}
+
+	// component data
+	for(int i = 0; i < ctx_estorage.components_count; ++i)
+		if(prefab->component_mask & (1ull << i))
+			for(int j = 0; j < count; ++j)
+				itu_sparse_index_set(&ctx_estorage.components[i]->versions, out_entity_ids[j].index, ctx_estorage.change_tick);
+
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		// every instance goes straight into its final archetype, without moving through the intermediate ones
+		int archetype_idx = itu_archetype_get_or_create(prefab->component_mask);
+		ITU_Archetype* archetype = ctx_estorage.archetypes[archetype_idx];
+		Uint32 row_beg = archetype->count_alive;
+		for(int i = 0; i < count; ++i)
+		{
+			ITU_Entity* entity = &ctx_estorage.entities[out_entity_ids[i].index];
+			entity->archetype = archetype_idx;
+			entity->archetype_row = itu_archetype_row_alloc(archetype, entity->id);
+		}
+
+		// new rows are contiguous, so we can fill one chunk-sized run at a time
+		Uint32 row = row_beg;
+		while(row < row_beg + count)
+		{
+			int slot = row % archetype->chunk_capacity;
+			int run = SDL_min(archetype->chunk_capacity - slot, (int)(row_beg + count - row));
+			unsigned char* chunk = archetype->chunks[row / archetype->chunk_capacity];
+			for(int i = 0; i < ctx_estorage.components_count; ++i)
+				if(prefab->component_mask & (1ull << i))
 				{
-					ITU_System* system = &ctx_estorage.systems[i];
-					ImGui::TableNextRow();
+					Uint64 element_size = ctx_estorage.components[i]->element_size;
+					itu_memfill(chunk + archetype->column_offsets[i] + element_size * slot, prefab->data + prefab->data_offsets[i], element_size, run);
+				}
+			row += run;
+		}
 
-					ImGui::TableNextColumn();
-					char buf_id[48];
-					SDL_snprintf(buf_id, 48, "%3d##debug_estorage_master_systems", i);
-					if(ImGui::Selectable(
-						buf_id,
-						ctx_debug_window.detail_category == ITU_SYS_ESTORAGE_DETAIL_CATEGORY_SYSTEM && i == ctx_debug_window.loc_selected,
-						ImGuiSelectableFlags_SpanAllColumns
-					))
-					{
-						ctx_debug_window.loc_selected = i;
-						ctx_debug_window.detail_category = ITU_SYS_ESTORAGE_DETAIL_CATEGORY_SYSTEM;
-					}
+		for(int i = 0; i < ctx_estorage.components_count; ++i)
+			if(prefab->component_mask & (1ull << i))
+				ctx_estorage.components[i]->count_alive += count;
+	}
+	else
+	{
+		for(int i = 0; i < ctx_estorage.components_count; ++i)
+		{
+			if(!(prefab->component_mask & (1ull << i)))
+				continue;
 
-					ImGui::TableNextColumn();
-					ImGui::Text("%s", system->name);
+			ITU_Component* component = ctx_estorage.components[i];
+			itu_component_pool_reserve(component, component->count_alive + count);
 
-					ImGui::TableNextColumn();
-					ImGui::Text("%d", system->components_count);
+			Uint32 loc_beg = component->count_alive;
+			for(int j = 0; j < count; ++j)
+			{
+				itu_sparse_index_set(&component->data_loc, out_entity_ids[j].index, loc_beg + j);
+				component->entity_ids[loc_beg + j] = out_entity_ids[j];
+			}
+			itu_memfill(pointer_index(component->data, loc_beg, component->element_size), prefab->data + prefab->data_offsets[i], component->element_size, count);
+			component->count_alive += count;
+		}
 
-					ImGui::TableNextColumn();
-					ImGui::Text("%d", system->tags_count);
+		for(int i = 0; i < ctx_estorage.groups_count; ++i)
+		{
+			ITU_ComponentGroup* group = &ctx_estorage.groups[i];
+			if((prefab->component_mask & group->component_mask) == group->component_mask)
+				for(int j = 0; j < count; ++j)
+					itu_group_enter(group, out_entity_ids[j]);
+		}
+	}
 
-					ImGui::TableNextColumn();
-					ITU_EntityId scratch_system_ids[ENTITIES_COUNT_MAX];
-					int scratch_system_ids_count;
+	if(itu_component_is_transform3D(ITU_COMPONENT_TYPE_Transform3D) && (prefab->component_mask & component_mask(Transform3D)))
+		for(int i = 0; i < count; ++i)
+			transform_hierarchy_link_new(out_entity_ids[i].index);
 
-					ITU_EntityId* system_ids;
-					int* system_ids_count;
+	// tags
+	for(int i = 0; i < TAGS_COUNT_MAX; ++i)
+	{
+		ITU_ComponentTag* tag_storage = &ctx_estorage.tags[i];
+		if(!(prefab->tag_mask & (1ull << i)) || !tag_storage->tracked)
+			continue;
 
-					if(ctx_debug_window.detail_category == ITU_SYS_ESTORAGE_DETAIL_CATEGORY_SYSTEM && i == ctx_debug_window.loc_selected)
-					{
-						system_ids = selected_system_ids;
-						system_ids_count = &selected_system_ids_count;
-					}
-					else
-					{
-						system_ids = scratch_system_ids;
-						system_ids_count = &scratch_system_ids_count;
-					}
+		stbds_arrsetcap(tag_storage->entity_ids, stbds_arrlen(tag_storage->entity_ids) + count);
+		for(int j = 0; j < count; ++j)
+			itu_tag_members_add(tag_storage, out_entity_ids[j]);
+	}
 
-					*system_ids_count = itu_system_get_matching_entities(system, system_ids);
-					ImGui::Text("%d", *system_ids_count);
-				}
+	// systems (every instance has the same masks, so we only need to check once)
+	for(int i = 0; i < ctx_estorage.systems_count; ++i)
+	{
+		ITU_System* system = &ctx_estorage.systems[i];
+		if(!itu_system_matches_entity(system, out_entity_ids[0]))
+			continue;
+
+		stbds_arrsetcap(system->members, stbds_arrlen(system->members) + count);
+		for(int j = 0; j < count; ++j)
+			itu_system_members_add(system, out_entity_ids[j]);
+	}
+}
+
+// *** world snapshots
+// file layout (every section starts 16-byte aligned, so that it can be read in place from the mapped file):
+// - ITU_SnapshotHeader
+// - ITU_SnapshotComponent[components_count], used to detect component layout changes
+// - ITU_ComponentGroup[groups_count]
+// - ITU_Entity[entities_count]
+// - ITU_EntityId[entities_free_count]
+// - for every component: entity ids, `data_loc` flattened to `entities_count` entries, data
+// - debug names: for every entity, Uint16 length (0 for none) followed by the characters
+
+#define ITU_SNAPSHOT_MAGIC     0x53555449 // "ITUS"
+#define ITU_SNAPSHOT_VERSION   1          // bump every time the file layout changes
+#define ITU_SNAPSHOT_ALIGNMENT 16
+#define ITU_SNAPSHOT_NAME_SIZE 32
+
+struct ITU_SnapshotHeader
+{
+	Uint32 magic;
+	Uint32 version;
+	Uint64 size; // whole file, to catch truncated files early
+	Uint32 entities_count;
+	Uint32 entities_free_count;
+	Uint32 components_count;
+	Uint32 groups_count;
+	Uint32 transform_root_first;
+	Uint32 transform_root_last;
+	Uint32 debug_names_size;
+	Uint32 padding;
+};
+
+struct ITU_SnapshotComponent
+{
+	char   name[ITU_SNAPSHOT_NAME_SIZE]; // truncated, always null-terminated
+	Uint64 element_size;
+	Uint32 count_alive;
+	Uint32 padding;
+};
+
+struct ITU_SnapshotWriter
+{
+	SDL_IOStream* io;
+	Uint64 offset;
+	bool failed;
+};
+
+struct ITU_SnapshotReader
+{
+	const unsigned char* data;
+	Uint64 size;
+	Uint64 offset;
+};
+
+// every write starts a new section
+static void itu_snapshot_write(ITU_SnapshotWriter* writer, const void* data, Uint64 size)
+{
+	static const unsigned char padding[ITU_SNAPSHOT_ALIGNMENT] = { 0 };
+	Uint64 padding_size = (ITU_SNAPSHOT_ALIGNMENT - writer->offset % ITU_SNAPSHOT_ALIGNMENT) % ITU_SNAPSHOT_ALIGNMENT;
+	if(writer->failed || !size)
+		return;
+
+	if(SDL_WriteIO(writer->io, padding, padding_size) != padding_size || SDL_WriteIO(writer->io, data, size) != size)
+		writer->failed = true;
+	writer->offset += padding_size + size;
+}
+
+// same alignment as `itu_snapshot_write`. Returns NULL if the snapshot is too short
+static const void* itu_snapshot_read(ITU_SnapshotReader* reader, Uint64 size)
+{
+	if(!size)
+		return NULL;
+
+	Uint64 offset = (reader->offset + ITU_SNAPSHOT_ALIGNMENT - 1) & ~(Uint64)(ITU_SNAPSHOT_ALIGNMENT - 1);
+	if(offset + size > reader->size)
+		return NULL;
+
+	reader->offset = offset + size;
+	return reader->data + offset;
+}
+
+static bool itu_snapshot_save_io(SDL_IOStream* io)
+{
+	ITU_SnapshotWriter writer = { io, 0, false };
+	int entities_count = stbds_arrlen(ctx_estorage.entities);
+
+	ITU_ArenaTemp scratch = itu_lib_arena_scratch_begin(NULL);
+
+	ITU_SnapshotHeader header;
+	SDL_memset(&header, 0, sizeof(header));
+	header.magic = ITU_SNAPSHOT_MAGIC;
+	header.version = ITU_SNAPSHOT_VERSION;
+	header.entities_count = entities_count;
+	header.entities_free_count = stbds_arrlen(ctx_estorage.entities_free);
+	header.components_count = ctx_estorage.components_count;
+	header.groups_count = ctx_estorage.groups_count;
+	transform_hierarchy_roots_get(&header.transform_root_first, &header.transform_root_last);
+
+	// debug names are packed up front, so that the header knows their size
+	Uint64 debug_names_size = 0;
+	int debug_names_count = SDL_min(entities_count, (int)stbds_arrlen(ctx_estorage.entities_debug_names));
+	for(int i = 0; i < entities_count; ++i)
+		debug_names_size += sizeof(Uint16) + (i < debug_names_count && ctx_estorage.entities_debug_names[i] ? SDL_min(SDL_strlen(ctx_estorage.entities_debug_names[i]), (size_t)0xFFFF) : 0);
+	unsigned char* debug_names = arena_push_array(scratch.arena, unsigned char, debug_names_size);
+	unsigned char* debug_names_curr = debug_names;
+	for(int i = 0; i < entities_count; ++i)
+	{
+		const char* debug_name = i < debug_names_count ? ctx_estorage.entities_debug_names[i] : NULL;
+		Uint16 len = debug_name ? (Uint16)SDL_min(SDL_strlen(debug_name), (size_t)0xFFFF) : 0;
+		SDL_memcpy(debug_names_curr, &len, sizeof(len));
+		if(len)
+			SDL_memcpy(debug_names_curr + sizeof(len), debug_name, len);
+		debug_names_curr += sizeof(len) + len;
+	}
+	header.debug_names_size = (Uint32)debug_names_size;
+
+	itu_snapshot_write(&writer, &header, sizeof(header));
+
+	ITU_SnapshotComponent* components = arena_push_array(scratch.arena, ITU_SnapshotComponent, ctx_estorage.components_count);
+	SDL_memset(components, 0, sizeof(ITU_SnapshotComponent) * ctx_estorage.components_count);
+	for(int i = 0; i < ctx_estorage.components_count; ++i)
+	{
+		SDL_strlcpy(components[i].name, ctx_estorage.components[i]->name, ITU_SNAPSHOT_NAME_SIZE);
+		components[i].element_size = ctx_estorage.components[i]->element_size;
+		components[i].count_alive = ctx_estorage.components[i]->count_alive;
+	}
+	itu_snapshot_write(&writer, components, sizeof(ITU_SnapshotComponent) * ctx_estorage.components_count);
+	itu_snapshot_write(&writer, ctx_estorage.groups, sizeof(ITU_ComponentGroup) * ctx_estorage.groups_count);
+	itu_snapshot_write(&writer, ctx_estorage.entities, sizeof(ITU_Entity) * entities_count);
+	itu_snapshot_write(&writer, ctx_estorage.entities_free, sizeof(ITU_EntityId) * header.entities_free_count);
+
+	// `data_loc` pages are flattened, pages that were never allocated become -1
+	Uint32* data_loc = arena_push_array(scratch.arena, Uint32, entities_count);
+	for(int i = 0; i < ctx_estorage.components_count; ++i)
+	{
+		ITU_Component* component = ctx_estorage.components[i];
+		for(int index = 0; index < entities_count; index += ENTITIES_SPARSE_PAGE_SIZE)
+		{
+			int page = index >> ENTITIES_SPARSE_PAGE_SHIFT;
+			int count = SDL_min(ENTITIES_SPARSE_PAGE_SIZE, entities_count - index);
+			if(page < stbds_arrlen(component->data_loc.pages) && component->data_loc.pages[page])
+				SDL_memcpy(data_loc + index, component->data_loc.pages[page], sizeof(Uint32) * count);
+			else
+				SDL_memset(data_loc + index, -1, sizeof(Uint32) * count);
+		}
+
+		itu_snapshot_write(&writer, component->entity_ids, sizeof(ITU_EntityId) * component->count_alive);
+		itu_snapshot_write(&writer, data_loc, sizeof(Uint32) * entities_count);
+		itu_snapshot_write(&writer, component->data, component->element_size * component->count_alive);
+	}
+
+	itu_snapshot_write(&writer, debug_names, debug_names_size);
+	itu_lib_arena_scratch_end(scratch);
+
+	// now we know how big it is
+	header.size = writer.offset;
+	if(!writer.failed && (SDL_SeekIO(io, 0, SDL_IO_SEEK_SET) != 0 || SDL_WriteIO(io, &header, sizeof(header)) != sizeof(header)))
+		writer.failed = true;
+
+	if(writer.failed)
+		SDL_Log("WARNING could not write snapshot: %s\n", SDL_GetError());
+	return !writer.failed;
+}
+
+// pointers to every section of a snapshot, straight into the file
+struct ITU_SnapshotView
+{
+	const ITU_SnapshotHeader*    header;
+	const ITU_SnapshotComponent* components;
+	const ITU_ComponentGroup*    groups;
+	const ITU_Entity*            entities;
+	const ITU_EntityId*          entities_free;
+	const ITU_EntityId*          component_entity_ids[COMPONENTS_COUNT_MAX];
+	const Uint32*                component_data_loc[COMPONENTS_COUNT_MAX];
+	const unsigned char*         component_data[COMPONENTS_COUNT_MAX];
+	const unsigned char*         debug_names;
+};
+
+// like `itu_snapshot_read`, but empty sections are fine (and give NULL)
+static bool itu_snapshot_read_section(ITU_SnapshotReader* reader, Uint64 size, const void** out_data)
+{
+	*out_data = itu_snapshot_read(reader, size);
+	return !size || *out_data;
+}
+
+static bool itu_snapshot_corrupted(const char* reason)
+{
+	SDL_Log("WARNING snapshot is corrupted (%s)\n", reason);
+	return false;
+}
+
+// walks the whole snapshot without touching the world: layout has to match the current one, every section has to be
+// there, and every index stored in it has to be in range, so that loading can't read or write out of bounds
+static bool itu_snapshot_validate(const unsigned char* data, Uint64 size, ITU_SnapshotView* out_view)
+{
+	ITU_SnapshotReader reader = { data, size, 0 };
+	SDL_zero(*out_view);
+
+	const ITU_SnapshotHeader* header = (const ITU_SnapshotHeader*)itu_snapshot_read(&reader, sizeof(ITU_SnapshotHeader));
+	if(!header || header->magic != ITU_SNAPSHOT_MAGIC)
+	{
+		SDL_Log("WARNING not a snapshot\n");
+		return false;
+	}
+	if(header->version != ITU_SNAPSHOT_VERSION)
+	{
+		SDL_Log("WARNING snapshot version %d, expected %d\n", header->version, ITU_SNAPSHOT_VERSION);
+		return false;
+	}
+	if(header->size != size || header->entities_count > ENTITIES_COUNT_MAX)
+	{
+		SDL_Log("WARNING snapshot is corrupted (%llu bytes, expected %llu)\n", (unsigned long long)size, (unsigned long long)header->size);
+		return false;
+	}
+	if(header->components_count != (Uint32)ctx_estorage.components_count || header->groups_count != (Uint32)ctx_estorage.groups_count)
+	{
+		SDL_Log("WARNING snapshot has %d components and %d groups, expected %d and %d\n", header->components_count, header->groups_count, ctx_estorage.components_count, ctx_estorage.groups_count);
+		return false;
+	}
+	out_view->header = header;
+
+	Uint32 entities_count = header->entities_count;
+	if(header->entities_free_count > entities_count)
+		return itu_snapshot_corrupted("more free entities than entities");
+
+	const ITU_SnapshotComponent* components;
+	if(!itu_snapshot_read_section(&reader, sizeof(ITU_SnapshotComponent) * header->components_count, (const void**)&components))
+		return itu_snapshot_corrupted("component table");
+	for(int i = 0; i < ctx_estorage.components_count; ++i)
+	{
+		ITU_Component* component = ctx_estorage.components[i];
+		if(SDL_strncmp(components[i].name, component->name, ITU_SNAPSHOT_NAME_SIZE - 1) != 0 || components[i].element_size != component->element_size)
+		{
+			SDL_Log("WARNING snapshot component %d is %.*s (%d bytes), expected %s (%d bytes)\n", i, ITU_SNAPSHOT_NAME_SIZE - 1, components[i].name, (int)components[i].element_size, component->name, (int)component->element_size);
+			return false;
+		}
+		if(components[i].count_alive > entities_count)
+			return itu_snapshot_corrupted("component pool bigger than the entity list");
+	}
+	out_view->components = components;
+
+	const ITU_ComponentGroup* groups;
+	if(!itu_snapshot_read_section(&reader, sizeof(ITU_ComponentGroup) * header->groups_count, (const void**)&groups))
+		return itu_snapshot_corrupted("component groups");
+	for(int i = 0; i < ctx_estorage.groups_count; ++i)
+	{
+		if(groups[i].component_mask != ctx_estorage.groups[i].component_mask)
+		{
+			SDL_Log("WARNING snapshot component group %d doesn't match\n", i);
+			return false;
+		}
+		if(groups[i].count < 0 || (Uint32)groups[i].count > entities_count)
+			return itu_snapshot_corrupted("component group count");
+	}
+	out_view->groups = groups;
+
+	if(!itu_snapshot_read_section(&reader, sizeof(ITU_Entity) * entities_count, (const void**)&out_view->entities))
+		return itu_snapshot_corrupted("entities");
+	Uint64 component_mask_valid = ctx_estorage.components_count < 64 ? (1ull << ctx_estorage.components_count) - 1 : ~0ull;
+	for(Uint32 i = 0; i < entities_count; ++i)
+	{
+		const ITU_Entity* entity = &out_view->entities[i];
+		if((entity->id.index != i && entity->id.index != (Uint32)-1) || (entity->component_mask & ~component_mask_valid))
+			return itu_snapshot_corrupted("entities");
+	}
+
+	if(!itu_snapshot_read_section(&reader, sizeof(ITU_EntityId) * header->entities_free_count, (const void**)&out_view->entities_free))
+		return itu_snapshot_corrupted("free entities");
+	for(Uint32 i = 0; i < header->entities_free_count; ++i)
+		if(out_view->entities_free[i].index >= entities_count || out_view->entities[out_view->entities_free[i].index].id.index != (Uint32)-1)
+			return itu_snapshot_corrupted("free entities");
+
+	// pools have to be proper sparse sets: every `data_loc` entry points back at its entity, and agrees with the entity's component mask
+	for(int i = 0; i < ctx_estorage.components_count; ++i)
+	{
+		Uint32 count = components[i].count_alive;
+		const ITU_EntityId* entity_ids;
+		const Uint32* data_loc;
+		const unsigned char* component_data;
+		if(   !itu_snapshot_read_section(&reader, sizeof(ITU_EntityId) * count, (const void**)&entity_ids)
+		   || !itu_snapshot_read_section(&reader, sizeof(Uint32) * entities_count, (const void**)&data_loc)
+		   || !itu_snapshot_read_section(&reader, components[i].element_size * count, (const void**)&component_data))
+			return itu_snapshot_corrupted(components[i].name);
+
+		Uint32 members_count = 0;
+		for(Uint32 index = 0; index < entities_count; ++index)
+		{
+			Uint32 loc = data_loc[index];
+			bool has_component = (out_view->entities[index].component_mask >> i) & 1;
+			if(has_component != (loc != (Uint32)-1))
+				return itu_snapshot_corrupted(components[i].name);
+			if(has_component && (loc >= count || entity_ids[loc].index != index))
+				return itu_snapshot_corrupted(components[i].name);
+			members_count += has_component;
+		}
+		if(members_count != count)
+			return itu_snapshot_corrupted(components[i].name);
+
+		out_view->component_entity_ids[i] = entity_ids;
+		out_view->component_data_loc[i] = data_loc;
+		out_view->component_data[i] = component_data;
+	}
+
+	const unsigned char* debug_names;
+	if(!itu_snapshot_read_section(&reader, header->debug_names_size, (const void**)&debug_names))
+		return itu_snapshot_corrupted("debug names");
+	Uint64 debug_names_offset = 0;
+	for(Uint32 i = 0; i < entities_count; ++i)
+	{
+		Uint16 len;
+		if(debug_names_offset + sizeof(len) > header->debug_names_size)
+			return itu_snapshot_corrupted("debug names");
+		SDL_memcpy(&len, debug_names + debug_names_offset, sizeof(len));
+		debug_names_offset += sizeof(len) + len;
+		if(debug_names_offset > header->debug_names_size)
+			return itu_snapshot_corrupted("debug names");
+	}
+	if(debug_names_offset != header->debug_names_size)
+		return itu_snapshot_corrupted("debug names");
+	out_view->debug_names = debug_names;
+
+	if(   (header->transform_root_first != TRANSFORM3D_INDEX_NULL && header->transform_root_first >= entities_count)
+	   || (header->transform_root_last  != TRANSFORM3D_INDEX_NULL && header->transform_root_last  >= entities_count))
+		return itu_snapshot_corrupted("transform hierarchy roots");
+
+	if(reader.offset != size)
+		return itu_snapshot_corrupted("trailing data");
+
+	return true;
+}
+
+static bool itu_snapshot_load_memory(const unsigned char* data, Uint64 size)
+{
+	// the world is only touched once the whole snapshot is known to be good
+	ITU_SnapshotView view;
+	if(!itu_snapshot_validate(data, size, &view))
+		return false;
+	const ITU_SnapshotHeader* header = view.header;
+
+	// from here on, the snapshot replaces the current world
+	itu_sys_estorage_clear_all_entities();
+	int entities_count = header->entities_count;
+
+	stbds_arrsetlen(ctx_estorage.entities, entities_count);
+	if(entities_count)
+		SDL_memcpy(ctx_estorage.entities, view.entities, sizeof(ITU_Entity) * entities_count);
+	stbds_arrsetlen(ctx_estorage.entities_free, header->entities_free_count);
+	if(header->entities_free_count)
+		SDL_memcpy(ctx_estorage.entities_free, view.entities_free, sizeof(ITU_EntityId) * header->entities_free_count);
+
+	for(int i = 0; i < ctx_estorage.components_count; ++i)
+	{
+		ITU_Component* component = ctx_estorage.components[i];
+		int count = view.components[i].count_alive;
+		itu_component_pool_reserve(component, count);
+		component->count_alive = count;
 
-				ImGui::EndTable();
-			}
+		if(count)
+		{
+			SDL_memcpy(component->entity_ids, view.component_entity_ids[i], sizeof(ITU_EntityId) * count);
+			SDL_memcpy(component->data, view.component_data[i], component->element_size * count);
 		}
+		const Uint32* data_loc = view.component_data_loc[i];
 
-		if(ImGui::CollapsingHeader("Components", ImGuiTreeNodeFlags_DefaultOpen))
+		// whole pages at a time, skipping the ones without any entity. Everything loaded counts as changed
+		for(int index = 0; index < entities_count; index += ENTITIES_SPARSE_PAGE_SIZE)
 		{
-			if(ImGui::BeginTable("debug_estorage_master_components", 4, ImGuiTableFlags_SizingFixedFit))
-			{
-				ImGui::TableSetupColumn("");
-				ImGui::TableSetupColumn("name");
-				ImGui::TableSetupColumn("alive");
-				ImGui::TableSetupColumn("capacity");
-				ImGui::TableHeadersRow();
-				for(int i = 0; i < ctx_estorage.components_count; ++i)
-				{
-					ITU_Component* component = ctx_estorage.components[i];
-					ImGui::TableNextRow();
-
-					ImGui::TableNextColumn();
-					char buf_id[48];
-					SDL_snprintf(buf_id, 48, "%3d##debug_estorage_master_components", i);
-					if(ImGui::Selectable(
-						buf_id,
-						ctx_debug_window.detail_category == ITU_SYS_ESTORAGE_DETAIL_CATEGORY_COMPONENT && i == ctx_debug_window.loc_selected,
-						ImGuiSelectableFlags_SpanAllColumns
-					))
-					{
-						ctx_debug_window.loc_selected = i;
-						ctx_debug_window.detail_category = ITU_SYS_ESTORAGE_DETAIL_CATEGORY_COMPONENT;
-					}
+			int page_count = SDL_min(ENTITIES_SPARSE_PAGE_SIZE, entities_count - index);
+			int j = 0;
+			while(j < page_count && data_loc[index + j] == (Uint32)-1)
+				++j;
+			if(j == page_count)
+				continue;
 
-					ImGui::TableNextColumn();
-					ImGui::Text("%s", component->name);
+			int page = index >> ENTITIES_SPARSE_PAGE_SHIFT;
+			SDL_memcpy(itu_sparse_index_page_get_or_create(&component->data_loc, page), data_loc + index, sizeof(Uint32) * page_count);
+			Uint32* versions = itu_sparse_index_page_get_or_create(&component->versions, page);
+			for(; j < page_count; ++j)
+				if(data_loc[index + j] != (Uint32)-1)
+					versions[j] = ctx_estorage.change_tick;
+		}
+	}
 
-					ImGui::TableNextColumn();
-					ImGui::Text("%d", component->count_alive);
+	for(int i = 0; i < ctx_estorage.groups_count; ++i)
+		ctx_estorage.groups[i].count = view.groups[i].count;
 
-					ImGui::TableNextColumn();
-					ImGui::Text("%d", component->count_max);
-				}
+	const unsigned char* debug_names = view.debug_names;
+	for(int i = 0; i < entities_count; ++i)
+	{
+		Uint16 len;
+		SDL_memcpy(&len, debug_names, sizeof(len));
+		if(len)
+			itu_entity_set_debug_name(ctx_estorage.entities[i].id, itu_lib_strings_intern_len((const char*)debug_names + sizeof(len), len));
+		debug_names += sizeof(len) + len;
+	}
 
-				ImGui::EndTable();
-			}
+	// tags are stored in the entities, only the tracked lists have to be rebuilt
+	for(int i = 0; i < entities_count; ++i)
+	{
+		ITU_EntityId id = ctx_estorage.entities[i].id;
+		if(!itu_entity_is_valid(id))
+			continue;
+		for(Uint64 bits = ctx_estorage.entities[i].tag_mask; bits; bits &= bits - 1)
+		{
+			ITU_ComponentTag* tag = &ctx_estorage.tags[bit_index_lowest(bits)];
+			if(tag->tracked)
+				itu_tag_members_add(tag, id);
 		}
-		ImGui::EndChild();
 	}
-	ImGui::SameLine();
 
-	ImGui::BeginChild("debug_estorage_detail", ImVec2(0, 0), ImGuiChildFlags_Border);
+	transform_hierarchy_roots_set(header->transform_root_first, header->transform_root_last);
+
+	// systems are not part of the snapshot, they just pick up their members again (and see everything as changed)
+	for(int i = 0; i < ctx_estorage.systems_count; ++i)
 	{
-		if(ctx_debug_window.loc_selected != -1)
-			switch(ctx_debug_window.detail_category)
-			{
-				case ITU_SYS_ESTORAGE_DETAIL_CATEGORY_ENTITY   : itu_sys_estorage_debug_render_detail_entity(context, ctx_estorage.entities[ctx_debug_window.loc_selected].id); break;
-				case ITU_SYS_ESTORAGE_DETAIL_CATEGORY_SYSTEM   : itu_sys_estorage_debug_render_detail_system(context, &ctx_estorage.systems[ctx_debug_window.loc_selected], selected_system_ids, selected_system_ids_count); break;
-				case ITU_SYS_ESTORAGE_DETAIL_CATEGORY_COMPONENT: itu_sys_estorage_debug_render_detail_component(context, ctx_estorage.components[ctx_debug_window.loc_selected]); break;
-				default: /* do nothing */ break;
-			}
-		ImGui::EndChild();
+		itu_system_members_rebuild(&ctx_estorage.systems[i]);
+		ctx_estorage.systems[i].ran_once = false;
 	}
-	
-	//ImGui::End();
+
+	return true;
 }
 
-void itu_sys_estorage_tag_set_debug_name(int tag, const char* tag_debug_name)
+bool itu_sys_estorage_snapshot_save(const char* path)
 {
-	stbds_hmput(ctx_estorage.tag_debug_names, tag, tag_debug_name);
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
+
+	// TODO archetype mode (rows would have to be flattened into per-component arrays)
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		SDL_Log("WARNING snapshots are not supported in archetype storage mode");
+		return false;
+	}
+
+	SDL_IOStream* io = SDL_IOFromFile(path, "wb");
+	if(!io)
+	{
+		SDL_Log("WARNING could not open %s: %s\n", path, SDL_GetError());
+		return false;
+	}
+
+	bool ret = itu_snapshot_save_io(io);
+	if(!SDL_CloseIO(io))
+		ret = false;
+	return ret;
 }
 
-void itu_component_pool_assign(ITU_Component* component_pool, ITU_EntityId entity)
+bool itu_sys_estorage_snapshot_load(const char* path)
 {
-	SDL_assert(component_pool);
-	SDL_assert(component_pool->count_alive < component_pool->count_max);
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
 
-	// TODO check that requested entry is actually free
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		SDL_Log("WARNING snapshots are not supported in archetype storage mode");
+		return false;
+	}
 
-	Uint64 i = component_pool->count_alive++;
-	component_pool->data_loc[entity.index] = i;
-	component_pool->entity_ids[i] = entity;
-	SDL_memset((unsigned char*)component_pool->data + component_pool->element_size * i, 0, component_pool->element_size);
+	ITU_FileMapping mapping;
+	if(!itu_lib_fileutils_map(path, &mapping))
+		return false;
+
+	bool ret = itu_snapshot_load_memory(mapping.data, mapping.size);
+	itu_lib_fileutils_unmap(&mapping);
+	return ret;
 }
 
-void itu_component_pool_data_get(ITU_Component* component_pool, ITU_EntityId entity, void* out_data_copy)
+// *** rollback
+// every snapshot in the ring is a fixed list of sections (see `itu_rollback_sections_count`), each split in pages.
+// A page that didn't change since the previous snapshot is shared with it instead of copied (`refcount`), so a frame
+// only costs the pages that were actually written. Restoring compares the target pages with the live world, and
+// only copies (and re-indexes) the ones that differ.
+// NOTE: writes through plain `entity_get_data` are not tracked (see `ITU_SystemDef::component_mask_changed`), so
+//       changes are found by comparing bytes. Comparing is a lot cheaper than copying and allocating, and this way
+//       nothing can go missing
+
+#define ITU_ROLLBACK_PAGE_SIZE KB(4)
+
+struct ITU_RollbackPage
 {
-	SDL_assert(component_pool);
+	int refcount;
+	unsigned char data[ITU_ROLLBACK_PAGE_SIZE];
+};
 
-	Uint64 loc = component_pool->data_loc[entity.index];
-	void* data = pointer_offset(void, component_pool->data, component_pool->element_size * loc);
-	SDL_memcpy(out_data_copy, data, component_pool->element_size);
-}
+struct ITU_RollbackSection
+{
+	Uint64 size;
+	stbds_arr(ITU_RollbackPage*) pages;
+};
 
-void itu_component_pool_data_set(ITU_Component* component_pool, ITU_EntityId entity, void* in_data_copy)
+// state that doesn't live in any array
+struct ITU_RollbackWorld
 {
-	SDL_assert(component_pool);
+	Uint32 transform_root_first;
+	Uint32 transform_root_last;
+	int groups_count[GROUPS_COUNT_MAX];
+};
 
-	Uint64 loc = component_pool->data_loc[entity.index];
-	void* data = pointer_offset(void, component_pool->data, component_pool->element_size * loc);
-	SDL_memcpy(data, in_data_copy, component_pool->element_size);
-}
+struct ITU_RollbackFrame
+{
+	int frame; // -1 if the slot is empty
+	stbds_arr(ITU_RollbackSection) sections;
+};
 
-void itu_component_pool_remove(ITU_Component* component_pool, ITU_EntityId entity)
+struct ITU_RollbackContext
 {
-	SDL_assert(component_pool);
-	SDL_assert(component_pool->data_loc[entity.index] != -1);
-	SDL_assert(component_pool->data_loc[entity.index] < component_pool->count_alive);
+	ITU_RollbackFrame* frames; // ring, slot is `frame % frames_count`
+	int frames_count;
+	int frame_last;            // last frame saved (or restored), -1 if none
 
-	Uint64 loc_curr = component_pool->data_loc[entity.index];
-	Uint64 loc_last = component_pool->count_alive - 1;
-	ITU_EntityId entity_swap = component_pool->entity_ids[loc_last];
-	component_pool->entity_ids[loc_curr] = component_pool->entity_ids[loc_last];
+	stbds_arr(ITU_RollbackPage*) pages_free;
+	int pages_count;           // allocated, including free ones
+};
 
-	void* ptr_curr = pointer_offset(void, component_pool->data, loc_curr * component_pool->element_size);
-	void* ptr_last = pointer_offset(void, component_pool->data, loc_last * component_pool->element_size);
-	SDL_memcpy(ptr_curr, ptr_last, component_pool->element_size);
-	component_pool->data_loc[entity_swap.index] = loc_curr;
+static ITU_RollbackContext ctx_rollback = { NULL, 0, -1 };
 
-	component_pool->count_alive--;
-}
+enum ITU_RollbackSectionType
+{
+	ITU_ROLLBACK_SECTION_WORLD,
+	ITU_ROLLBACK_SECTION_ENTITIES,
+	ITU_ROLLBACK_SECTION_ENTITIES_FREE,
+	ITU_ROLLBACK_SECTION_DEBUG_NAMES,
 
-void itu_component_pool_clear(ITU_Component* component_pool)
+	// then, for each component: entity ids and data. Then entity ids of each tag, then members of each system
+	ITU_ROLLBACK_SECTION_COMPONENTS_FIRST,
+};
+
+static int itu_rollback_section_component(int component_type) { return ITU_ROLLBACK_SECTION_COMPONENTS_FIRST + component_type * 2; }
+static int itu_rollback_section_tag(int tag)                   { return itu_rollback_section_component(ctx_estorage.components_count) + tag; }
+static int itu_rollback_section_system(int system)             { return itu_rollback_section_tag(TAGS_COUNT_MAX) + system; }
+static int itu_rollback_sections_count()                       { return itu_rollback_section_system(ctx_estorage.systems_count); }
+
+static ITU_RollbackFrame* itu_rollback_frame_get(int frame)
 {
-	SDL_assert(component_pool);
+	if(frame < 0 || !ctx_rollback.frames_count)
+		return NULL;
 
-	component_pool->count_alive = 0;
+	ITU_RollbackFrame* ret = &ctx_rollback.frames[frame % ctx_rollback.frames_count];
+	return ret->frame == frame ? ret : NULL;
 }
 
-
-ITU_EntityId itu_entity_create()
+static void itu_rollback_frame_release(ITU_RollbackFrame* frame)
 {
-	if(stbds_arrlen(ctx_estorage.entities_free) > 0)
+	for(int i = 0; i < stbds_arrlen(frame->sections); ++i)
 	{
-		ITU_EntityId id_recycled = stbds_arrpop(ctx_estorage.entities_free);
-		ctx_estorage.entities[id_recycled.index].id.index = id_recycled.index;
-		ctx_estorage.entities[id_recycled.index].id.generation = id_recycled.generation + 1;
-		return ctx_estorage.entities[id_recycled.index].id;
+		ITU_RollbackSection* section = &frame->sections[i];
+		for(int j = 0; j < stbds_arrlen(section->pages); ++j)
+			if(--section->pages[j]->refcount == 0)
+				stbds_arrput(ctx_rollback.pages_free, section->pages[j]);
+		stbds_arrsetlen(section->pages, 0);
+		section->size = 0;
 	}
-
-	ITU_Entity entity_data;
-	entity_data.id.generation = 0;
-	entity_data.id.index = stbds_arrlen(ctx_estorage.entities);
-	entity_data.component_mask = 0;
-	stbds_arrput(ctx_estorage.entities, entity_data);
-
-	return entity_data.id;
+	frame->frame = -1;
 }
 
-void  itu_entity_set_debug_name(ITU_EntityId id, const char* debug_name)
+static ITU_RollbackPage* itu_rollback_page_alloc()
 {
-	// NOTE: allocating every single name is BAD, but we haven't looked in allocaiton startegies and memory arenas yet
-	int len = SDL_strlen(debug_name);
-	char* name_storage = (char*)SDL_malloc(len + 1);
-	SDL_memcpy(name_storage, debug_name, len);
-	name_storage[len] = 0;
-
-	stbds_hmput(ctx_estorage.entities_debug_names, id, name_storage);
+	ITU_RollbackPage* ret;
+	if(stbds_arrlen(ctx_rollback.pages_free) > 0)
+		ret = stbds_arrpop(ctx_rollback.pages_free);
+	else
+	{
+		ret = (ITU_RollbackPage*)SDL_malloc(sizeof(ITU_RollbackPage));
+		++ctx_rollback.pages_count;
+	}
+	ret->refcount = 1;
+	return ret;
 }
 
-const char* itu_entity_get_debug_name(ITU_EntityId id)
+static Uint64 itu_rollback_page_bytes(ITU_RollbackSection* section, int page)
 {
-	int loc = stbds_hmgeti(ctx_estorage.entities_debug_names, id);
-	if(loc == -1)
-		return NULL;
-	return ctx_estorage.entities_debug_names[loc].value;
+	return SDL_min((Uint64)ITU_ROLLBACK_PAGE_SIZE, section->size - (Uint64)page * ITU_ROLLBACK_PAGE_SIZE);
 }
 
-bool itu_entity_equals(ITU_EntityId a, ITU_EntityId b)
+// `prev` is the same section in the previous frame (if any), pages with the same content are shared
+static void itu_rollback_section_save(ITU_RollbackSection* section, ITU_RollbackSection* prev, const void* data, Uint64 size)
 {
-	return a.generation == b.generation && a.index == b.index;
+	section->size = size;
+	int pages_count = (int)((size + ITU_ROLLBACK_PAGE_SIZE - 1) / ITU_ROLLBACK_PAGE_SIZE);
+	stbds_arrsetlen(section->pages, pages_count);
+	for(int i = 0; i < pages_count; ++i)
+	{
+		const unsigned char* src = (const unsigned char*)data + (Uint64)i * ITU_ROLLBACK_PAGE_SIZE;
+		Uint64 bytes = itu_rollback_page_bytes(section, i);
+
+		ITU_RollbackPage* page = prev && i < stbds_arrlen(prev->pages) ? prev->pages[i] : NULL;
+		if(page && itu_rollback_page_bytes(prev, i) >= bytes && SDL_memcmp(page->data, src, bytes) == 0)
+			++page->refcount;
+		else
+		{
+			page = itu_rollback_page_alloc();
+			SDL_memcpy(page->data, src, bytes);
+		}
+		section->pages[i] = page;
+	}
 }
 
-bool itu_entity_is_valid(ITU_EntityId id)
+// true if page `page` of `section` differs from `dst`, of which only the first `dst_size_valid` bytes are live
+static bool itu_rollback_page_differs(ITU_RollbackSection* section, int page, const void* dst, Uint64 dst_size_valid)
 {
-	return id.index < ENTITIES_COUNT_MAX && id.index != -1 && ctx_estorage.entities[id.index].id.generation == id.generation;
+	Uint64 offset = (Uint64)page * ITU_ROLLBACK_PAGE_SIZE;
+	Uint64 bytes = itu_rollback_page_bytes(section, page);
+	return offset + bytes > dst_size_valid || SDL_memcmp(section->pages[page]->data, (const unsigned char*)dst + offset, bytes) != 0;
 }
 
-void itu_entity_id_to_stringid(ITU_EntityId id, char* buffer, int max_len)
+// copies back the pages that differ. `dst` must already be big enough for the whole section
+static void itu_rollback_section_restore(ITU_RollbackSection* section, void* dst, Uint64 dst_size_valid)
 {
-	// NOTE: this is super slow, but we have to do this if we want to leverage imgui for out UI toolkit
-	SDL_snprintf(buffer, max_len, "%d-%d", id.generation, id.index);
+	for(int i = 0; i < stbds_arrlen(section->pages); ++i)
+		if(itu_rollback_page_differs(section, i, dst, dst_size_valid))
+			SDL_memcpy((unsigned char*)dst + (Uint64)i * ITU_ROLLBACK_PAGE_SIZE, section->pages[i]->data, itu_rollback_page_bytes(section, i));
 }
 
-// `in_data_copy`: default component init. Can be null
-void itu_entity_component_add(ITU_EntityId id, ITU_ComponentType component_type, void* in_data_copy)
+// same as `itu_rollback_section_restore` for a dense list of ids, also keeping `loc` (EntityId.index -> location) in sync.
+// If `versions` is given, restored ids are marked as changed. Returns true if anything changed
+static bool itu_rollback_ids_restore(ITU_RollbackSection* section, ITU_EntityId* ids, int count_old, ITU_SparseIndex* loc, ITU_SparseIndex* versions)
 {
-	SDL_assert(component_type < COMPONENTS_COUNT_MAX);
-	Uint64 component_bit = 1ll << component_type;
+	const int ids_per_page = ITU_ROLLBACK_PAGE_SIZE / sizeof(ITU_EntityId);
+	int count_new = (int)(section->size / sizeof(ITU_EntityId));
+	int pages_count = stbds_arrlen(section->pages);
 
-	if(!itu_entity_is_valid(id))
+	ITU_ArenaTemp scratch = itu_lib_arena_scratch_begin(NULL);
+	bool* pages_changed = arena_push_array(scratch.arena, bool, pages_count);
+	bool ret = count_new != count_old;
+
+	// first unlink everything that goes away, since an id can move to a page that comes before
+	for(int i = 0; i < pages_count; ++i)
 	{
-		SDL_Log("WARNING invalid entity\n");
-		return;
+		pages_changed[i] = itu_rollback_page_differs(section, i, ids, sizeof(ITU_EntityId) * count_old);
+		if(!pages_changed[i])
+			continue;
+
+		ret = true;
+		for(int j = i * ids_per_page; j < SDL_min((i + 1) * ids_per_page, count_old); ++j)
+			itu_sparse_index_set(loc, ids[j].index, -1);
 	}
+	for(int j = count_new; j < count_old; ++j)
+		itu_sparse_index_set(loc, ids[j].index, -1);
 
-	if(ctx_estorage.entities[id.index].component_mask & component_bit)
+	for(int i = 0; i < pages_count; ++i)
 	{
-		SDL_Log("WARNING entity %d alread has component type %d\n", id.index, component_type);
-		return;
-	}
+		if(!pages_changed[i])
+			continue;
 
-	ctx_estorage.entities[id.index].component_mask |= component_bit;
+		SDL_memcpy(ids + i * ids_per_page, section->pages[i]->data, itu_rollback_page_bytes(section, i));
+		for(int j = i * ids_per_page; j < SDL_min((i + 1) * ids_per_page, count_new); ++j)
+		{
+			itu_sparse_index_set(loc, ids[j].index, j);
+			if(versions)
+				itu_sparse_index_set(versions, ids[j].index, ctx_estorage.change_tick);
+		}
+	}
 
-	ITU_Component* component = ctx_estorage.components[component_type];
-	itu_component_pool_assign(component, id);
-	if(in_data_copy)
-		itu_component_pool_data_set(component, id, in_data_copy);
+	itu_lib_arena_scratch_end(scratch);
+	return ret;
 }
 
-void itu_entity_component_remove(ITU_EntityId id, ITU_ComponentType component_type)
+void itu_sys_estorage_rollback_init(int frames_count)
 {
-	SDL_assert(component_type < COMPONENTS_COUNT_MAX);
-	Uint64 component_bit = 1ll << component_type;
-	
-	if(!itu_entity_is_valid(id))
+	for(int i = 0; i < ctx_rollback.frames_count; ++i)
 	{
-		SDL_Log("WARNING invalid entity\n");
-		return;
+		itu_rollback_frame_release(&ctx_rollback.frames[i]);
+		for(int j = 0; j < stbds_arrlen(ctx_rollback.frames[i].sections); ++j)
+			stbds_arrfree(ctx_rollback.frames[i].sections[j].pages);
+		stbds_arrfree(ctx_rollback.frames[i].sections);
 	}
-
-	if(!(ctx_estorage.entities[id.index].component_mask & component_bit))
-	{
-		SDL_Log("WARNING entity %d does NOT has component type %d\n", id.index, component_type);
+	for(int i = 0; i < stbds_arrlen(ctx_rollback.pages_free); ++i)
+		SDL_free(ctx_rollback.pages_free[i]);
+	stbds_arrfree(ctx_rollback.pages_free);
+	SDL_free(ctx_rollback.frames);
+
+	SDL_memset(&ctx_rollback, 0, sizeof(ctx_rollback));
+	ctx_rollback.frame_last = -1;
+	if(frames_count <= 0)
 		return;
-	}
-
-	ctx_estorage.entities[id.index].component_mask &= ~component_bit; // keeps all bits of `id.component_mask` the same except for component_bit, which is set to 0
 
-	ITU_Component* component = ctx_estorage.components[component_type];
-	itu_component_pool_remove(component, id);
+	ctx_rollback.frames_count = frames_count;
+	ctx_rollback.frames = (ITU_RollbackFrame*)SDL_malloc(sizeof(ITU_RollbackFrame) * frames_count);
+	SDL_memset(ctx_rollback.frames, 0, sizeof(ITU_RollbackFrame) * frames_count);
+	for(int i = 0; i < frames_count; ++i)
+		ctx_rollback.frames[i].frame = -1;
 }
 
-void* itu_entity_data_get(ITU_EntityId id, ITU_ComponentType component_type)
+int itu_sys_estorage_rollback_save()
 {
-	SDL_assert(component_type < COMPONENTS_COUNT_MAX);
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
 
-	if(!itu_entity_is_valid(id))
+	if(!ctx_rollback.frames_count)
 	{
-		//SDL_Log("WARNING invalid entity\n");
-		return NULL;
+		SDL_Log("WARNING rollback not initialized, see `itu_sys_estorage_rollback_init`\n");
+		return -1;
+	}
+	// TODO archetype mode (chunks could be paged the same way, but rows move around a lot more)
+	if(ctx_estorage.storage_mode == ITU_ENTITY_STORAGE_MODE_ARCHETYPE)
+	{
+		SDL_Log("WARNING rollback is not supported in archetype storage mode");
+		return -1;
 	}
 
-	Uint64 component_bit = 1ll << component_type;
-	if(!(ctx_estorage.entities[id.index].component_mask & component_bit))
+	int sections_count = itu_rollback_sections_count();
+	ITU_RollbackFrame* prev = itu_rollback_frame_get(ctx_rollback.frame_last);
+	if(prev && stbds_arrlen(prev->sections) != sections_count)
+		// systems were added since, nothing lines up anymore
+		prev = NULL;
+
+	int frame_id = ctx_rollback.frame_last + 1;
+	ITU_RollbackFrame* frame = &ctx_rollback.frames[frame_id % ctx_rollback.frames_count];
+	if(frame == prev)
+		// single slot ring, it's about to be overwritten
+		prev = NULL;
+	itu_rollback_frame_release(frame);
+	frame->frame = frame_id;
+	while(stbds_arrlen(frame->sections) < sections_count)
 	{
-		//SDL_Log("WARNING entity %d does NOT have component type %d\n", id.index, component_type);
-		return NULL;
+		ITU_RollbackSection empty = { 0 };
+		stbds_arrput(frame->sections, empty);
 	}
+	stbds_arrsetlen(frame->sections, sections_count);
 
-	ITU_Component* component = ctx_estorage.components[component_type];
-	
-	Uint64 loc = component->data_loc[id.index];
-	return pointer_index(component->data, loc, component->element_size);
-}
+	#define save_section(section_idx, data, size) itu_rollback_section_save(&frame->sections[section_idx], prev ? &prev->sections[section_idx] : NULL, (data), (size))
 
-void itu_entity_tag_add(ITU_EntityId id, ITU_TagType tag)
-{
-	SDL_assert(tag < TAGS_COUNT_MAX);
-	ITU_ComponentTagStorage foo = { id };
-	stbds_hmputs(ctx_estorage.tags[tag], foo);
-}
+	ITU_RollbackWorld world;
+	SDL_memset(&world, 0, sizeof(world));
+	transform_hierarchy_roots_get(&world.transform_root_first, &world.transform_root_last);
+	for(int i = 0; i < ctx_estorage.groups_count; ++i)
+		world.groups_count[i] = ctx_estorage.groups[i].count;
+	save_section(ITU_ROLLBACK_SECTION_WORLD, &world, sizeof(world));
 
-void itu_entity_tag_remove(ITU_EntityId id, ITU_TagType tag)
-{
-	SDL_assert(tag < TAGS_COUNT_MAX);
-	stbds_hmdel(ctx_estorage.tags[tag], id);
-}
+	save_section(ITU_ROLLBACK_SECTION_ENTITIES, ctx_estorage.entities, sizeof(ITU_Entity) * stbds_arrlen(ctx_estorage.entities));
+	save_section(ITU_ROLLBACK_SECTION_ENTITIES_FREE, ctx_estorage.entities_free, sizeof(ITU_EntityId) * stbds_arrlen(ctx_estorage.entities_free));
+	save_section(ITU_ROLLBACK_SECTION_DEBUG_NAMES, ctx_estorage.entities_debug_names, sizeof(const char*) * stbds_arrlen(ctx_estorage.entities_debug_names));
 
-bool itu_entity_tag_has(ITU_EntityId id, ITU_TagType tag)
-{
-	SDL_assert(tag < TAGS_COUNT_MAX);
-	return stbds_hmgeti(ctx_estorage.tags[tag], id) != -1;
+	for(int i = 0; i < ctx_estorage.components_count; ++i)
+	{
+		ITU_Component* component = ctx_estorage.components[i];
+		save_section(itu_rollback_section_component(i), component->entity_ids, sizeof(ITU_EntityId) * component->count_alive);
+		save_section(itu_rollback_section_component(i) + 1, component->data, component->element_size * component->count_alive);
+	}
+	for(int i = 0; i < TAGS_COUNT_MAX; ++i)
+		save_section(itu_rollback_section_tag(i), ctx_estorage.tags[i].entity_ids, sizeof(ITU_EntityId) * stbds_arrlen(ctx_estorage.tags[i].entity_ids));
+	for(int i = 0; i < ctx_estorage.systems_count; ++i)
+		save_section(itu_rollback_section_system(i), ctx_estorage.systems[i].members, sizeof(ITU_EntityId) * stbds_arrlen(ctx_estorage.systems[i].members));
+
+	#undef save_section
+
+	ctx_rollback.frame_last = frame_id;
+	return frame_id;
 }
 
-void itu_entity_destroy(ITU_EntityId id)
+bool itu_sys_estorage_rollback_restore(int frame_id)
 {
-	if(!itu_entity_is_valid(id))
+	SDL_assert(!ctx_estorage.structural_lock); // see `ITU_SystemDef::component_mask_read`
+
+	ITU_RollbackFrame* frame = itu_rollback_frame_get(frame_id);
+	if(!frame || frame_id > ctx_rollback.frame_last)
 	{
-		SDL_Log("WARNING invalid entity\n");
-		return;
+		SDL_Log("WARNING rollback frame %d not available\n", frame_id);
+		return false;
 	}
-
-	// TMP check if entity has Transform3D, and clean up hierarchy before deleteting data
+	if(stbds_arrlen(frame->sections) != itu_rollback_sections_count())
 	{
-		Transform3D* transform = entity_get_data(id, Transform3D);
-		if(transform)
-		{
-			int tmp_idx = ctx_estorage.components[ITU_COMPONENT_TYPE_Transform3D]->count_alive - 1;
-			ITU_EntityId id_other = ctx_estorage.components[ITU_COMPONENT_TYPE_Transform3D]->entity_ids[tmp_idx];
-			Transform3D* other = entity_get_data(id_other, Transform3D);
-			transform_hierarchy_refresh_before_deletion(
-				other,
-				transform
-			);
-			//transform3D_reparent(id, ITU_ENTITY_ID_NULL);
-			transform_hierarchy_remove(transform);
-		}
+		SDL_Log("WARNING rollback frame %d was saved with a different set of systems\n", frame_id);
+		return false;
 	}
 
-	Uint64 component_mask = ctx_estorage.entities[id.index].component_mask;
+	ITU_RollbackSection* sections = frame->sections;
 
-	// free all components
-	// TODO faster way to do this?
+	int entities_count_old = stbds_arrlen(ctx_estorage.entities);
+	stbds_arrsetlen(ctx_estorage.entities, sections[ITU_ROLLBACK_SECTION_ENTITIES].size / sizeof(ITU_Entity));
+	itu_rollback_section_restore(&sections[ITU_ROLLBACK_SECTION_ENTITIES], ctx_estorage.entities, sizeof(ITU_Entity) * entities_count_old);
+
+	int entities_free_count_old = stbds_arrlen(ctx_estorage.entities_free);
+	stbds_arrsetlen(ctx_estorage.entities_free, sections[ITU_ROLLBACK_SECTION_ENTITIES_FREE].size / sizeof(ITU_EntityId));
+	itu_rollback_section_restore(&sections[ITU_ROLLBACK_SECTION_ENTITIES_FREE], ctx_estorage.entities_free, sizeof(ITU_EntityId) * entities_free_count_old);
+
+	int debug_names_count_old = stbds_arrlen(ctx_estorage.entities_debug_names);
+	stbds_arrsetlen(ctx_estorage.entities_debug_names, sections[ITU_ROLLBACK_SECTION_DEBUG_NAMES].size / sizeof(const char*));
+	itu_rollback_section_restore(&sections[ITU_ROLLBACK_SECTION_DEBUG_NAMES], ctx_estorage.entities_debug_names, sizeof(const char*) * debug_names_count_old);
+
+	bool transforms_changed = false;
 	for(int i = 0; i < ctx_estorage.components_count; ++i)
 	{
-		Uint64 component_bit = 1ll << i;
-		if(!(component_mask & component_bit))
-			continue;
-		itu_entity_component_remove(id, i);
+		ITU_Component* component = ctx_estorage.components[i];
+		ITU_RollbackSection* section_ids  = &sections[itu_rollback_section_component(i)];
+		ITU_RollbackSection* section_data = &sections[itu_rollback_section_component(i) + 1];
+
+		int count_old = component->count_alive;
+		int count_new = (int)(section_ids->size / sizeof(ITU_EntityId));
+		itu_component_pool_reserve(component, count_new);
+		component->count_alive = count_new;
+		bool changed = itu_rollback_ids_restore(section_ids, component->entity_ids, count_old, &component->data_loc, &component->versions);
+
+		// data pages don't line up with elements, every element touching a restored page counts as changed
+		for(int page = 0; page < stbds_arrlen(section_data->pages); ++page)
+		{
+			if(!itu_rollback_page_differs(section_data, page, component->data, component->element_size * count_old))
+				continue;
+
+			Uint64 offset = (Uint64)page * ITU_ROLLBACK_PAGE_SIZE;
+			Uint64 bytes = itu_rollback_page_bytes(section_data, page);
+			SDL_memcpy((unsigned char*)component->data + offset, section_data->pages[page]->data, bytes);
+			for(Uint64 j = offset / component->element_size; j <= (offset + bytes - 1) / component->element_size; ++j)
+				itu_sparse_index_set(&component->versions, component->entity_ids[j].index, ctx_estorage.change_tick);
+			changed = true;
+		}
+
+		if(changed && itu_component_is_transform3D(i))
+			transforms_changed = true;
 	}
 
-	// free all tags
-	// TODO faster way to do this?
 	for(int i = 0; i < TAGS_COUNT_MAX; ++i)
-		itu_entity_tag_remove(id, i);
-
-	// clear debug name
-	int pos_name_storage = stbds_hmgeti(ctx_estorage.entities_debug_names, id);
-	if(pos_name_storage != -1)
 	{
-		// NOTE: as mentioned when allocating this, doing alloc/dealloc of every single name in isolation is not good for peformance
-		//       we'll give ourself a pass for this since this is a debug feature, but it's worth to keep in mind
-		SDL_free(ctx_estorage.entities_debug_names[pos_name_storage].value);
-		stbds_hmdel(ctx_estorage.entities_debug_names, id);
+		ITU_ComponentTag* tag = &ctx_estorage.tags[i];
+		int count_old = stbds_arrlen(tag->entity_ids);
+		stbds_arrsetlen(tag->entity_ids, sections[itu_rollback_section_tag(i)].size / sizeof(ITU_EntityId));
+		itu_rollback_ids_restore(&sections[itu_rollback_section_tag(i)], tag->entity_ids, count_old, &tag->entity_loc, NULL);
+	}
+	for(int i = 0; i < ctx_estorage.systems_count; ++i)
+	{
+		ITU_System* system = &ctx_estorage.systems[i];
+		int count_old = stbds_arrlen(system->members);
+		stbds_arrsetlen(system->members, sections[itu_rollback_section_system(i)].size / sizeof(ITU_EntityId));
+		itu_rollback_ids_restore(&sections[itu_rollback_section_system(i)], system->members, count_old, &system->members_loc, NULL);
 	}
 
-	ctx_estorage.entities[id.index].id.index = -1;
-	ctx_estorage.entities[id.index].id.generation++;
-	ctx_estorage.entities[id.index].component_mask = 0;
-	stbds_arrput(ctx_estorage.entities_free, id);
+	ITU_RollbackWorld world;
+	SDL_memcpy(&world, sections[ITU_ROLLBACK_SECTION_WORLD].pages[0]->data, sizeof(world));
+	for(int i = 0; i < ctx_estorage.groups_count; ++i)
+		ctx_estorage.groups[i].count = world.groups_count[i];
+
+	Uint32 root_first, root_last;
+	transform_hierarchy_roots_get(&root_first, &root_last);
+	if(transforms_changed || root_first != world.transform_root_first || root_last != world.transform_root_last)
+		transform_hierarchy_roots_set(world.transform_root_first, world.transform_root_last);
+
+	// resimulating from here: whatever was saved after this frame is a different timeline now
+	for(int i = frame_id + 1; i <= ctx_rollback.frame_last; ++i)
+		if(ITU_RollbackFrame* frame_discarded = itu_rollback_frame_get(i))
+			itu_rollback_frame_release(frame_discarded);
+	ctx_rollback.frame_last = frame_id;
+
+	return true;
 }
 
+Uint64 itu_sys_estorage_rollback_bytes_used()
+{
+	return (Uint64)ctx_rollback.pages_count * sizeof(ITU_RollbackPage);
+}
 
 void itu_debug_ui_widget_entityid(const char* label, ITU_EntityId id)
 {
@@ -1009,11 +3896,11 @@ void itu_debug_ui_widget_entityid(const char* label, ITU_EntityId id)
 		return;
 	}
 	
-	int loc = stbds_hmgeti(ctx_estorage.entities_debug_names, id);
-	if(loc == -1)
+	const char* debug_name = itu_entity_get_debug_name(id);
+	if(!debug_name)
 		ImGui::LabelText(label, "(%d, %d)", id.generation, id.index);
 	else
-		ImGui::LabelText(label, "%s (%d, %d)", ctx_estorage.entities_debug_names[loc].value, id.generation, id.index);
+		ImGui::LabelText(label, "%s (%d, %d)", debug_name, id.generation, id.index);
 }
 
 void itu_debug_ui_widget_entityid_tablerow(ITU_EntityId id)
@@ -1024,9 +3911,9 @@ void itu_debug_ui_widget_entityid_tablerow(ITU_EntityId id)
 		return;
 	}
 	
-	int loc = stbds_hmgeti(ctx_estorage.entities_debug_names, id);
-	if(loc == -1)
+	const char* debug_name = itu_entity_get_debug_name(id);
+	if(!debug_name)
 		ImGui::Text("(%d, %d)", id.generation, id.index);
 	else
-		ImGui::Text("%s (%d, %d)", ctx_estorage.entities_debug_names[loc].value, id.generation, id.index);
+		ImGui::Text("%s (%d, %d)", debug_name, id.generation, id.index);
 }
\ No newline at end of file
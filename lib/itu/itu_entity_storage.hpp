@@ -7,6 +7,9 @@
 #ifndef ITU_UNITY_BUILD
 #include <SDL3/SDL.h>
 #include <itu_lib_engine.hpp>
+#include <itu_lib_arena.hpp>
+#include <itu_lib_jobs.hpp>
+#include <itu_lib_strings.hpp>
 #endif
 
 // NOTE: this is decided by the size of the `component_mask` type (Uint64).
@@ -19,10 +22,32 @@
 #define SYSTEMS_COUNT_MAX     64
 #define SYSTEM_COMPONENTS_MAX  8
 #define SYSTEM_TAGS_MAX        8
-#define ENTITIES_COUNT_MAX 4096 * 4
+// how many frames of per-system stats are kept for the debug UI
+#define SYSTEM_STATS_FRAMES_COUNT 128
+// time-sliced systems check their budget after every batch of this many entities
+#define SYSTEM_TIME_SLICE_BATCH 64
+// NOTE: upper bound for entity indices, nothing is preallocated from this. All per-entity arrays grow on demand
+#define ENTITIES_COUNT_MAX (1 << 24)
+
+// sparse arrays (EntityId.index -> dense location) are split in pages allocated on first use
+#define ENTITIES_SPARSE_PAGE_SHIFT 12
+#define ENTITIES_SPARSE_PAGE_SIZE  (1 << ENTITIES_SPARSE_PAGE_SHIFT)
+#define ENTITIES_SPARSE_PAGE_MASK  (ENTITIES_SPARSE_PAGE_SIZE - 1)
+
+// starting capacity of a component pool, it doubles every time it fills up
+#define COMPONENT_POOL_CAPACITY_MIN 64
+
+#define ARCHETYPES_COUNT_MAX 256
+
+// every group owns at least two pools, and a pool can only be in one group
+#define GROUPS_COUNT_MAX (COMPONENTS_COUNT_MAX / 2)
+#define ARCHETYPE_CHUNK_SIZE KB(16)
 
 #define ITU_ENTITY_ID_NULL { (Uint32)-1, (Uint32)-1 }
 
+// generation used by the placeholder ids returned by `itu_entity_create_deferred`
+#define ITU_ENTITY_GENERATION_DEFERRED ((Uint32)-2)
+
 // unique identifier for an entity. This sould be treated as an opaque handle
 struct ITU_EntityId
 {
@@ -33,38 +58,157 @@ struct ITU_EntityId
 typedef Uint8 ITU_ComponentType;
 typedef Uint8 ITU_TagType;
 
+// how component data is laid out in memory. Has to be chosen before `itu_sys_estorage_init`
+enum ITU_EntityStorageMode
+{
+	// every component type lives in its own sparse set (default)
+	ITU_ENTITY_STORAGE_MODE_SPARSE_SET,
+	// entities with the same component mask live together in fixed-size chunks, one column per component type.
+	// Adding/removing a component moves the entity to a different archetype, so component data pointers are
+	// only stable until the next add/remove/destroy
+	ITU_ENTITY_STORAGE_MODE_ARCHETYPE,
+};
+
+// contiguous block of entities sharing the same archetype, returned by `itu_sys_estorage_chunks_next`
+struct ITU_EntityChunk
+{
+	int count;
+	Uint64 component_mask;
+	ITU_EntityId* entity_ids;
+
+	unsigned char* data;
+	const Uint32*  column_offsets;
+};
+
+// iterates all chunks containing AT LEAST the components in `component_mask`
+// usage: ITU_EntityChunkIterator it = { component_mask(Transform) | component_mask(Sprite) };
+struct ITU_EntityChunkIterator
+{
+	Uint64 component_mask;
+	int archetype_idx;
+	int chunk_idx;
+};
+
+// raw layout of a component pool, used by `itu_view` to skip `itu_entity_data_get`
+// `data` is NULL in archetype mode, since data lives in the archetype chunks
+struct ITU_ComponentView
+{
+	unsigned char* data;           // dense data array
+	Uint32**       data_loc_pages; // maps EntityId.index to location in `data`, see `ENTITIES_SPARSE_PAGE_SHIFT`
+	Uint32**       version_pages;  // maps EntityId.index to the tick of the last change, same paging as `data_loc_pages`
+
+	// only set for grouped pools (see `itu_sys_estorage_group_add`): the first `group_count` elements of `data` belong
+	// to these entities, in this order
+	ITU_EntityId*  group_entity_ids;
+	int            group_count;
+};
+
+// component data and tags baked once, and copied into every entity created by `itu_prefab_instantiate`.
+// Zero-initialize, fill with `prefab_set_component`/`itu_prefab_tag_add` and release with `itu_prefab_free`
+// NOTE: data is copied byte by byte, so it should not contain anything that has to be unique per entity
+//       (physics bodies, ...). Patch those after instantiating. Transform3D instances are linked as hierarchy roots
+struct ITU_Prefab
+{
+	Uint64 component_mask;
+	Uint64 tag_mask;
+	Uint32 data_offsets[COMPONENTS_COUNT_MAX]; // location of each component in `data`, only meaningful for types set in `component_mask`
+	stbds_arr(unsigned char) data;
+};
+
+// returns the sort key of a single component, see `itu_sys_estorage_component_sort_keys`
+// keys can be packed (e.g. `layer << 24 | texture_id`), or come from floats through `itu_sort_key_from_float`
+typedef Uint32 (*ITU_ComponentSortKeyFunction)(const void* data);
+
+// maps floats to keys with the same ordering (negative numbers included)
+inline Uint32 itu_sort_key_from_float(float value)
+{
+	Uint32 bits;
+	SDL_memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+}
+
 // signature for a system-like update function
 typedef void (*ITU_SystemUpdateFunction)(SDLContext* context, ITU_EntityId* entity_ids, int entity_ids_count);
 
 // signature for a component debug UI render function
 typedef void (*ITU_ComponendDebugUIRender)(SDLContext* context, void* data);
 
+// how often a system runs, see `ITU_SystemDef::schedule_mode`
+enum ITU_SystemScheduleMode
+{
+	ITU_SYSTEM_SCHEDULE_EVERY_FRAME,    // default
+	ITU_SYSTEM_SCHEDULE_EVERY_N_FRAMES, // once every `schedule_value` updates
+	ITU_SYSTEM_SCHEDULE_FIXED_RATE,     // `schedule_value` times per second (at most once per update)
+	// every update, but only on as many members as fit in `schedule_value` microseconds, picking up from where the
+	// previous update stopped. Members are handed out in batches of `SYSTEM_TIME_SLICE_BATCH`
+	ITU_SYSTEM_SCHEDULE_TIME_SLICED,
+};
+
 struct ITU_SystemDef
 {
 	const char* name;
 	ITU_SystemUpdateFunction fn_update;
 	Uint64 component_mask;
 	Uint64 tag_mask;
+
+	// declared access, used to run systems in parallel (see `itu_sys_estorage_systems_update`).
+	// Systems that declare nothing are "exclusive": they run alone, on the calling thread, and are allowed to do anything.
+	// Systems that declare access can run on a worker thread at the same time as other non-conflicting systems, so they
+	// must NOT create/destroy entities, add/remove components or tags, or touch any component/global state they didn't declare
+	Uint64 component_mask_read;
+	Uint64 component_mask_write;
+
+	// when set, the system only receives the members where at least one of these components changed since its last run
+	// (the first run still gets every member). Has to be a subset of `component_mask`.
+	// "changed" means added, or written through `entity_get_data_mut`/`itu_view::get_mut`/`itu_entity_data_mark_changed`.
+	// Plain `entity_get_data` does NOT track writes
+	Uint64 component_mask_changed;
+
+	// systems that don't run every update see `SDLContext::delta` as the time since their last run (time-sliced ones:
+	// the time their last full pass over all members took). Can't be combined with `component_mask_changed`
+	ITU_SystemScheduleMode schedule_mode;
+	float schedule_value;
 };
 
-#define register_component(T) ITU_ComponentType ITU_COMPONENT_TYPE_##T; const char* ITU_COMPONENT_NAME_##T = #T;
-#define enable_component(T) itu_sys_estorage_add_component_pool(sizeof(T), ENTITIES_COUNT_MAX, &ITU_COMPONENT_TYPE_##T, ITU_COMPONENT_NAME_##T)
+// maps a component struct to its runtime type id, specialized by `register_component`
+template<typename T> struct itu_component_traits;
+
+#define register_component(T) ITU_ComponentType ITU_COMPONENT_TYPE_##T; const char* ITU_COMPONENT_NAME_##T = #T; \
+	template<> struct itu_component_traits<T> { static ITU_ComponentType type() { return ITU_COMPONENT_TYPE_##T; } };
+#define enable_component(T) itu_sys_estorage_add_component_pool(sizeof(T), COMPONENT_POOL_CAPACITY_MIN, &ITU_COMPONENT_TYPE_##T, ITU_COMPONENT_NAME_##T)
 
 #define add_component_debug_ui_render(T, fn_debug_ui_render) itu_sys_estorage_add_component_debug_ui_render( ITU_COMPONENT_TYPE_##T, fn_debug_ui_render);
 
 #define entity_get_data(id, T) (T*)itu_entity_data_get((id), ITU_COMPONENT_TYPE_##T)
+#define entity_get_data_mut(id, T) (T*)itu_entity_data_get_mut((id), ITU_COMPONENT_TYPE_##T)
 
 #define add_system(fn_update, component_mask, tag_mask) itu_sys_estorage_add_system({ #fn_update, fn_update, component_mask, tag_mask })
+#define add_system_rw(fn_update, component_mask, tag_mask, read_mask, write_mask) itu_sys_estorage_add_system({ #fn_update, fn_update, component_mask, tag_mask, read_mask, write_mask })
+#define add_system_rw_changed(fn_update, component_mask, tag_mask, read_mask, write_mask, changed_mask) itu_sys_estorage_add_system({ #fn_update, fn_update, component_mask, tag_mask, read_mask, write_mask, changed_mask })
+#define add_system_scheduled(fn_update, component_mask, tag_mask, schedule_mode, schedule_value) itu_sys_estorage_add_system({ #fn_update, fn_update, component_mask, tag_mask, 0, 0, 0, schedule_mode, schedule_value })
 #define entity_add_component(id, T, value) { type_check_struct(T, value); itu_entity_component_add((id), ITU_COMPONENT_TYPE_##T, &value); }
+#define prefab_set_component(prefab, T, value) { type_check_struct(T, value); itu_prefab_component_set((prefab), ITU_COMPONENT_TYPE_##T, &value); }
+#define entity_add_component_deferred(id, T, value) { type_check_struct(T, value); itu_entity_component_add_deferred((id), ITU_COMPONENT_TYPE_##T, &value); }
 
 #define component_mask(T) (1ull << ITU_COMPONENT_TYPE_##T)
 #define component_type(T) ITU_COMPONENT_TYPE_##T
 
+#define entity_chunk_get_column(chunk, T) (T*)itu_entity_chunk_column((chunk), ITU_COMPONENT_TYPE_##T)
+
 #define tag_mask(tag) (1ull << tag)
 #define set_tag_debug_name(tag, name) itu_sys_estorage_tag_set_debug_name(tag, name);
 
 
 // register default components
+// NOTE: most of these are defined in headers included after this one
+struct Sprite;
+struct PhysicsData;
+struct PhysicsStaticData;
+struct ShapeData;
+struct Transform3D;
+struct MeshComponent;
+struct CameraComponent;
+
 register_component(Transform)
 register_component(Sprite)
 register_component(PhysicsData)
@@ -74,15 +218,63 @@ register_component(Transform3D)
 register_component(MeshComponent)
 register_component(CameraComponent)
 
+void itu_sys_estorage_set_storage_mode(ITU_EntityStorageMode storage_mode);
 void itu_sys_estorage_init(int starting_entities_count, bool enable_standard_components);
 void itu_sys_estorage_clear_all_entities();
 int  itu_sys_estorage_query_entities(Uint64 component_mask, Uint64 tag_mask);
 void itu_sys_estorage_component_sort_data(ITU_ComponentType component_type, SDL_CompareCallback fn_compare);
+// sorts a component pool in ascending key order (stable). Much faster than `itu_sys_estorage_component_sort_data`,
+// and almost free when the pool is already (nearly) sorted, so it's fine to call it every frame
+// NOTE: in archetype mode (both sorts) rows are sorted inside each archetype that has the component, so iteration
+//       is in order one archetype at a time, not across the whole storage
+void itu_sys_estorage_component_sort_keys(ITU_ComponentType component_type, ITU_ComponentSortKeyFunction fn_key);
 void itu_sys_estorage_add_system(ITU_SystemDef system_def);
 void itu_sys_estorage_set_systems(ITU_SystemDef* systems, int systems_count);
 void itu_sys_estorage_systems_update(SDLContext* context);
+// changes the schedule of an already registered system (see `ITU_SystemDef::schedule_mode`)
+void itu_sys_estorage_system_set_schedule(ITU_SystemUpdateFunction fn_update, ITU_SystemScheduleMode schedule_mode, float schedule_value);
+bool itu_sys_estorage_chunks_next(ITU_EntityChunkIterator* it, ITU_EntityChunk* out_chunk);
+void* itu_entity_chunk_column(ITU_EntityChunk* chunk, ITU_ComponentType component_type);
+void itu_sys_estorage_component_view(ITU_ComponentType component_type, ITU_ComponentView* out_view);
+int  itu_sys_estorage_component_count(ITU_ComponentType component_type);
+
+// component groups (sparse set mode only, archetypes already keep components of the same entity together)
+// the pools in `component_mask` keep the entities that have all of them packed at the front, in the same order in
+// every pool, so that joins over the group walk parallel arrays instead of jumping around through `data_loc`.
+// Kept up to date when components are added/removed and when sorting one of the pools (members stay at the front).
+// A pool can be in one group only, and Transform3D can't be grouped. Returns the group index, -1 on failure.
+// Systems whose members are exactly the group's (same component mask, no tags, no `component_mask_changed`) are handed
+// the group's entity ids directly, and `itu_view` indexes the pools with them without any lookup
+int  itu_sys_estorage_group_add(Uint64 component_mask);
+// entity ids of all entities in the group, in pool order
+int  itu_sys_estorage_group_get(int group, ITU_EntityId** out_entity_ids);
+
+// world snapshots (sparse set mode only)
+// saves every entity with all its components, tags and debug name in a single binary file. Loading maps the file and
+// copies every section straight into the pools, replacing the current world. Components and groups have to be
+// registered exactly like when the snapshot was saved (checked on load, the world is left untouched on mismatch).
+// Systems are not saved, they rebuild their member lists on load and see every entity as changed on their next run.
+// NOTE: component data is saved as-is, so pointers and handles inside components (textures, physics bodies, ...)
+//       are only valid if loaded again during the same run
+bool itu_sys_estorage_snapshot_save(const char* path);
+bool itu_sys_estorage_snapshot_load(const char* path);
+
+// rollback (sparse set mode only)
+// keeps the last `frames_count` snapshots of the world in memory, for replays, rewinding while debugging, or re-simulating
+// after a misprediction. Only the memory pages that changed since the previous snapshot are copied and stored, and
+// restoring only copies back the pages that differ from the current world. `frames_count` 0 releases everything.
+// Restoring frame N discards the frames saved after it, so that the next save is N+1 again.
+// Restored components count as changed (see `ITU_SystemDef::component_mask_changed`)
+void   itu_sys_estorage_rollback_init(int frames_count);
+// returns the frame id to pass to `itu_sys_estorage_rollback_restore`, -1 on failure
+int    itu_sys_estorage_rollback_save();
+// false if the frame is not in the ring anymore (or was saved before systems were added)
+bool   itu_sys_estorage_rollback_restore(int frame_id);
+Uint64 itu_sys_estorage_rollback_bytes_used();
 
 void itu_sys_estorage_tag_set_debug_name(int tag, const char* tag_debug_name);
+void itu_sys_estorage_tag_enable_members(ITU_TagType tag);
+int  itu_sys_estorage_tag_get_members(ITU_TagType tag, ITU_EntityId** out_entity_ids);
 void itu_sys_estorage_debug_render(SDLContext* context);
 
 ITU_EntityId itu_entity_create();
@@ -90,16 +282,165 @@ void  itu_entity_set_debug_name  (ITU_EntityId id, const char* debug_name);
 const char* itu_entity_get_debug_name (ITU_EntityId id);
 bool  itu_entity_equals          (ITU_EntityId a, ITU_EntityId b);
 bool  itu_entity_is_valid        (ITU_EntityId id);
+// id of the entity currently living at `index` (valid or not)
+ITU_EntityId itu_entity_id_from_index(Uint32 index);
 void  itu_entity_id_to_stringid  (ITU_EntityId id, char* buffer, int max_len);
 void* itu_entity_data_get        (ITU_EntityId id, ITU_ComponentType component_type);
+void* itu_entity_data_get_unchecked(ITU_EntityId id, ITU_ComponentType component_type);
+void* itu_entity_data_get_mut    (ITU_EntityId id, ITU_ComponentType component_type);
+void  itu_entity_data_mark_changed(ITU_EntityId id, ITU_ComponentType component_type);
+// current change tick, see `ITU_SystemDef::component_mask_changed`
+Uint32 itu_sys_estorage_change_tick();
 void  itu_entity_tag_add         (ITU_EntityId id, ITU_TagType tag);
 void  itu_entity_tag_remove      (ITU_EntityId id, ITU_TagType tag);
 bool  itu_entity_tag_has         (ITU_EntityId id, ITU_TagType tag);
 void  itu_entity_component_add   (ITU_EntityId id, ITU_ComponentType component_type, void* in_data_copy);
 void  itu_entity_component_remove(ITU_EntityId id, ITU_ComponentType component_type);
 void  itu_entity_destroy         (ITU_EntityId id);
+// destroys many entities at once, grouping the work per component pool/tag/system instead of per entity
+// (pools losing a large part of their entities are compacted in a single pass). Invalid and repeated ids are skipped
+void  itu_entity_destroy_batch   (ITU_EntityId* ids, int count);
+
+// prefabs
+void  itu_prefab_component_set(ITU_Prefab* prefab, ITU_ComponentType component_type, void* in_data_copy);
+void  itu_prefab_tag_add      (ITU_Prefab* prefab, ITU_TagType tag);
+void  itu_prefab_free         (ITU_Prefab* prefab);
+// creates `count` entities at once, writing their ids in `out_entity_ids` (has to fit at least `count` elements).
+// Storage is reserved once for the whole batch and component data is filled with bulk copies
+void  itu_prefab_instantiate  (ITU_Prefab* prefab, int count, ITU_EntityId* out_entity_ids);
+
+// deferred structural changes
+// operations are recorded in a per-thread command buffer and applied at the next sync point: after every level of
+// systems in `itu_sys_estorage_systems_update`, or when calling `itu_sys_estorage_deferred_apply` manually.
+// These are the only structural changes allowed from non-exclusive systems, and the safe way to change entities
+// while iterating them.
+// `itu_entity_create_deferred` returns a placeholder id that can only be used with other `_deferred` calls
+// recorded on the same thread before the next sync point
+ITU_EntityId itu_entity_create_deferred();
+void  itu_entity_destroy_deferred         (ITU_EntityId id);
+void  itu_entity_component_add_deferred   (ITU_EntityId id, ITU_ComponentType component_type, void* in_data_copy);
+void  itu_entity_component_remove_deferred(ITU_EntityId id, ITU_ComponentType component_type);
+void  itu_entity_tag_add_deferred         (ITU_EntityId id, ITU_TagType tag);
+void  itu_entity_tag_remove_deferred      (ITU_EntityId id, ITU_TagType tag);
+void  itu_sys_estorage_deferred_apply();
 
 void itu_debug_ui_widget_entityid(const char* label, ITU_EntityId id);
 void itu_debug_ui_widget_entityid_tablerow(ITU_EntityId id);
 
+// ---------------------------------------------------------------------------------------------------------------------
+// typed views
+//
+// wraps the entity list a system receives and resolves every component pool once, so that the hot loop
+// is a single paged `data_loc` load per component instead of a full `entity_get_data` (validity check, mask test, lookup).
+// usage:
+//   void my_system(SDLContext* context, ITU_EntityId* entity_ids, int entity_ids_count)
+//   {
+//       itu_view<Transform, Sprite> view(entity_ids, entity_ids_count);
+//       for(int i = 0; i < view.count; ++i)
+//       {
+//           Transform* transform = view.get<Transform>(i);
+//           Sprite*    sprite    = view.get<Sprite>(i);
+//       }
+//   }
+// NOTE: entities are NOT validated, the view assumes every entity has all of `Ts` (which is always true for
+//       the entities passed to a system with a matching `component_mask`). Pointers are only valid until the next
+//       component add/remove or entity destroy, same as `entity_get_data`. Since pools grow on demand, the view itself
+//       has to be recreated after adding components of one of its types
+// NOTE: component type ids are assigned at runtime by `enable_component`, so they are only resolved when the view
+//       is created. Element sizes and the position of each component in the view are compile-time
+
+// position of `T` in `Ts`
+template<typename T, typename... Ts> struct itu_view_index;
+template<typename T, typename... Ts> struct itu_view_index<T, T, Ts...> { static const int value = 0; };
+template<typename T, typename U, typename... Ts> struct itu_view_index<T, U, Ts...> { static const int value = 1 + itu_view_index<T, Ts...>::value; };
+
+template<typename... Ts>
+struct itu_view
+{
+	static const int components_count = sizeof...(Ts);
+
+	ITU_EntityId* entity_ids;
+	int count;
+	Uint32 tick; // written by `get_mut`/`mark_changed`
+
+	Uint64 mask; // NOTE: can't be called `component_mask`, it would clash with the macro
+	ITU_ComponentType component_types[components_count];
+	ITU_ComponentView pools[components_count];
+	int group_locs[components_count]; // location of `entity_ids[0]` in each pool, when the ids come from its group. -1 otherwise
+
+	itu_view(ITU_EntityId* entity_ids, int count) : entity_ids(entity_ids), count(count), tick(itu_sys_estorage_change_tick()), mask(0)
+	{
+		ITU_ComponentType types[components_count] = { itu_component_traits<Ts>::type()... };
+		for(int i = 0; i < components_count; ++i)
+		{
+			component_types[i] = types[i];
+			mask |= 1ull << types[i];
+			itu_sys_estorage_component_view(types[i], &pools[i]);
+
+			// ids handed out by a group (or any slice of them) line up with every pool of that group
+			group_locs[i] = -1;
+			ITU_EntityId* group_ids = pools[i].group_entity_ids;
+			if(group_ids && entity_ids >= group_ids && entity_ids + count <= group_ids + pools[i].group_count)
+				group_locs[i] = (int)(entity_ids - group_ids);
+		}
+	}
+
+	ITU_EntityId id(int i) { return entity_ids[i]; }
+
+	template<typename T>
+	T* get(int i)
+	{
+		const int idx = itu_view_index<T, Ts...>::value;
+		if(group_locs[idx] != -1)
+			return (T*)pools[idx].data + group_locs[idx] + i;
+		ITU_EntityId id = entity_ids[i];
+		// archetype mode has no fixed pool to index into
+		if(!pools[idx].data)
+			return (T*)itu_entity_data_get_unchecked(id, component_types[idx]);
+		Uint32 loc = pools[idx].data_loc_pages[id.index >> ENTITIES_SPARSE_PAGE_SHIFT][id.index & ENTITIES_SPARSE_PAGE_MASK];
+		return (T*)pools[idx].data + loc;
+	}
+
+	// same as `get`, but flags the component as changed (see `ITU_SystemDef::component_mask_changed`)
+	template<typename T>
+	T* get_mut(int i)
+	{
+		mark_changed<T>(i);
+		return get<T>(i);
+	}
+
+	// NOTE: safe to call from `itu_lib_jobs_parallel_for` batches, as long as each entity is only touched by one batch
+	template<typename T>
+	void mark_changed(int i)
+	{
+		const int idx = itu_view_index<T, Ts...>::value;
+		ITU_EntityId id = entity_ids[i];
+		pools[idx].version_pages[id.index >> ENTITIES_SPARSE_PAGE_SHIFT][id.index & ENTITIES_SPARSE_PAGE_MASK] = tick;
+	}
+
+	// whole column of `T` for these entities, to be walked as a plain array. Only when the ids come from `T`'s group
+	// (NULL otherwise)
+	//   Transform* transforms = view.group_column<Transform>(); // view.count elements
+	template<typename T>
+	T* group_column()
+	{
+		const int idx = itu_view_index<T, Ts...>::value;
+		return group_locs[idx] == -1 ? NULL : (T*)pools[idx].data + group_locs[idx];
+	}
+
+	// contiguous spans (archetype mode only): iterates all chunks containing at least `Ts`
+	//   ITU_EntityChunkIterator it = view.chunks();
+	//   ITU_EntityChunk chunk;
+	//   while(itu_sys_estorage_chunks_next(&it, &chunk))
+	//       Transform* transforms = view.column<Transform>(&chunk); // chunk.count elements
+	ITU_EntityChunkIterator chunks() { ITU_EntityChunkIterator it = { mask, 0, 0 }; return it; }
+
+	template<typename T>
+	T* column(ITU_EntityChunk* chunk)
+	{
+		const int idx = itu_view_index<T, Ts...>::value;
+		return (T*)(chunk->data + chunk->column_offsets[component_types[idx]]);
+	}
+};
+
 #endif // ITU_ENTITY_STORAGE_HPP
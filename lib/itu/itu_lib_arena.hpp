@@ -0,0 +1,208 @@
+// itu_lib_arena.hpp
+// linear allocators for temporary memory
+//
+// allocating is just bumping an offset, and everything is released at once by going back to a previous offset.
+// Two flavours are provided:
+// - frame arena: for data that has to live until the end of the frame (e.g. draw calls recorded during update and
+//   consumed at `itu_sys_render3d_frame_end`). Reset at the start of every frame by `sdl_process_events`
+//   (call `itu_lib_arena_frame_reset` yourself if you have your own main loop)
+// - scratch arenas: for data that only lives inside a function. Every thread has its own, so they are safe to use
+//   from jobs. Scopes can be nested, as long as they end in reverse order
+//
+// usage:
+//     ITU_ArenaTemp scratch = itu_lib_arena_scratch_begin(NULL);
+//     int* tmp = arena_push_array(scratch.arena, int, count);
+//     ...
+//     itu_lib_arena_scratch_end(scratch);
+//
+// important notes:
+// - arenas grow by chaining new blocks when they run out of space, so pointers are never invalidated by later pushes.
+//   Blocks added while growing are released when the arena goes back to empty, and replaced by a single bigger block,
+//   so after a few frames a steady-state frame does not touch the heap at all
+// - when a function takes an arena from its caller to push its results into, and also needs scratch memory, it has to
+//   pass that arena to `itu_lib_arena_scratch_begin` so that it gets the other scratch arena. Otherwise ending the
+//   scratch scope would free the results too
+// - memory is NOT zeroed
+
+#ifndef ITU_LIB_ARENA_HPP
+#define ITU_LIB_ARENA_HPP
+
+#ifndef ITU_UNITY_BUILD
+#include <SDL3/SDL.h>
+#include <itu_common.hpp>
+#endif
+
+#define ITU_ARENA_FRAME_BLOCK_SIZE   MB(1)
+#define ITU_ARENA_SCRATCH_BLOCK_SIZE KB(256)
+
+struct ITU_ArenaBlock
+{
+	ITU_ArenaBlock* prev;
+	Uint64 size; // usable bytes, data starts right after the header
+	Uint64 used;
+};
+
+struct ITU_Arena
+{
+	ITU_ArenaBlock* block_curr;
+	Uint64 block_size;    // size of the next block we allocate. Grows every time the arena runs out of space
+	Uint64 bytes_used;    // across all blocks
+	Uint64 bytes_used_max;
+};
+
+// position inside an arena, to go back to with `itu_lib_arena_pop_to`
+struct ITU_ArenaTemp
+{
+	ITU_Arena* arena;
+	ITU_ArenaBlock* block;
+	Uint64 used;
+	Uint64 bytes_used;
+};
+
+void* itu_lib_arena_push(ITU_Arena* arena, Uint64 size, Uint64 alignment);
+void  itu_lib_arena_clear(ITU_Arena* arena);
+void  itu_lib_arena_free(ITU_Arena* arena);
+ITU_ArenaTemp itu_lib_arena_temp_begin(ITU_Arena* arena);
+void  itu_lib_arena_pop_to(ITU_ArenaTemp temp);
+
+ITU_Arena* itu_lib_arena_frame();
+void  itu_lib_arena_frame_reset();
+
+// `conflict`: arena the caller is already pushing into (if any), see notes above. Can be NULL
+ITU_ArenaTemp itu_lib_arena_scratch_begin(ITU_Arena* conflict);
+void  itu_lib_arena_scratch_end(ITU_ArenaTemp temp);
+
+#define arena_push_struct(arena, T)       (T*)itu_lib_arena_push((arena), sizeof(T), alignof(T))
+#define arena_push_array(arena, T, count) (T*)itu_lib_arena_push((arena), sizeof(T) * (count), alignof(T))
+
+#endif // ITU_LIB_ARENA_HPP
+
+#if (defined ITU_LIB_ARENA_IMPLEMENTATION) || (defined ITU_UNITY_BUILD)
+
+struct ITU_ArenaContext
+{
+	ITU_Arena frame;
+};
+
+static ITU_ArenaContext ctx_arena;
+static thread_local ITU_Arena ctx_arena_scratch[2];
+
+void* itu_lib_arena_push(ITU_Arena* arena, Uint64 size, Uint64 alignment)
+{
+	SDL_assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+	ITU_ArenaBlock* block = arena->block_curr;
+	Uint64 offset = 0;
+	if(block)
+	{
+		uintptr_t base = (uintptr_t)(block + 1);
+		offset = ((base + block->used + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+	}
+
+	if(!block || offset + size > block->size)
+	{
+		if(arena->block_curr)
+			// ran out of space: next time we'll allocate a single block big enough for everything
+			arena->block_size *= 2;
+		arena->block_size = SDL_max(arena->block_size, ITU_ARENA_SCRATCH_BLOCK_SIZE);
+
+		Uint64 block_size = SDL_max(arena->block_size, size + alignment);
+		block = (ITU_ArenaBlock*)SDL_malloc(sizeof(ITU_ArenaBlock) + block_size);
+		block->prev = arena->block_curr;
+		block->size = block_size;
+		block->used = 0;
+		arena->block_curr = block;
+
+		uintptr_t base = (uintptr_t)(block + 1);
+		offset = ((base + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+	}
+
+	arena->bytes_used += offset + size - block->used;
+	arena->bytes_used_max = SDL_max(arena->bytes_used_max, arena->bytes_used);
+	block->used = offset + size;
+	return pointer_offset(void, block + 1, offset);
+}
+
+ITU_ArenaTemp itu_lib_arena_temp_begin(ITU_Arena* arena)
+{
+	ITU_ArenaTemp ret;
+	ret.arena = arena;
+	ret.block = arena->block_curr;
+	ret.used = arena->block_curr ? arena->block_curr->used : 0;
+	ret.bytes_used = arena->bytes_used;
+	return ret;
+}
+
+void itu_lib_arena_pop_to(ITU_ArenaTemp temp)
+{
+	ITU_Arena* arena = temp.arena;
+
+	// the scope started on an empty arena (which may still have its first block around): this is going back to empty,
+	// so the first block gets a chance to be replaced by a bigger one
+	if(temp.bytes_used == 0)
+	{
+		temp.block = NULL;
+		temp.used = 0;
+	}
+
+	while(arena->block_curr != temp.block)
+	{
+		ITU_ArenaBlock* prev = arena->block_curr->prev;
+
+		// going back to empty: keep the first block around, unless we outgrew it
+		if(!prev && arena->block_curr->size >= arena->block_size)
+		{
+			temp.block = arena->block_curr;
+			break;
+		}
+
+		SDL_free(arena->block_curr);
+		arena->block_curr = prev;
+	}
+
+	if(arena->block_curr)
+		arena->block_curr->used = temp.used;
+	arena->bytes_used = temp.bytes_used;
+}
+
+void itu_lib_arena_clear(ITU_Arena* arena)
+{
+	ITU_ArenaTemp temp = { arena, NULL, 0, 0 };
+	itu_lib_arena_pop_to(temp);
+}
+
+void itu_lib_arena_free(ITU_Arena* arena)
+{
+	while(arena->block_curr)
+	{
+		ITU_ArenaBlock* prev = arena->block_curr->prev;
+		SDL_free(arena->block_curr);
+		arena->block_curr = prev;
+	}
+	SDL_memset(arena, 0, sizeof(ITU_Arena));
+}
+
+ITU_Arena* itu_lib_arena_frame()
+{
+	if(!ctx_arena.frame.block_size)
+		ctx_arena.frame.block_size = ITU_ARENA_FRAME_BLOCK_SIZE;
+	return &ctx_arena.frame;
+}
+
+void itu_lib_arena_frame_reset()
+{
+	itu_lib_arena_clear(&ctx_arena.frame);
+}
+
+ITU_ArenaTemp itu_lib_arena_scratch_begin(ITU_Arena* conflict)
+{
+	ITU_Arena* arena = conflict == &ctx_arena_scratch[0] ? &ctx_arena_scratch[1] : &ctx_arena_scratch[0];
+	return itu_lib_arena_temp_begin(arena);
+}
+
+void itu_lib_arena_scratch_end(ITU_ArenaTemp temp)
+{
+	itu_lib_arena_pop_to(temp);
+}
+
+#endif // (defined ITU_LIB_ARENA_IMPLEMENTATION) || (defined ITU_UNITY_BUILD)
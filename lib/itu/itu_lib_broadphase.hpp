@@ -0,0 +1,922 @@
+// itu_lib_broadphase.hpp
+// uniform grid broadphase for 2D shapes: finds which pairs of AABBs (may) overlap, without testing all of them against
+// each other
+//
+// the world is split in square cells of the same size, and every proxy (AABB + user id) is stored in all the cells it
+// touches. Cells are hashed into buckets, so the world has no bounds and no memory is spent on empty space.
+// Cells are not kept up to date while proxies move: `itu_lib_broadphase_update` rebuilds all of them at once with a
+// counting sort into a single array, which is cheaper than patching cells every time something moves when most things
+// move every frame.
+//
+// usage:
+//     ITU_Broadphase broadphase;
+//     itu_lib_broadphase_init(&broadphase, cell_size, 1024);
+//     int proxy = itu_lib_broadphase_insert(&broadphase, aabb_min, aabb_max, entity_idx, false);
+//     ...
+//     // every frame
+//     itu_lib_broadphase_move(&broadphase, proxy, aabb_min, aabb_max);
+//     itu_lib_broadphase_update(&broadphase);
+//     int pairs_count = itu_lib_broadphase_pairs(&broadphase, pairs, pairs_max);
+//
+// important notes:
+// - cell size should be around the size of the typical proxy (1x-2x). Much smaller and proxies end up in a lot of
+//   cells, much bigger and cells get crowded
+// - every pair is only reported once, even when the two proxies share more than one cell
+// - pairs of static proxies are never reported
+// - call `itu_lib_broadphase_update` after moving proxies and before asking for pairs or queries, results are not
+//   reliable otherwise
+// - overlaps are AABB vs AABB only, the actual shapes have to be tested by the caller
+// - not thread safe
+//
+// sweep and prune (`ITU_BroadphaseSap`)
+// same proxies, but instead of cells it keeps the endpoints of all AABBs sorted along x and y, and the set of
+// overlapping pairs, across frames. `itu_lib_broadphase_sap_update` re-sorts the endpoints with an insertion sort: when
+// things moved only a little since the last update, endpoints are almost sorted already and only the ones that swapped
+// need any work. Only swaps can start or end an overlap, so it also reports which pairs were added and removed,
+// instead of all of them every frame.
+//
+// usage:
+//     ITU_BroadphaseSap sap;
+//     itu_lib_broadphase_sap_init(&sap, 1024);
+//     int proxy = itu_lib_broadphase_sap_insert(&sap, aabb_min, aabb_max, entity_idx, false);
+//     ...
+//     // every frame
+//     itu_lib_broadphase_sap_move(&sap, proxy, aabb_min, aabb_max);
+//     itu_lib_broadphase_sap_update(&sap);
+//     for(int i = 0; i < sap.pairs_added_count; ++i) { ... sap.pairs_added[i] ... }
+//     for(int i = 0; i < sap.pairs_removed_count; ++i) { ... sap.pairs_removed[i] ... }
+//
+// when to use which:
+// - sweep and prune is good when most things move a little every frame (or not at all), and it doesn't care about
+//   the size of proxies or how they are distributed in space
+// - cost grows with how many endpoints each endpoint passes: fast movers, teleports and big crowds along one axis
+//   (ie, lots of things with the same x) make it much slower than the grid.
+//   Inserting a lot of proxies at once falls back to a full sort, for the same reason
+
+#ifndef ITU_LIB_BROADPHASE_HPP
+#define ITU_LIB_BROADPHASE_HPP
+
+#ifndef ITU_UNITY_BUILD
+#include <itu_common.hpp>
+#endif
+
+struct ITU_BroadphasePair
+{
+	Uint32 user_id_a;
+	Uint32 user_id_b;
+};
+
+struct ITU_BroadphaseAABB
+{
+	vec2f min;
+	vec2f max;
+};
+
+struct ITU_BroadphaseProxy
+{
+	Uint32 user_id;
+	bool is_static;
+	bool is_alive;
+};
+
+// one for every cell touched by a proxy. Everything pairs and queries need is copied in, so that they only ever read
+// entries one after the other
+struct ITU_BroadphaseEntry
+{
+	ITU_BroadphaseAABB aabb;
+	Sint32 cell_x;
+	Sint32 cell_y;
+	Uint32 user_id   : 31;
+	Uint32 is_static : 1;
+};
+
+struct ITU_Broadphase
+{
+	float cell_size;
+	float cell_size_inv;
+
+	// AABBs are kept apart from the rest, since they are the only thing written every frame
+	ITU_BroadphaseAABB*  proxies_aabb;
+	ITU_BroadphaseProxy* proxies;
+	int proxies_count; // including removed ones, waiting in `proxies_free`
+	int proxies_capacity;
+	int* proxies_free;
+	int proxies_free_count;
+
+	// rebuilt by `itu_lib_broadphase_update`. Entries of bucket `b` are `entries[bucket_offsets[b]]` to `entries[bucket_offsets[b + 1]]`
+	ITU_BroadphaseEntry* entries;
+	int entries_count;
+	int entries_capacity;
+	int* bucket_offsets;
+	int buckets_count; // always a power of 2
+};
+
+void itu_lib_broadphase_init(ITU_Broadphase* broadphase, float cell_size, int proxies_capacity);
+void itu_lib_broadphase_free(ITU_Broadphase* broadphase);
+void itu_lib_broadphase_clear(ITU_Broadphase* broadphase);
+
+// returns the proxy handle, to be used for `move` and `remove`. `user_id` is what pairs and queries report
+int  itu_lib_broadphase_insert(ITU_Broadphase* broadphase, vec2f aabb_min, vec2f aabb_max, Uint32 user_id, bool is_static);
+void itu_lib_broadphase_move(ITU_Broadphase* broadphase, int proxy, vec2f aabb_min, vec2f aabb_max);
+void itu_lib_broadphase_remove(ITU_Broadphase* broadphase, int proxy);
+void itu_lib_broadphase_update(ITU_Broadphase* broadphase);
+
+// all pairs of overlapping AABBs. Writes up to `pairs_max` pairs in `out_pairs`, and returns how many there are in total
+// (so that the caller can tell when the buffer was too small)
+int  itu_lib_broadphase_pairs(ITU_Broadphase* broadphase, ITU_BroadphasePair* out_pairs, int pairs_max);
+// user ids of all proxies overlapping the AABB. Same return value as `itu_lib_broadphase_pairs`
+int  itu_lib_broadphase_query(ITU_Broadphase* broadphase, vec2f aabb_min, vec2f aabb_max, Uint32* out_user_ids, int user_ids_max);
+
+struct ITU_BroadphaseSapEndpoint
+{
+	float value;
+	Uint32 proxy  : 31;
+	Uint32 is_max : 1;
+
+	// the proxy along the other axis, now and as of the previous update. Swaps happen mostly between proxies that are
+	// far apart along the other axis, and these let them find out without looking up the proxy or the pairs
+	float other_min;
+	float other_max;
+	float other_min_prev;
+	float other_max_prev;
+};
+
+struct ITU_BroadphaseSap
+{
+	ITU_BroadphaseAABB*  proxies_aabb;
+	ITU_BroadphaseProxy* proxies;
+	int proxies_count; // including removed ones, waiting in `proxies_free`
+	int proxies_capacity;
+	int* proxies_free;
+	int proxies_free_count;
+	// removed since the last update. Their handles can't be reused before it, since their pairs are still around
+	int* proxies_removed;
+	int proxies_removed_count;
+	int proxies_inserted_count; // since the last update
+
+	// sorted by value, x and y. A max comes before a min with the same value (overlap tests are strict)
+	ITU_BroadphaseSapEndpoint* endpoints[2];
+	int endpoints_count;
+	int endpoints_capacity;
+
+	// pairs overlapping right now, as an open-addressing hash set of proxy handles (`proxy_a << 32 | proxy_b`,
+	// `proxy_a < proxy_b`). 0 marks an empty slot
+	Uint64* pairs;
+	int pairs_count;
+	int pairs_capacity; // always a power of 2
+	Uint64* pairs_scratch;
+	int pairs_scratch_capacity;
+
+	// written by `itu_lib_broadphase_sap_update`, valid until the next one
+	ITU_BroadphasePair* pairs_added;
+	int pairs_added_count;
+	int pairs_added_capacity;
+	ITU_BroadphasePair* pairs_removed;
+	int pairs_removed_count;
+	int pairs_removed_capacity;
+};
+
+void itu_lib_broadphase_sap_init(ITU_BroadphaseSap* sap, int proxies_capacity);
+void itu_lib_broadphase_sap_free(ITU_BroadphaseSap* sap);
+// removes everything, without reporting any removed pair
+void itu_lib_broadphase_sap_clear(ITU_BroadphaseSap* sap);
+
+int  itu_lib_broadphase_sap_insert(ITU_BroadphaseSap* sap, vec2f aabb_min, vec2f aabb_max, Uint32 user_id, bool is_static);
+void itu_lib_broadphase_sap_move(ITU_BroadphaseSap* sap, int proxy, vec2f aabb_min, vec2f aabb_max);
+// pairs of the removed proxy are reported as removed by the next update
+void itu_lib_broadphase_sap_remove(ITU_BroadphaseSap* sap, int proxy);
+void itu_lib_broadphase_sap_update(ITU_BroadphaseSap* sap);
+
+// all pairs overlapping as of the last update. Same return value as `itu_lib_broadphase_pairs`
+int  itu_lib_broadphase_sap_pairs(ITU_BroadphaseSap* sap, ITU_BroadphasePair* out_pairs, int pairs_max);
+
+#endif // ITU_LIB_BROADPHASE_HPP
+
+#if (defined ITU_LIB_BROADPHASE_IMPLEMENTATION) || (defined ITU_UNITY_BUILD)
+
+// NOTE: this is called a few times for every entry, every frame. `SDL_floorf` is a function call, truncating and fixing
+//       up negative numbers is not
+inline Sint32 itu_lib_broadphase_cell_coord(ITU_Broadphase* broadphase, float x)
+{
+	float f = x * broadphase->cell_size_inv;
+	Sint32 i = (Sint32)f;
+	return i - (f < (float)i);
+}
+
+inline int itu_lib_broadphase_bucket(ITU_Broadphase* broadphase, Sint32 cell_x, Sint32 cell_y)
+{
+	// large primes, so that neighbouring cells end up far apart
+	Uint32 hash = ((Uint32)cell_x * 73856093u) ^ ((Uint32)cell_y * 19349663u);
+	return (int)(hash & (Uint32)(broadphase->buckets_count - 1));
+}
+
+inline bool itu_lib_broadphase_aabb_overlap(vec2f min_0, vec2f max_0, vec2f min_1, vec2f max_1)
+{
+	return min_0.x < max_1.x && min_1.x < max_0.x && min_0.y < max_1.y && min_1.y < max_0.y;
+}
+
+// grows `*array` (of `element_size` elements) so that it can hold at least `count` elements
+static void itu_lib_broadphase_reserve(void** array, int* capacity, int count, int element_size)
+{
+	if(count <= *capacity)
+		return;
+
+	int capacity_new = SDL_max(count, SDL_max(*capacity * 2, 64));
+	*array = SDL_realloc(*array, (size_t)capacity_new * element_size);
+	SDL_assert(*array);
+	*capacity = capacity_new;
+}
+
+static void itu_lib_broadphase_reserve_proxies(ITU_Broadphase* broadphase, int count)
+{
+	if(count <= broadphase->proxies_capacity)
+		return;
+
+	itu_lib_broadphase_reserve((void**)&broadphase->proxies, &broadphase->proxies_capacity, count, sizeof(ITU_BroadphaseProxy));
+	broadphase->proxies_aabb = (ITU_BroadphaseAABB*)SDL_realloc(broadphase->proxies_aabb, sizeof(ITU_BroadphaseAABB) * broadphase->proxies_capacity);
+	broadphase->proxies_free = (int*)SDL_realloc(broadphase->proxies_free, sizeof(int) * broadphase->proxies_capacity);
+	SDL_assert(broadphase->proxies_aabb && broadphase->proxies_free);
+}
+
+void itu_lib_broadphase_init(ITU_Broadphase* broadphase, float cell_size, int proxies_capacity)
+{
+	SDL_assert(cell_size > 0);
+
+	SDL_memset(broadphase, 0, sizeof(ITU_Broadphase));
+	broadphase->cell_size = cell_size;
+	broadphase->cell_size_inv = 1.0f / cell_size;
+	itu_lib_broadphase_reserve_proxies(broadphase, proxies_capacity);
+}
+
+void itu_lib_broadphase_free(ITU_Broadphase* broadphase)
+{
+	SDL_free(broadphase->proxies_aabb);
+	SDL_free(broadphase->proxies);
+	SDL_free(broadphase->proxies_free);
+	SDL_free(broadphase->entries);
+	SDL_free(broadphase->bucket_offsets);
+	SDL_memset(broadphase, 0, sizeof(ITU_Broadphase));
+}
+
+void itu_lib_broadphase_clear(ITU_Broadphase* broadphase)
+{
+	broadphase->proxies_count = 0;
+	broadphase->proxies_free_count = 0;
+	broadphase->entries_count = 0;
+	if(broadphase->bucket_offsets)
+		SDL_memset(broadphase->bucket_offsets, 0, sizeof(int) * (broadphase->buckets_count + 1));
+}
+
+int itu_lib_broadphase_insert(ITU_Broadphase* broadphase, vec2f aabb_min, vec2f aabb_max, Uint32 user_id, bool is_static)
+{
+	int ret;
+	if(broadphase->proxies_free_count > 0)
+		ret = broadphase->proxies_free[--broadphase->proxies_free_count];
+	else
+	{
+		itu_lib_broadphase_reserve_proxies(broadphase, broadphase->proxies_count + 1);
+		ret = broadphase->proxies_count++;
+	}
+
+	SDL_assert(user_id < (1u << 31)); // has to fit in `ITU_BroadphaseEntry.user_id`
+
+	broadphase->proxies_aabb[ret].min = aabb_min;
+	broadphase->proxies_aabb[ret].max = aabb_max;
+	broadphase->proxies[ret].user_id = user_id;
+	broadphase->proxies[ret].is_static = is_static;
+	broadphase->proxies[ret].is_alive = true;
+	return ret;
+}
+
+void itu_lib_broadphase_move(ITU_Broadphase* broadphase, int proxy, vec2f aabb_min, vec2f aabb_max)
+{
+	SDL_assert(proxy >= 0 && proxy < broadphase->proxies_count && broadphase->proxies[proxy].is_alive);
+	broadphase->proxies_aabb[proxy].min = aabb_min;
+	broadphase->proxies_aabb[proxy].max = aabb_max;
+}
+
+void itu_lib_broadphase_remove(ITU_Broadphase* broadphase, int proxy)
+{
+	SDL_assert(proxy >= 0 && proxy < broadphase->proxies_count && broadphase->proxies[proxy].is_alive);
+	broadphase->proxies[proxy].is_alive = false;
+	broadphase->proxies_free[broadphase->proxies_free_count++] = proxy;
+}
+
+void itu_lib_broadphase_update(ITU_Broadphase* broadphase)
+{
+	// about two buckets per proxy keeps collisions between cells low (proxies usually touch 1 to 4 cells), without
+	// wasting too much on the offsets
+	int proxies_alive_count = broadphase->proxies_count - broadphase->proxies_free_count;
+	int buckets_count = 64;
+	while(buckets_count < proxies_alive_count * 2)
+		buckets_count *= 2;
+	if(buckets_count != broadphase->buckets_count)
+	{
+		broadphase->buckets_count = buckets_count;
+		broadphase->bucket_offsets = (int*)SDL_realloc(broadphase->bucket_offsets, sizeof(int) * (buckets_count + 1));
+		SDL_assert(broadphase->bucket_offsets);
+	}
+	int* bucket_offsets = broadphase->bucket_offsets;
+	SDL_memset(bucket_offsets, 0, sizeof(int) * (buckets_count + 1));
+
+	// counting sort: count entries per bucket...
+	int entries_count = 0;
+	for(int i = 0; i < broadphase->proxies_count; ++i)
+	{
+		if(!broadphase->proxies[i].is_alive)
+			continue;
+
+		ITU_BroadphaseAABB* aabb = &broadphase->proxies_aabb[i];
+		Sint32 cell_min_x = itu_lib_broadphase_cell_coord(broadphase, aabb->min.x);
+		Sint32 cell_min_y = itu_lib_broadphase_cell_coord(broadphase, aabb->min.y);
+		Sint32 cell_max_x = itu_lib_broadphase_cell_coord(broadphase, aabb->max.x);
+		Sint32 cell_max_y = itu_lib_broadphase_cell_coord(broadphase, aabb->max.y);
+		for(Sint32 y = cell_min_y; y <= cell_max_y; ++y)
+			for(Sint32 x = cell_min_x; x <= cell_max_x; ++x)
+				bucket_offsets[itu_lib_broadphase_bucket(broadphase, x, y) + 1]++;
+		entries_count += (cell_max_x - cell_min_x + 1) * (cell_max_y - cell_min_y + 1);
+	}
+	itu_lib_broadphase_reserve((void**)&broadphase->entries, &broadphase->entries_capacity, entries_count, sizeof(ITU_BroadphaseEntry));
+
+	// ...prefix sum to get where each bucket starts...
+	for(int i = 0; i < buckets_count; ++i)
+		bucket_offsets[i + 1] += bucket_offsets[i];
+
+	// ...and scatter. `bucket_offsets[b]` is used as the write cursor of bucket `b`, so it ends up where `b + 1` starts
+	ITU_BroadphaseEntry* entries = broadphase->entries;
+	for(int i = 0; i < broadphase->proxies_count; ++i)
+	{
+		ITU_BroadphaseProxy* proxy = &broadphase->proxies[i];
+		if(!proxy->is_alive)
+			continue;
+
+		ITU_BroadphaseAABB* aabb = &broadphase->proxies_aabb[i];
+		Sint32 cell_min_x = itu_lib_broadphase_cell_coord(broadphase, aabb->min.x);
+		Sint32 cell_min_y = itu_lib_broadphase_cell_coord(broadphase, aabb->min.y);
+		Sint32 cell_max_x = itu_lib_broadphase_cell_coord(broadphase, aabb->max.x);
+		Sint32 cell_max_y = itu_lib_broadphase_cell_coord(broadphase, aabb->max.y);
+		for(Sint32 y = cell_min_y; y <= cell_max_y; ++y)
+			for(Sint32 x = cell_min_x; x <= cell_max_x; ++x)
+			{
+				ITU_BroadphaseEntry* entry = &entries[bucket_offsets[itu_lib_broadphase_bucket(broadphase, x, y)]++];
+				entry->aabb = *aabb;
+				entry->cell_x = x;
+				entry->cell_y = y;
+				entry->user_id = proxy->user_id;
+				entry->is_static = proxy->is_static;
+			}
+	}
+	for(int i = buckets_count; i > 0; --i)
+		bucket_offsets[i] = bucket_offsets[i - 1];
+	bucket_offsets[0] = 0;
+
+	broadphase->entries_count = entries_count;
+}
+
+int itu_lib_broadphase_pairs(ITU_Broadphase* broadphase, ITU_BroadphasePair* out_pairs, int pairs_max)
+{
+	int ret = 0;
+	ITU_BroadphaseEntry* entries = broadphase->entries;
+	for(int bucket = 0; bucket < broadphase->buckets_count; ++bucket)
+	{
+		int entries_beg = broadphase->bucket_offsets[bucket];
+		int entries_end = broadphase->bucket_offsets[bucket + 1];
+		for(int i = entries_beg; i < entries_end; ++i)
+		{
+			ITU_BroadphaseEntry entry_0 = entries[i];
+			ITU_BroadphaseAABB aabb_0 = entry_0.aabb;
+			for(int j = i + 1; j < entries_end; ++j)
+			{
+				ITU_BroadphaseEntry entry_1 = entries[j];
+				ITU_BroadphaseAABB aabb_1 = entry_1.aabb;
+
+				// proxies sharing more than one cell would be found in all of them. Only the cell containing the min
+				// corner of the overlap reports the pair
+				Sint32 cell_x = itu_lib_broadphase_cell_coord(broadphase, SDL_max(aabb_0.min.x, aabb_1.min.x));
+				Sint32 cell_y = itu_lib_broadphase_cell_coord(broadphase, SDL_max(aabb_0.min.y, aabb_1.min.y));
+
+				// NOTE: all tests are done every time and combined without branching. Which ones fail is pretty much
+				//       random, and mispredicted branches were costing more than the tests themselves
+				bool is_pair =
+					// different cells can end up in the same bucket
+					(entry_0.cell_x == entry_1.cell_x) & (entry_0.cell_y == entry_1.cell_y) &
+					!(entry_0.is_static & entry_1.is_static) &
+					(aabb_0.min.x < aabb_1.max.x) & (aabb_1.min.x < aabb_0.max.x) &
+					(aabb_0.min.y < aabb_1.max.y) & (aabb_1.min.y < aabb_0.max.y) &
+					(cell_x == entry_0.cell_x) & (cell_y == entry_0.cell_y);
+
+				// written in any case, it will be overwritten by the next one if this is not a pair
+				if(ret < pairs_max)
+				{
+					out_pairs[ret].user_id_a = entry_0.user_id;
+					out_pairs[ret].user_id_b = entry_1.user_id;
+				}
+				ret += is_pair;
+			}
+		}
+	}
+	return ret;
+}
+
+int itu_lib_broadphase_query(ITU_Broadphase* broadphase, vec2f aabb_min, vec2f aabb_max, Uint32* out_user_ids, int user_ids_max)
+{
+	int ret = 0;
+	if(!broadphase->entries_count)
+		return ret;
+
+	Sint32 cell_min_x = itu_lib_broadphase_cell_coord(broadphase, aabb_min.x);
+	Sint32 cell_min_y = itu_lib_broadphase_cell_coord(broadphase, aabb_min.y);
+	Sint32 cell_max_x = itu_lib_broadphase_cell_coord(broadphase, aabb_max.x);
+	Sint32 cell_max_y = itu_lib_broadphase_cell_coord(broadphase, aabb_max.y);
+	for(Sint32 y = cell_min_y; y <= cell_max_y; ++y)
+		for(Sint32 x = cell_min_x; x <= cell_max_x; ++x)
+		{
+			int bucket = itu_lib_broadphase_bucket(broadphase, x, y);
+			for(int i = broadphase->bucket_offsets[bucket]; i < broadphase->bucket_offsets[bucket + 1]; ++i)
+			{
+				ITU_BroadphaseEntry entry = broadphase->entries[i];
+				if(entry.cell_x != x || entry.cell_y != y)
+					continue;
+				ITU_BroadphaseAABB aabb = entry.aabb;
+				if(!itu_lib_broadphase_aabb_overlap(aabb_min, aabb_max, aabb.min, aabb.max))
+					continue;
+
+				// same deduplication as `itu_lib_broadphase_pairs`
+				if(itu_lib_broadphase_cell_coord(broadphase, SDL_max(aabb_min.x, aabb.min.x)) != x || itu_lib_broadphase_cell_coord(broadphase, SDL_max(aabb_min.y, aabb.min.y)) != y)
+					continue;
+
+				if(ret < user_ids_max)
+					out_user_ids[ret] = entry.user_id;
+				++ret;
+			}
+		}
+	return ret;
+}
+
+// ********************************************************************************************************************
+// sweep and prune
+// ********************************************************************************************************************
+
+static void itu_lib_broadphase_sap_reserve_proxies(ITU_BroadphaseSap* sap, int count)
+{
+	if(count <= sap->proxies_capacity)
+		return;
+
+	itu_lib_broadphase_reserve((void**)&sap->proxies, &sap->proxies_capacity, count, sizeof(ITU_BroadphaseProxy));
+	sap->proxies_aabb    = (ITU_BroadphaseAABB*)SDL_realloc(sap->proxies_aabb, sizeof(ITU_BroadphaseAABB) * sap->proxies_capacity);
+	sap->proxies_free    = (int*)SDL_realloc(sap->proxies_free, sizeof(int) * sap->proxies_capacity);
+	sap->proxies_removed = (int*)SDL_realloc(sap->proxies_removed, sizeof(int) * sap->proxies_capacity);
+	SDL_assert(sap->proxies_aabb && sap->proxies_free && sap->proxies_removed);
+}
+
+static void itu_lib_broadphase_sap_reserve_endpoints(ITU_BroadphaseSap* sap, int count)
+{
+	if(count <= sap->endpoints_capacity)
+		return;
+
+	itu_lib_broadphase_reserve((void**)&sap->endpoints[0], &sap->endpoints_capacity, count, sizeof(ITU_BroadphaseSapEndpoint));
+	sap->endpoints[1] = (ITU_BroadphaseSapEndpoint*)SDL_realloc(sap->endpoints[1], sizeof(ITU_BroadphaseSapEndpoint) * sap->endpoints_capacity);
+	SDL_assert(sap->endpoints[1]);
+}
+
+inline Uint64 itu_lib_broadphase_sap_pair_key(Uint32 proxy_a, Uint32 proxy_b)
+{
+	return proxy_a < proxy_b ? ((Uint64)proxy_a << 32) | proxy_b : ((Uint64)proxy_b << 32) | proxy_a;
+}
+
+inline int itu_lib_broadphase_sap_pair_slot(ITU_BroadphaseSap* sap, Uint64 key)
+{
+	return (int)((key * 0x9E3779B97F4A7C15ull) >> 32) & (sap->pairs_capacity - 1);
+}
+
+static void itu_lib_broadphase_sap_pair_report(ITU_BroadphaseSap* sap, Uint64 key, bool added)
+{
+	ITU_BroadphasePair pair;
+	pair.user_id_a = sap->proxies[key >> 32].user_id;
+	pair.user_id_b = sap->proxies[key & 0xFFFFFFFF].user_id;
+	if(added)
+	{
+		itu_lib_broadphase_reserve((void**)&sap->pairs_added, &sap->pairs_added_capacity, sap->pairs_added_count + 1, sizeof(ITU_BroadphasePair));
+		sap->pairs_added[sap->pairs_added_count++] = pair;
+	}
+	else
+	{
+		itu_lib_broadphase_reserve((void**)&sap->pairs_removed, &sap->pairs_removed_capacity, sap->pairs_removed_count + 1, sizeof(ITU_BroadphasePair));
+		sap->pairs_removed[sap->pairs_removed_count++] = pair;
+	}
+}
+
+static bool itu_lib_broadphase_sap_pair_find(ITU_BroadphaseSap* sap, Uint64 key)
+{
+	if(!sap->pairs_capacity)
+		return false;
+
+	for(int slot = itu_lib_broadphase_sap_pair_slot(sap, key); sap->pairs[slot]; slot = (slot + 1) & (sap->pairs_capacity - 1))
+		if(sap->pairs[slot] == key)
+			return true;
+	return false;
+}
+
+// returns false if the pair was already there
+static bool itu_lib_broadphase_sap_pair_insert(ITU_BroadphaseSap* sap, Uint64 key)
+{
+	// grow at half load, probe sequences get long quickly after that
+	if((sap->pairs_count + 1) * 2 > sap->pairs_capacity)
+	{
+		Uint64* pairs_old = sap->pairs;
+		int pairs_capacity_old = sap->pairs_capacity;
+
+		sap->pairs_capacity = SDL_max(pairs_capacity_old * 2, 1024);
+		sap->pairs = (Uint64*)SDL_calloc(sap->pairs_capacity, sizeof(Uint64));
+		SDL_assert(sap->pairs);
+		for(int i = 0; i < pairs_capacity_old; ++i)
+		{
+			if(!pairs_old[i])
+				continue;
+			int slot = itu_lib_broadphase_sap_pair_slot(sap, pairs_old[i]);
+			while(sap->pairs[slot])
+				slot = (slot + 1) & (sap->pairs_capacity - 1);
+			sap->pairs[slot] = pairs_old[i];
+		}
+		SDL_free(pairs_old);
+	}
+
+	int slot = itu_lib_broadphase_sap_pair_slot(sap, key);
+	for(; sap->pairs[slot]; slot = (slot + 1) & (sap->pairs_capacity - 1))
+		if(sap->pairs[slot] == key)
+			return false;
+	sap->pairs[slot] = key;
+	sap->pairs_count++;
+	return true;
+}
+
+// returns false if the pair wasn't there
+static bool itu_lib_broadphase_sap_pair_remove(ITU_BroadphaseSap* sap, Uint64 key)
+{
+	if(!sap->pairs_capacity)
+		return false;
+
+	int mask = sap->pairs_capacity - 1;
+	int slot = itu_lib_broadphase_sap_pair_slot(sap, key);
+	for(; sap->pairs[slot] != key; slot = (slot + 1) & mask)
+		if(!sap->pairs[slot])
+			return false;
+
+	// backward shift: moves back every following key that would still be found from its own slot, so that probe
+	// sequences never have holes (no tombstones needed)
+	int hole = slot;
+	for(int i = (slot + 1) & mask; sap->pairs[i]; i = (i + 1) & mask)
+	{
+		int home = itu_lib_broadphase_sap_pair_slot(sap, sap->pairs[i]);
+		bool can_move = hole <= i ? (home <= hole || home > i) : (home <= hole && home > i);
+		if(can_move)
+		{
+			sap->pairs[hole] = sap->pairs[i];
+			hole = i;
+		}
+	}
+	sap->pairs[hole] = 0;
+	sap->pairs_count--;
+	return true;
+}
+
+static void itu_lib_broadphase_sap_reserve_scratch(ITU_BroadphaseSap* sap, int count)
+{
+	itu_lib_broadphase_reserve((void**)&sap->pairs_scratch, &sap->pairs_scratch_capacity, count, sizeof(Uint64));
+}
+
+inline bool itu_lib_broadphase_sap_endpoint_less(ITU_BroadphaseSapEndpoint a, ITU_BroadphaseSapEndpoint b)
+{
+	return a.value < b.value || (a.value == b.value && a.is_max > b.is_max);
+}
+
+static int itu_lib_broadphase_sap_endpoint_compare(const void* a, const void* b)
+{
+	ITU_BroadphaseSapEndpoint endpoint_a = *(const ITU_BroadphaseSapEndpoint*)a;
+	ITU_BroadphaseSapEndpoint endpoint_b = *(const ITU_BroadphaseSapEndpoint*)b;
+	return itu_lib_broadphase_sap_endpoint_less(endpoint_a, endpoint_b) ? -1 : itu_lib_broadphase_sap_endpoint_less(endpoint_b, endpoint_a);
+}
+
+static int itu_lib_broadphase_sap_key_compare(const void* a, const void* b)
+{
+	Uint64 key_a = *(const Uint64*)a;
+	Uint64 key_b = *(const Uint64*)b;
+	return (key_a > key_b) - (key_a < key_b);
+}
+
+static void itu_lib_broadphase_sap_refresh_endpoints(ITU_BroadphaseSap* sap, int axis)
+{
+	ITU_BroadphaseSapEndpoint* endpoints = sap->endpoints[axis];
+	for(int i = 0; i < sap->endpoints_count; ++i)
+	{
+		ITU_BroadphaseSapEndpoint* endpoint = &endpoints[i];
+		ITU_BroadphaseAABB* aabb = &sap->proxies_aabb[endpoint->proxy];
+		vec2f point = endpoint->is_max ? aabb->max : aabb->min;
+		endpoint->value = axis ? point.y : point.x;
+		endpoint->other_min_prev = endpoint->other_min;
+		endpoint->other_max_prev = endpoint->other_max;
+		endpoint->other_min = axis ? aabb->min.x : aabb->min.y;
+		endpoint->other_max = axis ? aabb->max.x : aabb->max.y;
+	}
+}
+
+// endpoint `moving` (of proxy a) just went left past `other` (of proxy b), so their order now matches the new AABBs.
+// It's enough to know which kind of endpoints they are:
+// - a min going past a max: they may have started overlapping, if the new AABBs overlap it's a pair
+// - a max going past a min: they don't overlap anymore. It was a pair only if the old AABBs overlapped (a pair added
+//   earlier in this update would need the new ones to overlap, and they don't)
+// NOTE: the other axis is tested on the new AABBs even if it is not sorted yet. It doesn't matter: a pair changing
+//       on both axes is found by both sorts, and the set ignores adding a pair twice or removing one that isn't there
+static void itu_lib_broadphase_sap_swap(ITU_BroadphaseSap* sap, ITU_BroadphaseSapEndpoint* moving, ITU_BroadphaseSapEndpoint* other)
+{
+	if(!moving->is_max)
+	{
+		if(moving->other_min >= other->other_max || other->other_min >= moving->other_max)
+			return;
+
+		ITU_BroadphaseAABB* aabb_a = &sap->proxies_aabb[moving->proxy];
+		ITU_BroadphaseAABB* aabb_b = &sap->proxies_aabb[other->proxy];
+		if(!itu_lib_broadphase_aabb_overlap(aabb_a->min, aabb_a->max, aabb_b->min, aabb_b->max))
+			return;
+		if(sap->proxies[moving->proxy].is_static && sap->proxies[other->proxy].is_static)
+			return;
+
+		Uint64 key = itu_lib_broadphase_sap_pair_key(moving->proxy, other->proxy);
+		if(itu_lib_broadphase_sap_pair_insert(sap, key))
+			itu_lib_broadphase_sap_pair_report(sap, key, true);
+	}
+	else
+	{
+		if(moving->other_min_prev >= other->other_max_prev || other->other_min_prev >= moving->other_max_prev)
+			return;
+
+		Uint64 key = itu_lib_broadphase_sap_pair_key(moving->proxy, other->proxy);
+		if(itu_lib_broadphase_sap_pair_remove(sap, key))
+			itu_lib_broadphase_sap_pair_report(sap, key, false);
+	}
+}
+
+static void itu_lib_broadphase_sap_sort(ITU_BroadphaseSap* sap, int axis)
+{
+	itu_lib_broadphase_sap_refresh_endpoints(sap, axis);
+
+	ITU_BroadphaseSapEndpoint* endpoints = sap->endpoints[axis];
+	for(int i = 1; i < sap->endpoints_count; ++i)
+	{
+		ITU_BroadphaseSapEndpoint moving = endpoints[i];
+		int j = i - 1;
+		for(; j >= 0 && itu_lib_broadphase_sap_endpoint_less(moving, endpoints[j]); --j)
+		{
+			// min/min and max/max swaps don't change anything
+			if(moving.is_max != endpoints[j].is_max && moving.proxy != endpoints[j].proxy)
+				itu_lib_broadphase_sap_swap(sap, &moving, &endpoints[j]);
+			endpoints[j + 1] = endpoints[j];
+		}
+		endpoints[j + 1] = moving;
+	}
+}
+
+// full sort and sweep along x, used when too many proxies are new for insertion sort to be any good
+static void itu_lib_broadphase_sap_rebuild(ITU_BroadphaseSap* sap)
+{
+	for(int axis = 0; axis < 2; ++axis)
+	{
+		itu_lib_broadphase_sap_refresh_endpoints(sap, axis);
+		SDL_qsort(sap->endpoints[axis], sap->endpoints_count, sizeof(ITU_BroadphaseSapEndpoint), itu_lib_broadphase_sap_endpoint_compare);
+	}
+
+	// proxies whose min has been passed but not their max, all overlapping along x with the next min we find.
+	// `active_index` is where each one is in the list, so that they can be swapped out when we find their max
+	int* active = (int*)SDL_malloc(sizeof(int) * SDL_max(sap->proxies_count, 1));
+	int* active_index = (int*)SDL_malloc(sizeof(int) * SDL_max(sap->proxies_count, 1));
+	SDL_assert(active && active_index);
+	int active_count = 0;
+	int found_count = 0;
+	for(int i = 0; i < sap->endpoints_count; ++i)
+	{
+		ITU_BroadphaseSapEndpoint endpoint = sap->endpoints[0][i];
+		if(endpoint.is_max)
+		{
+			int index = active_index[endpoint.proxy];
+			active[index] = active[--active_count];
+			active_index[active[index]] = index;
+			continue;
+		}
+
+		ITU_BroadphaseProxy* proxy = &sap->proxies[endpoint.proxy];
+		ITU_BroadphaseAABB* aabb = &sap->proxies_aabb[endpoint.proxy];
+		for(int k = 0; k < active_count; ++k)
+		{
+			int other = active[k];
+			if(proxy->is_static && sap->proxies[other].is_static)
+				continue;
+			ITU_BroadphaseAABB* aabb_other = &sap->proxies_aabb[other];
+			if(!itu_lib_broadphase_aabb_overlap(aabb->min, aabb->max, aabb_other->min, aabb_other->max))
+				continue;
+
+			itu_lib_broadphase_sap_reserve_scratch(sap, found_count + 1);
+			sap->pairs_scratch[found_count++] = itu_lib_broadphase_sap_pair_key(endpoint.proxy, other);
+		}
+		active_index[endpoint.proxy] = active_count;
+		active[active_count++] = endpoint.proxy;
+	}
+	SDL_free(active);
+	SDL_free(active_index);
+
+	// diff against the old set, so that pairs that were already there are not reported again
+	SDL_qsort(sap->pairs_scratch, found_count, sizeof(Uint64), itu_lib_broadphase_sap_key_compare);
+	for(int i = 0; i < sap->pairs_capacity; ++i)
+	{
+		Uint64 key = sap->pairs[i];
+		if(!key)
+			continue;
+
+		int lo = 0;
+		int hi = found_count;
+		while(lo < hi)
+		{
+			int mid = (lo + hi) / 2;
+			if(sap->pairs_scratch[mid] < key)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if(lo == found_count || sap->pairs_scratch[lo] != key)
+			itu_lib_broadphase_sap_pair_report(sap, key, false);
+	}
+	for(int i = 0; i < found_count; ++i)
+		if(!itu_lib_broadphase_sap_pair_find(sap, sap->pairs_scratch[i]))
+			itu_lib_broadphase_sap_pair_report(sap, sap->pairs_scratch[i], true);
+
+	if(sap->pairs_capacity)
+		SDL_memset(sap->pairs, 0, sizeof(Uint64) * sap->pairs_capacity);
+	sap->pairs_count = 0;
+	for(int i = 0; i < found_count; ++i)
+		itu_lib_broadphase_sap_pair_insert(sap, sap->pairs_scratch[i]);
+}
+
+// drops endpoints and pairs of the proxies removed since the last update
+static void itu_lib_broadphase_sap_flush_removed(ITU_BroadphaseSap* sap)
+{
+	for(int axis = 0; axis < 2; ++axis)
+	{
+		ITU_BroadphaseSapEndpoint* endpoints = sap->endpoints[axis];
+		int count = 0;
+		for(int i = 0; i < sap->endpoints_count; ++i)
+			if(sap->proxies[endpoints[i].proxy].is_alive)
+				endpoints[count++] = endpoints[i];
+	}
+	sap->endpoints_count -= sap->proxies_removed_count * 2;
+
+	int removed_count = 0;
+	for(int i = 0; i < sap->pairs_capacity; ++i)
+	{
+		Uint64 key = sap->pairs[i];
+		if(!key || (sap->proxies[key >> 32].is_alive && sap->proxies[key & 0xFFFFFFFF].is_alive))
+			continue;
+
+		itu_lib_broadphase_sap_reserve_scratch(sap, removed_count + 1);
+		sap->pairs_scratch[removed_count++] = key;
+	}
+	for(int i = 0; i < removed_count; ++i)
+	{
+		itu_lib_broadphase_sap_pair_report(sap, sap->pairs_scratch[i], false);
+		itu_lib_broadphase_sap_pair_remove(sap, sap->pairs_scratch[i]);
+	}
+
+	for(int i = 0; i < sap->proxies_removed_count; ++i)
+		sap->proxies_free[sap->proxies_free_count++] = sap->proxies_removed[i];
+	sap->proxies_removed_count = 0;
+}
+
+void itu_lib_broadphase_sap_init(ITU_BroadphaseSap* sap, int proxies_capacity)
+{
+	SDL_memset(sap, 0, sizeof(ITU_BroadphaseSap));
+	itu_lib_broadphase_sap_reserve_proxies(sap, proxies_capacity);
+	itu_lib_broadphase_sap_reserve_endpoints(sap, proxies_capacity * 2);
+}
+
+void itu_lib_broadphase_sap_free(ITU_BroadphaseSap* sap)
+{
+	SDL_free(sap->proxies_aabb);
+	SDL_free(sap->proxies);
+	SDL_free(sap->proxies_free);
+	SDL_free(sap->proxies_removed);
+	SDL_free(sap->endpoints[0]);
+	SDL_free(sap->endpoints[1]);
+	SDL_free(sap->pairs);
+	SDL_free(sap->pairs_scratch);
+	SDL_free(sap->pairs_added);
+	SDL_free(sap->pairs_removed);
+	SDL_memset(sap, 0, sizeof(ITU_BroadphaseSap));
+}
+
+void itu_lib_broadphase_sap_clear(ITU_BroadphaseSap* sap)
+{
+	sap->proxies_count = 0;
+	sap->proxies_free_count = 0;
+	sap->proxies_removed_count = 0;
+	sap->proxies_inserted_count = 0;
+	sap->endpoints_count = 0;
+	if(sap->pairs_capacity)
+		SDL_memset(sap->pairs, 0, sizeof(Uint64) * sap->pairs_capacity);
+	sap->pairs_count = 0;
+	sap->pairs_added_count = 0;
+	sap->pairs_removed_count = 0;
+}
+
+int itu_lib_broadphase_sap_insert(ITU_BroadphaseSap* sap, vec2f aabb_min, vec2f aabb_max, Uint32 user_id, bool is_static)
+{
+	int ret;
+	if(sap->proxies_free_count > 0)
+		ret = sap->proxies_free[--sap->proxies_free_count];
+	else
+	{
+		itu_lib_broadphase_sap_reserve_proxies(sap, sap->proxies_count + 1);
+		ret = sap->proxies_count++;
+	}
+
+	sap->proxies_aabb[ret].min = aabb_min;
+	sap->proxies_aabb[ret].max = aabb_max;
+	sap->proxies[ret].user_id = user_id;
+	sap->proxies[ret].is_static = is_static;
+	sap->proxies[ret].is_alive = true;
+
+	// appended at the end, the next update sorts them in place (and finds their pairs while doing so)
+	itu_lib_broadphase_sap_reserve_endpoints(sap, sap->endpoints_count + 2);
+	for(int axis = 0; axis < 2; ++axis)
+	{
+		// NOTE: values are written by the next update. `other_*_prev` will be whatever is here, which is fine since
+		//       they only let swaps skip work, and a new proxy has no pair to remove anyway
+		ITU_BroadphaseSapEndpoint endpoint;
+		endpoint.proxy = ret;
+		endpoint.value = 0;
+		endpoint.other_min = 0;
+		endpoint.other_max = 0;
+		endpoint.other_min_prev = 0;
+		endpoint.other_max_prev = 0;
+		endpoint.is_max = 0;
+		sap->endpoints[axis][sap->endpoints_count] = endpoint;
+		endpoint.is_max = 1;
+		sap->endpoints[axis][sap->endpoints_count + 1] = endpoint;
+	}
+	sap->endpoints_count += 2;
+	sap->proxies_inserted_count++;
+	return ret;
+}
+
+void itu_lib_broadphase_sap_move(ITU_BroadphaseSap* sap, int proxy, vec2f aabb_min, vec2f aabb_max)
+{
+	SDL_assert(proxy >= 0 && proxy < sap->proxies_count && sap->proxies[proxy].is_alive);
+	sap->proxies_aabb[proxy].min = aabb_min;
+	sap->proxies_aabb[proxy].max = aabb_max;
+}
+
+void itu_lib_broadphase_sap_remove(ITU_BroadphaseSap* sap, int proxy)
+{
+	SDL_assert(proxy >= 0 && proxy < sap->proxies_count && sap->proxies[proxy].is_alive);
+	sap->proxies[proxy].is_alive = false;
+	sap->proxies_removed[sap->proxies_removed_count++] = proxy;
+}
+
+void itu_lib_broadphase_sap_update(ITU_BroadphaseSap* sap)
+{
+	sap->pairs_added_count = 0;
+	sap->pairs_removed_count = 0;
+
+	if(sap->proxies_removed_count > 0)
+		itu_lib_broadphase_sap_flush_removed(sap);
+
+	// a new proxy starts at the end of the lists and could have to go past all other endpoints: a few of them are
+	// fine, a lot of them (ie, the first update) make insertion sort quadratic
+	bool rebuild = sap->proxies_inserted_count * 8 > sap->endpoints_count / 2;
+	sap->proxies_inserted_count = 0;
+	if(rebuild)
+		itu_lib_broadphase_sap_rebuild(sap);
+	else
+	{
+		itu_lib_broadphase_sap_sort(sap, 0);
+		itu_lib_broadphase_sap_sort(sap, 1);
+	}
+}
+
+int itu_lib_broadphase_sap_pairs(ITU_BroadphaseSap* sap, ITU_BroadphasePair* out_pairs, int pairs_max)
+{
+	int ret = 0;
+	for(int i = 0; i < sap->pairs_capacity; ++i)
+	{
+		Uint64 key = sap->pairs[i];
+		if(!key)
+			continue;
+
+		if(ret < pairs_max)
+		{
+			out_pairs[ret].user_id_a = sap->proxies[key >> 32].user_id;
+			out_pairs[ret].user_id_b = sap->proxies[key & 0xFFFFFFFF].user_id;
+		}
+		++ret;
+	}
+	return ret;
+}
+
+#endif // (defined ITU_LIB_BROADPHASE_IMPLEMENTATION) || (defined ITU_UNITY_BUILD)
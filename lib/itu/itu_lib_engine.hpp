@@ -11,6 +11,7 @@
 #include <stb_ds.h>
 #include <stb_image.h>
 #include <itu_common.hpp>
+#include <itu_lib_arena.hpp>
 #include <imgui/imgui.h>
 #endif
 
@@ -333,6 +334,9 @@ void sdl_input_mouse_button_process(SDLContext* context, BtnType button_id, SDL_
 
 bool sdl_process_events(SDLContext* context)
 {
+	// this is the first thing every frame, whatever was allocated in the frame arena last frame is not needed anymore
+	itu_lib_arena_frame_reset();
+
 	// input
 	bool ret = false;
 	SDL_Event event;
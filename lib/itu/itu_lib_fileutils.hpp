@@ -1,7 +1,21 @@
 #ifndef ITU_LIB_FILEUTILS_HPP
 #define ITU_LIB_FILEUTILS_HPP
 
+#ifndef ITU_UNITY_BUILD
+#include <SDL3/SDL_stdinc.h>
+#endif
+
+// read-only view of a whole file, mapped in memory by the OS instead of being read into a buffer
+// (pages are loaded on first access, and only copied where we copy them ourselves)
+struct ITU_FileMapping
+{
+	const unsigned char* data;
+	Uint64 size;
+};
+
 const char* itu_lib_fileutils_get_file_name(const char* path);
+bool itu_lib_fileutils_map(const char* path, ITU_FileMapping* out_mapping);
+void itu_lib_fileutils_unmap(ITU_FileMapping* mapping);
 
 #endif // ITU_LIB_FILEUTILS_HPP
 
@@ -21,6 +35,41 @@ const char* itu_lib_fileutils_get_file_name(const char* path);
 #define is_path_separator(c) ((c) == '/')
 #endif
 
+#ifdef SDL_PLATFORM_WINDOWS
+// NOTE: <windows.h> is not included on purpose. This file is compiled into every unity build TU, and windows.h
+//       defines macros like `near`, `far`, `min`, `max` that break unrelated code (e.g. `CameraComponent`).
+//       We only need a handful of kernel32 functions, so they are declared here with the exact same signatures
+//       (redeclaring them is fine if windows.h does get included by someone else)
+extern "C"
+{
+	union _LARGE_INTEGER;
+	struct _SECURITY_ATTRIBUTES;
+	__declspec(dllimport) void* __stdcall CreateFileA(const char* lpFileName, unsigned long dwDesiredAccess, unsigned long dwShareMode, struct _SECURITY_ATTRIBUTES* lpSecurityAttributes, unsigned long dwCreationDisposition, unsigned long dwFlagsAndAttributes, void* hTemplateFile);
+	__declspec(dllimport) int   __stdcall GetFileSizeEx(void* hFile, union _LARGE_INTEGER* lpFileSize);
+	__declspec(dllimport) void* __stdcall CreateFileMappingA(void* hFile, struct _SECURITY_ATTRIBUTES* lpFileMappingAttributes, unsigned long flProtect, unsigned long dwMaximumSizeHigh, unsigned long dwMaximumSizeLow, const char* lpName);
+	__declspec(dllimport) void* __stdcall MapViewOfFile(void* hFileMappingObject, unsigned long dwDesiredAccess, unsigned long dwFileOffsetHigh, unsigned long dwFileOffsetLow, size_t dwNumberOfBytesToMap);
+	__declspec(dllimport) int   __stdcall UnmapViewOfFile(const void* lpBaseAddress);
+	__declspec(dllimport) int   __stdcall CloseHandle(void* hObject);
+}
+
+// values from the Win32 headers
+enum
+{
+	ITU_WIN32_GENERIC_READ          = 0x80000000,
+	ITU_WIN32_FILE_SHARE_READ       = 0x00000001,
+	ITU_WIN32_OPEN_EXISTING         = 3,
+	ITU_WIN32_FILE_ATTRIBUTE_NORMAL = 0x00000080,
+	ITU_WIN32_PAGE_READONLY         = 0x00000002,
+	ITU_WIN32_FILE_MAP_READ         = 0x00000004,
+};
+#define ITU_WIN32_INVALID_HANDLE_VALUE ((void*)(intptr_t)-1)
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 const char* itu_lib_fileutils_get_file_name(const char* path)
 {
 	const char* ret = path;
@@ -35,4 +84,83 @@ const char* itu_lib_fileutils_get_file_name(const char* path)
 	return ret;
 }
 
+bool itu_lib_fileutils_map(const char* path, ITU_FileMapping* out_mapping)
+{
+	out_mapping->data = NULL;
+	out_mapping->size = 0;
+
+	// NOTE: the view stays valid after closing the handles, it's only released by unmapping it
+#ifdef SDL_PLATFORM_WINDOWS
+	void* file = CreateFileA(path, ITU_WIN32_GENERIC_READ, ITU_WIN32_FILE_SHARE_READ, NULL, ITU_WIN32_OPEN_EXISTING, ITU_WIN32_FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == ITU_WIN32_INVALID_HANDLE_VALUE)
+	{
+		SDL_Log("WARNING could not open %s\n", path);
+		return false;
+	}
+
+	long long size;
+	if(!GetFileSizeEx(file, (union _LARGE_INTEGER*)&size) || size == 0)
+	{
+		SDL_Log("WARNING could not map %s (empty file?)\n", path);
+		CloseHandle(file);
+		return false;
+	}
+
+	void* mapping = CreateFileMappingA(file, NULL, ITU_WIN32_PAGE_READONLY, 0, 0, NULL);
+	void* data = mapping ? MapViewOfFile(mapping, ITU_WIN32_FILE_MAP_READ, 0, 0, 0) : NULL;
+	if(mapping)
+		CloseHandle(mapping);
+	CloseHandle(file);
+	if(!data)
+	{
+		SDL_Log("WARNING could not map %s\n", path);
+		return false;
+	}
+
+	out_mapping->data = (const unsigned char*)data;
+	out_mapping->size = (Uint64)size;
+#else
+	int fd = open(path, O_RDONLY);
+	if(fd == -1)
+	{
+		SDL_Log("WARNING could not open %s\n", path);
+		return false;
+	}
+
+	struct stat file_stat;
+	if(fstat(fd, &file_stat) == -1 || file_stat.st_size == 0)
+	{
+		SDL_Log("WARNING could not map %s (empty file?)\n", path);
+		close(fd);
+		return false;
+	}
+
+	void* data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED)
+	{
+		SDL_Log("WARNING could not map %s\n", path);
+		return false;
+	}
+
+	out_mapping->data = (const unsigned char*)data;
+	out_mapping->size = (Uint64)file_stat.st_size;
+#endif
+	return true;
+}
+
+void itu_lib_fileutils_unmap(ITU_FileMapping* mapping)
+{
+	if(!mapping->data)
+		return;
+
+#ifdef SDL_PLATFORM_WINDOWS
+	UnmapViewOfFile(mapping->data);
+#else
+	munmap((void*)mapping->data, mapping->size);
+#endif
+	mapping->data = NULL;
+	mapping->size = 0;
+}
+
 #endif //  (defined ITU_LIB_FILEUTILS_IMPLEMENTATION) || (defined ITU_UNITY_BUILD)
\ No newline at end of file
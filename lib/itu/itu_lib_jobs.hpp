@@ -0,0 +1,190 @@
+// itu_lib_jobs.hpp
+// minimal worker pool used to run systems (and loops inside systems) on every core
+//
+// there is only ever one job in flight: a job is a function called over an index range [0, count), split in batches
+// that the calling thread and all workers grab until the range is exhausted. The calling thread always participates
+// and the call only returns once every batch is done.
+//
+// important notes:
+// - nested calls (i.e. `itu_lib_jobs_parallel_for` from inside a job, or from another thread while a job is running)
+//   run serially on the calling thread. This makes it always safe for a system to call `itu_lib_jobs_parallel_for`,
+//   it just won't go wide if the system itself is running in parallel with other systems
+// - the pool is created lazily on first use if `itu_lib_jobs_init` was never called
+
+#ifndef ITU_LIB_JOBS_HPP
+#define ITU_LIB_JOBS_HPP
+
+#ifndef ITU_UNITY_BUILD
+#include <SDL3/SDL.h>
+#endif
+
+#define ITU_JOBS_WORKERS_MAX 64
+
+// processes elements [idx_beg, idx_end)
+typedef void (*ITU_JobFunction)(void* userdata, int idx_beg, int idx_end);
+
+// `workers_count` does NOT include the calling thread. Pass 0 to use one worker per logical core (minus the calling thread)
+void itu_lib_jobs_init(int workers_count);
+void itu_lib_jobs_shutdown();
+int  itu_lib_jobs_threads_count();
+// 0 for the calling thread (or any thread that is not a worker), [1, itu_lib_jobs_threads_count()) for workers.
+// Useful to index per-thread data
+int  itu_lib_jobs_thread_index();
+
+// calls `fn` over [0, count) in batches of at least `batch_min` elements, blocking until all of them are done
+void itu_lib_jobs_parallel_for(ITU_JobFunction fn, void* userdata, int count, int batch_min);
+
+#endif // ITU_LIB_JOBS_HPP
+
+#if (defined ITU_LIB_JOBS_IMPLEMENTATION) || (defined ITU_UNITY_BUILD)
+
+struct ITU_JobsContext
+{
+	bool initialized;
+	SDL_AtomicInt quit;
+
+	SDL_Thread* workers[ITU_JOBS_WORKERS_MAX];
+	int workers_count;
+
+	SDL_Semaphore* sem_work; // signaled once per worker when a job starts
+	SDL_Semaphore* sem_done; // signaled once by each worker when it can't find any more batches
+
+	SDL_AtomicInt busy; // 1 while a job is in flight
+
+	// current job
+	ITU_JobFunction fn;
+	void* userdata;
+	int count;
+	int batch_size;
+	SDL_AtomicInt idx_next;
+};
+
+static ITU_JobsContext ctx_jobs;
+static thread_local int ctx_jobs_thread_index;
+
+static void itu_lib_jobs_run_batches()
+{
+	for(;;)
+	{
+		int idx_beg = SDL_AddAtomicInt(&ctx_jobs.idx_next, ctx_jobs.batch_size);
+		if(idx_beg >= ctx_jobs.count)
+			return;
+
+		int idx_end = SDL_min(idx_beg + ctx_jobs.batch_size, ctx_jobs.count);
+		ctx_jobs.fn(ctx_jobs.userdata, idx_beg, idx_end);
+	}
+}
+
+static int itu_lib_jobs_worker_main(void* data)
+{
+	ctx_jobs_thread_index = (int)(intptr_t)data;
+	for(;;)
+	{
+		SDL_WaitSemaphore(ctx_jobs.sem_work);
+		if(SDL_GetAtomicInt(&ctx_jobs.quit))
+			return 0;
+
+		itu_lib_jobs_run_batches();
+		SDL_SignalSemaphore(ctx_jobs.sem_done);
+	}
+}
+
+void itu_lib_jobs_init(int workers_count)
+{
+	if(ctx_jobs.initialized)
+		return;
+
+	if(workers_count <= 0)
+		workers_count = SDL_GetNumLogicalCPUCores() - 1;
+	workers_count = SDL_clamp(workers_count, 0, ITU_JOBS_WORKERS_MAX);
+
+	ctx_jobs.sem_work = SDL_CreateSemaphore(0);
+	ctx_jobs.sem_done = SDL_CreateSemaphore(0);
+	SDL_SetAtomicInt(&ctx_jobs.quit, 0);
+	SDL_SetAtomicInt(&ctx_jobs.busy, 0);
+
+	ctx_jobs.workers_count = 0;
+	for(int i = 0; i < workers_count; ++i)
+	{
+		SDL_Thread* thread = SDL_CreateThread(itu_lib_jobs_worker_main, "itu_worker", (void*)(intptr_t)(i + 1));
+		if(!thread)
+		{
+			SDL_Log("WARNING failed to create worker thread: %s", SDL_GetError());
+			break;
+		}
+		ctx_jobs.workers[ctx_jobs.workers_count++] = thread;
+	}
+
+	ctx_jobs.initialized = true;
+}
+
+void itu_lib_jobs_shutdown()
+{
+	if(!ctx_jobs.initialized)
+		return;
+
+	SDL_SetAtomicInt(&ctx_jobs.quit, 1);
+	for(int i = 0; i < ctx_jobs.workers_count; ++i)
+		SDL_SignalSemaphore(ctx_jobs.sem_work);
+	for(int i = 0; i < ctx_jobs.workers_count; ++i)
+		SDL_WaitThread(ctx_jobs.workers[i], NULL);
+
+	SDL_DestroySemaphore(ctx_jobs.sem_work);
+	SDL_DestroySemaphore(ctx_jobs.sem_done);
+	SDL_memset(&ctx_jobs, 0, sizeof(ctx_jobs));
+}
+
+int itu_lib_jobs_threads_count()
+{
+	if(!ctx_jobs.initialized)
+		itu_lib_jobs_init(0);
+
+	return ctx_jobs.workers_count + 1;
+}
+
+int itu_lib_jobs_thread_index()
+{
+	return ctx_jobs_thread_index;
+}
+
+void itu_lib_jobs_parallel_for(ITU_JobFunction fn, void* userdata, int count, int batch_min)
+{
+	if(count <= 0)
+		return;
+
+	if(!ctx_jobs.initialized)
+		itu_lib_jobs_init(0);
+
+	batch_min = SDL_max(batch_min, 1);
+
+	// not worth waking anybody up (or the pool is already busy with the job we are being called from)
+	if(count <= batch_min || ctx_jobs.workers_count == 0 || !SDL_CompareAndSwapAtomicInt(&ctx_jobs.busy, 0, 1))
+	{
+		fn(userdata, 0, count);
+		return;
+	}
+
+	// aim for a few batches per thread, so that uneven batches can balance out
+	int threads_count = ctx_jobs.workers_count + 1;
+	int batch_size = SDL_max(batch_min, count / (threads_count * 4));
+	int batches_count = (count + batch_size - 1) / batch_size;
+	int workers_needed = SDL_min(ctx_jobs.workers_count, batches_count - 1);
+
+	ctx_jobs.fn = fn;
+	ctx_jobs.userdata = userdata;
+	ctx_jobs.count = count;
+	ctx_jobs.batch_size = batch_size;
+	SDL_SetAtomicInt(&ctx_jobs.idx_next, 0);
+
+	for(int i = 0; i < workers_needed; ++i)
+		SDL_SignalSemaphore(ctx_jobs.sem_work);
+
+	itu_lib_jobs_run_batches();
+
+	for(int i = 0; i < workers_needed; ++i)
+		SDL_WaitSemaphore(ctx_jobs.sem_done);
+
+	SDL_SetAtomicInt(&ctx_jobs.busy, 0);
+}
+
+#endif // (defined ITU_LIB_JOBS_IMPLEMENTATION) || (defined ITU_UNITY_BUILD)
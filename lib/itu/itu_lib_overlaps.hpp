@@ -18,18 +18,28 @@
 //       - parallel segments are not considering overlapping (see point above)
 // - polygons are assumed to be in CCW (counter-clockwise) order
 // - polygon methods use simple algorithms, so they won't scale to polygons with a lot of edges
+// - GJK tests work on any convex shape described by its support function (polygons, circles, capsules and rects),
+//   and can be warm-started with the simplex they found on the previous frame
+// - `_manifold` tests also return how the shapes overlap (normal, depth and contact points), computed together with
+//   the test itself. The normal always goes from the first shape to the second one
+// - batch tests (one shape against many, or many against each other) take shapes as separate arrays of coordinates
+//   (structure of arrays), and use SSE2/AVX2 when the CPU has them. Results are the same as the single-pair tests
 
 #ifndef ITU_LIB_OVERLAPS_HPP
 #define ITU_LIB_OVERLAPS_HPP
 
 #ifndef ITU_UNITY_BUILD
 #include <itu_common.hpp>
+#include <SDL3/SDL_intrin.h>  // SSE2/AVX2 intrinsics, SDL_TARGETING()
+#include <SDL3/SDL_cpuinfo.h> // SDL_HasSSE2(), SDL_HasAVX2()
 #endif
 
-// SDL functions used here (all coming from `itu_common`):
+// SDL functions used here (all coming from `itu_common`, except for the ones used by batch tests):
 // - SDL_Log()
 // - SDL_sqrt()
 // - SDL_assert()
+// - SDL_HasSSE2()
+// - SDL_HasAVX2()
 
 
 bool itu_lib_overlaps_point_circle(vec2f point, vec2f circle_center, float circle_radius);
@@ -45,7 +55,115 @@ bool itu_lib_overlaps_point_polygon(vec2f point, vec2f* polygon_vertices, int po
 bool itu_lib_overlaps_segment_polygon(vec2f segment_a, vec2f segment_b, vec2f* polygon_vertices, int poligon_vertices_count);
 bool itu_lib_overlaps_circle_polygon(vec2f circle_center, float circle_radius, vec2f* polygon_vertices, int poligon_vertices_count);
 bool itu_lib_overlaps_rect_polygon(vec2f rect_min, vec2f rect_max, vec2f* polygon_vertices, int poligon_vertices_count);
-bool itu_lib_overlaps_polygon_polygon(vec2f* polygon_0_vertices, int poligon_0_vertices_count, vec2f* polygon_1_vertices, int poligon_1_vertices_count, vec2f* out_simplex, int* out_simplex_count);
+
+// contact manifolds
+// moving the first shape by `-normal * depth` (or both by half of that, in opposite directions) separates the shapes.
+// Contact points lie where the shapes touch (roughly in the middle of the overlap)
+#define ITU_OVERLAPS_MANIFOLD_POINTS_MAX 2
+
+struct ITU_OverlapsManifold
+{
+	vec2f normal; // unit length, from the first shape to the second one
+	float depth;
+	vec2f points[ITU_OVERLAPS_MANIFOLD_POINTS_MAX];
+	int points_count;
+};
+
+// these return false (and leave `out_manifold` untouched) if the shapes don't overlap
+bool itu_lib_overlaps_circle_circle_manifold(vec2f circle_center_0, float circle_radius_0, vec2f circle_center_1, float circle_radius_1, ITU_OverlapsManifold* out_manifold);
+bool itu_lib_overlaps_circle_rect_manifold(vec2f circle_center, float circle_radius, vec2f rect_min, vec2f rect_max, ITU_OverlapsManifold* out_manifold);
+bool itu_lib_overlaps_rect_rect_manifold(vec2f rect_min_0, vec2f rect_max_0, vec2f rect_min_1, vec2f rect_max_1, ITU_OverlapsManifold* out_manifold);
+bool itu_lib_overlaps_circle_polygon_manifold(vec2f circle_center, float circle_radius, vec2f* polygon_vertices, int poligon_vertices_count, ITU_OverlapsManifold* out_manifold);
+bool itu_lib_overlaps_rect_polygon_manifold(vec2f rect_min, vec2f rect_max, vec2f* polygon_vertices, int poligon_vertices_count, ITU_OverlapsManifold* out_manifold);
+bool itu_lib_overlaps_polygon_polygon_manifold(vec2f* polygon_0_vertices, int poligon_0_vertices_count, vec2f* polygon_1_vertices, int poligon_1_vertices_count, ITU_OverlapsManifold* out_manifold);
+
+// GJK
+// shapes are only ever accessed through their support function (the furthest point of the shape in a given direction),
+// so the same test works for every pair of convex shapes.
+// `simplex` is optional. When it's not empty, the search starts from it instead of from scratch: keeping one per pair
+// of shapes and passing it back every frame makes pairs that moved only a little converge in one or two iterations.
+// It stores search directions, not points, so it stays valid when the shapes move (a stale one is just a worse start)
+#define ITU_OVERLAPS_GJK_ITERATIONS_MAX 32
+#define ITU_OVERLAPS_EPA_POINTS_MAX     64
+#define ITU_OVERLAPS_EPA_TOLERANCE      0.0001f
+
+enum ITU_OverlapsShapeType
+{
+	ITU_OVERLAPS_SHAPE_POLYGON,
+	ITU_OVERLAPS_SHAPE_CIRCLE,
+	ITU_OVERLAPS_SHAPE_CAPSULE,
+	ITU_OVERLAPS_SHAPE_RECT,
+};
+
+struct ITU_OverlapsShape
+{
+	ITU_OverlapsShapeType type;
+	union
+	{
+		struct { vec2f* vertices; int vertices_count; } polygon; // convex, any winding
+		struct { vec2f center; float radius; } circle;
+		struct { vec2f a; vec2f b; float radius; } capsule;
+		struct { vec2f min; vec2f max; } rect;
+	};
+};
+
+struct ITU_OverlapsSimplexPoint
+{
+	vec2f point;     // on the Minkowski difference (shape 0 - shape 1)
+	vec2f point_0;   // on shape 0
+	vec2f point_1;   // on shape 1
+	vec2f direction; // direction used to find it
+};
+
+struct ITU_OverlapsSimplex
+{
+	ITU_OverlapsSimplexPoint points[3];
+	int points_count;
+	int iterations; // how many iterations the last test needed (debug info)
+};
+
+ITU_OverlapsShape itu_lib_overlaps_shape_polygon(vec2f* vertices, int vertices_count);
+ITU_OverlapsShape itu_lib_overlaps_shape_circle(vec2f center, float radius);
+ITU_OverlapsShape itu_lib_overlaps_shape_capsule(vec2f a, vec2f b, float radius);
+ITU_OverlapsShape itu_lib_overlaps_shape_rect(vec2f rect_min, vec2f rect_max);
+
+bool itu_lib_overlaps_gjk(ITU_OverlapsShape* shape_0, ITU_OverlapsShape* shape_1, ITU_OverlapsSimplex* simplex);
+// GJK, then EPA to find normal and penetration depth. Only one contact point
+bool itu_lib_overlaps_gjk_manifold(ITU_OverlapsShape* shape_0, ITU_OverlapsShape* shape_1, ITU_OverlapsSimplex* simplex, ITU_OverlapsManifold* out_manifold);
+// same as `itu_lib_overlaps_gjk` on two polygons
+bool itu_lib_overlaps_polygon_polygon(vec2f* polygon_0_vertices, int poligon_0_vertices_count, vec2f* polygon_1_vertices, int poligon_1_vertices_count, ITU_OverlapsSimplex* simplex);
+
+// batch tests
+// one-vs-N tests set bit `i % 64` of `out_mask[i / 64]` when shape `i` overlaps (`out_mask` needs room for
+// `(count + 63) / 64` masks), and return how many shapes overlap.
+// N-vs-N tests write the pairs of overlapping shapes (`index_a < index_b`), up to `pairs_max`, and return how many
+// pairs there are in total (so that the caller can tell when the buffer was too small). They test all pairs, so they
+// are meant for small sets of shapes (ie, the content of a broadphase cell)
+enum ITU_OverlapsSimd
+{
+	ITU_OVERLAPS_SIMD_NONE,
+	ITU_OVERLAPS_SIMD_SSE2,
+	ITU_OVERLAPS_SIMD_AVX2,
+};
+
+struct ITU_OverlapsPair
+{
+	int index_a;
+	int index_b;
+};
+
+int itu_lib_overlaps_circle_circles(vec2f circle_center, float circle_radius, const float* centers_x, const float* centers_y, const float* radii, int count, Uint64* out_mask);
+int itu_lib_overlaps_rect_rects(vec2f rect_min, vec2f rect_max, const float* rects_min_x, const float* rects_min_y, const float* rects_max_x, const float* rects_max_y, int count, Uint64* out_mask);
+int itu_lib_overlaps_circles_circles(const float* centers_x, const float* centers_y, const float* radii, int count, ITU_OverlapsPair* out_pairs, int pairs_max);
+int itu_lib_overlaps_rects_rects(const float* rects_min_x, const float* rects_min_y, const float* rects_max_x, const float* rects_max_y, int count, ITU_OverlapsPair* out_pairs, int pairs_max);
+
+// writes the index of every bit set in a mask written by a one-vs-N test, returns how many
+int itu_lib_overlaps_mask_to_indices(const Uint64* mask, int count, int* out_indices);
+
+// batch tests use the best instruction set the CPU supports. This can force a lower one (mostly to compare them),
+// asking for one that is not supported falls back to the best one that is
+void itu_lib_overlaps_simd_set(ITU_OverlapsSimd simd);
+ITU_OverlapsSimd itu_lib_overlaps_simd_get();
 
 #endif // ITU_LIB_COLLISIONS_HPP
 
@@ -264,144 +382,917 @@ bool itu_lib_overlaps_rect_polygon(vec2f rect_min, vec2f rect_max, vec2f* polygo
 	return false;
 }
 
-static vec2f gjk_support_polygon(vec2f dir, vec2f* vertices, int vertices_count)
+// ********************************************************************************************************************
+// contact manifolds
+// ********************************************************************************************************************
+
+bool itu_lib_overlaps_circle_circle_manifold(vec2f circle_center_0, float circle_radius_0, vec2f circle_center_1, float circle_radius_1, ITU_OverlapsManifold* out_manifold)
 {
-	vec2f ret = vertices[0];
-	float support_max = dot(dir, ret);
+	SDL_assert(out_manifold);
+
+	vec2f d = circle_center_1 - circle_center_0;
+	float d_sq = length_sq(d);
+	float r_sum = circle_radius_0 + circle_radius_1;
+	// same test as `itu_lib_overlaps_circle_circle`, the square root is only needed when there is an overlap
+	if(d_sq >= r_sum * r_sum)
+		return false;
+
+	float distance = SDL_sqrtf(d_sq);
+	// NOTE: concentric circles can be separated in any direction, just pick one
+	out_manifold->normal = distance > 0 ? d * (1.0f / distance) : VEC2F_UP;
+	out_manifold->depth = r_sum - distance;
+	out_manifold->points[0] = circle_center_0 + out_manifold->normal * (circle_radius_0 - out_manifold->depth * 0.5f);
+	out_manifold->points_count = 1;
+	return true;
+}
 
-	for (int i = 1; i < vertices_count; ++i)
+bool itu_lib_overlaps_circle_rect_manifold(vec2f circle_center, float circle_radius, vec2f rect_min, vec2f rect_max, ITU_OverlapsManifold* out_manifold)
+{
+	SDL_assert(out_manifold);
+
+	// closest point of the rect to the circle center
+	vec2f closest = vec2f{ SDL_clamp(circle_center.x, rect_min.x, rect_max.x), SDL_clamp(circle_center.y, rect_min.y, rect_max.y) };
+	vec2f d = closest - circle_center;
+	float d_sq = length_sq(d);
+
+	if(d_sq > 0)
 	{
-		float support = dot(vertices[i], dir);
-		if (support > support_max)
+		if(d_sq >= circle_radius * circle_radius)
+			return false;
+
+		float distance = SDL_sqrtf(d_sq);
+		out_manifold->normal = d * (1.0f / distance);
+		out_manifold->depth = circle_radius - distance;
+		out_manifold->points[0] = closest;
+		out_manifold->points_count = 1;
+		return true;
+	}
+
+	// center inside the rect: the circle goes out from the closest edge
+	float distance_left   = circle_center.x - rect_min.x;
+	float distance_right  = rect_max.x - circle_center.x;
+	float distance_bottom = circle_center.y - rect_min.y;
+	float distance_top    = rect_max.y - circle_center.y;
+	float distance_min = SDL_min(SDL_min(distance_left, distance_right), SDL_min(distance_bottom, distance_top));
+
+	vec2f exit;
+	if(distance_min == distance_left)
+		exit = VEC2F_LEFT;
+	else if(distance_min == distance_right)
+		exit = VEC2F_RIGHT;
+	else if(distance_min == distance_bottom)
+		exit = VEC2F_DOWN;
+	else
+		exit = VEC2F_UP;
+
+	out_manifold->normal = -exit;
+	out_manifold->depth = circle_radius + distance_min;
+	out_manifold->points[0] = circle_center + exit * distance_min;
+	out_manifold->points_count = 1;
+	return true;
+}
+
+bool itu_lib_overlaps_rect_rect_manifold(vec2f rect_min_0, vec2f rect_max_0, vec2f rect_min_1, vec2f rect_max_1, ITU_OverlapsManifold* out_manifold)
+{
+	SDL_assert(out_manifold);
+
+	// how far rect 0 must move to get out of rect 1 on each side (same strict test as `itu_lib_overlaps_rect_rect`)
+	float penetration_right = rect_max_0.x - rect_min_1.x;
+	float penetration_left  = rect_max_1.x - rect_min_0.x;
+	float penetration_up    = rect_max_0.y - rect_min_1.y;
+	float penetration_down  = rect_max_1.y - rect_min_0.y;
+	if(penetration_right <= 0 || penetration_left <= 0 || penetration_up <= 0 || penetration_down <= 0)
+		return false;
+
+	// separate along the smallest one. Contact points are the two ends of the overlap, halfway through it
+	// NOTE: the overlap is not the penetration when one rect contains the other along an axis
+	vec2f overlap_min = vec2f{ SDL_max(rect_min_0.x, rect_min_1.x), SDL_max(rect_min_0.y, rect_min_1.y) };
+	vec2f overlap_max = vec2f{ SDL_min(rect_max_0.x, rect_max_1.x), SDL_min(rect_max_0.y, rect_max_1.y) };
+	float penetration_x = SDL_min(penetration_right, penetration_left);
+	float penetration_y = SDL_min(penetration_up, penetration_down);
+	if(penetration_x < penetration_y)
+	{
+		float x = (overlap_min.x + overlap_max.x) * 0.5f;
+		out_manifold->normal = penetration_right < penetration_left ? VEC2F_RIGHT : VEC2F_LEFT;
+		out_manifold->depth = penetration_x;
+		out_manifold->points[0] = vec2f{ x, overlap_min.y };
+		out_manifold->points[1] = vec2f{ x, overlap_max.y };
+	}
+	else
+	{
+		float y = (overlap_min.y + overlap_max.y) * 0.5f;
+		out_manifold->normal = penetration_up < penetration_down ? VEC2F_UP : VEC2F_DOWN;
+		out_manifold->depth = penetration_y;
+		out_manifold->points[0] = vec2f{ overlap_min.x, y };
+		out_manifold->points[1] = vec2f{ overlap_max.x, y };
+	}
+	out_manifold->points_count = 2;
+	return true;
+}
+
+// outward normal of edge `i` (from vertex `i` to `i + 1`), polygon in CCW order
+static vec2f itu_lib_overlaps_polygon_edge_normal(vec2f* vertices, int vertices_count, int i)
+{
+	vec2f edge = vertices[(i + 1) % vertices_count] - vertices[i];
+	return normalize(vec2f{ edge.y, -edge.x });
+}
+
+// edge of polygon 0 along which polygon 1 is the furthest out (separating axis test). Positive means there is a gap
+static float itu_lib_overlaps_polygon_separation_max(vec2f* vertices_0, int vertices_0_count, vec2f* vertices_1, int vertices_1_count, int* out_edge)
+{
+	float ret = -SDL_MAX_SINT32;
+	*out_edge = 0;
+	for(int i = 0; i < vertices_0_count; ++i)
+	{
+		vec2f normal = itu_lib_overlaps_polygon_edge_normal(vertices_0, vertices_0_count, i);
+
+		// deepest vertex of polygon 1 along the normal
+		float separation = dot(normal, vertices_1[0] - vertices_0[i]);
+		for(int j = 1; j < vertices_1_count; ++j)
+			separation = SDL_min(separation, dot(normal, vertices_1[j] - vertices_0[i]));
+
+		if(separation > ret)
 		{
-			support_max = support;
-			ret = vertices[i];
+			ret = separation;
+			*out_edge = i;
 		}
 	}
-
 	return ret;
 }
 
-// NOTE: assumes polygons are convex AND counter0clockwise
-bool itu_lib_overlaps_polygon_polygon(vec2f* polygon_0_vertices, int poligon_0_vertices_count, vec2f* polygon_1_vertices, int poligon_1_vertices_count, vec2f* out_simplex)
+bool itu_lib_overlaps_circle_polygon_manifold(vec2f circle_center, float circle_radius, vec2f* polygon_vertices, int poligon_vertices_count, ITU_OverlapsManifold* out_manifold)
+{
+	SDL_assert(polygon_vertices);
+	SDL_assert(out_manifold);
+
+	// edge closest to the center
+	float separation_max = -SDL_MAX_SINT32;
+	int edge = 0;
+	for(int i = 0; i < poligon_vertices_count; ++i)
+	{
+		float separation = dot(itu_lib_overlaps_polygon_edge_normal(polygon_vertices, poligon_vertices_count, i), circle_center - polygon_vertices[i]);
+		if(separation > separation_max)
+		{
+			separation_max = separation;
+			edge = i;
+		}
+	}
+	if(separation_max >= circle_radius)
+		return false;
+
+	vec2f a = polygon_vertices[edge];
+	vec2f b = polygon_vertices[(edge + 1) % poligon_vertices_count];
+	vec2f normal = itu_lib_overlaps_polygon_edge_normal(polygon_vertices, poligon_vertices_count, edge);
+
+	// outside the polygon, but past one of the ends of the edge: the closest feature is the vertex
+	vec2f vertex = a;
+	bool is_vertex = false;
+	if(separation_max > 0)
+	{
+		if(dot(circle_center - a, b - a) <= 0)
+			is_vertex = true;
+		else if(dot(circle_center - b, a - b) <= 0)
+		{
+			is_vertex = true;
+			vertex = b;
+		}
+	}
+
+	if(is_vertex)
+	{
+		vec2f d = vertex - circle_center;
+		float d_sq = length_sq(d);
+		if(d_sq >= circle_radius * circle_radius)
+			return false;
+
+		float distance = SDL_sqrtf(d_sq);
+		out_manifold->normal = d * (1.0f / distance);
+		out_manifold->depth = circle_radius - distance;
+		out_manifold->points[0] = vertex;
+	}
+	else
+	{
+		// closest to the edge (or inside the polygon)
+		out_manifold->normal = -normal;
+		out_manifold->depth = circle_radius - separation_max;
+		out_manifold->points[0] = circle_center - normal * separation_max;
+	}
+	out_manifold->points_count = 1;
+	return true;
+}
+
+bool itu_lib_overlaps_rect_polygon_manifold(vec2f rect_min, vec2f rect_max, vec2f* polygon_vertices, int poligon_vertices_count, ITU_OverlapsManifold* out_manifold)
+{
+	vec2f rect_vertices[4] = { rect_min, vec2f{ rect_max.x, rect_min.y }, rect_max, vec2f{ rect_min.x, rect_max.y } };
+	return itu_lib_overlaps_polygon_polygon_manifold(rect_vertices, 4, polygon_vertices, poligon_vertices_count, out_manifold);
+}
+
+// separating axis test, plus clipping for the contact points
+// NOTE: assumes polygons are convex AND counter-clockwise
+bool itu_lib_overlaps_polygon_polygon_manifold(vec2f* polygon_0_vertices, int poligon_0_vertices_count, vec2f* polygon_1_vertices, int poligon_1_vertices_count, ITU_OverlapsManifold* out_manifold)
 {
 	SDL_assert(polygon_0_vertices);
 	SDL_assert(polygon_1_vertices);
+	SDL_assert(out_manifold);
 
-	// main GJK implementation
-	// from https://www.youtube.com/watch?v=Qupqu1xe7Io (adapted for 2D)
-	// NOTE: we need only 3 vertices, since the 2D simplex is a triangle
-	// NOTE: most algorithms that perform separation of arbitrary polygons will need the last simplex found by GJK
-	vec2f support_points[3] = { };
-	vec2f closest_points1[3] = { };
-	vec2f closest_points2[3] = { };
-	int support_points_count = 0;
-
-	// NOTE: choose appropriate first direction
-	vec2f direction = VEC2F_UP;
-
-	// NOTE: hardcoding the support function here because the purpose of this library is illustrative.
-	//       the true power of GJK comes form the fact that the algorithms works exactly the same *disregarding the support function implementation*
-	//       We could just pass arbitrary data and a type (ie, tagged union or similar) and we have an extrimely performant function that works for
-	//       all shapes
-	closest_points1[support_points_count] = gjk_support_polygon(direction, polygon_0_vertices, poligon_0_vertices_count);
-	closest_points2[support_points_count] = gjk_support_polygon(-direction, polygon_1_vertices, poligon_1_vertices_count);
-	support_points[support_points_count++] = closest_points1[support_points_count] - closest_points2[support_points_count];
-	direction = -support_points[0];
-
-	const int max_iter = 128;
-	int i = 0;
-	bool ret = false;
+	int edge_0, edge_1;
+	float separation_0 = itu_lib_overlaps_polygon_separation_max(polygon_0_vertices, poligon_0_vertices_count, polygon_1_vertices, poligon_1_vertices_count, &edge_0);
+	if(separation_0 >= 0)
+		return false;
+	float separation_1 = itu_lib_overlaps_polygon_separation_max(polygon_1_vertices, poligon_1_vertices_count, polygon_0_vertices, poligon_0_vertices_count, &edge_1);
+	if(separation_1 >= 0)
+		return false;
 
-	for(i = 0; i < max_iter; ++i)
+	// the edge with the smallest penetration is the "reference" one, and its polygon is the one we are pushing against.
+	// Polygon 0 is preferred when they're (almost) the same, so that the choice doesn't flicker between frames
+	vec2f* reference_vertices = polygon_0_vertices;
+	int    reference_count    = poligon_0_vertices_count;
+	int    reference_edge     = edge_0;
+	vec2f* incident_vertices  = polygon_1_vertices;
+	int    incident_count     = poligon_1_vertices_count;
+	bool   flip = false;
+	if(separation_1 > separation_0 + 0.001f)
 	{
-		closest_points1[support_points_count] = gjk_support_polygon(direction, polygon_0_vertices, poligon_0_vertices_count);
-		closest_points2[support_points_count] = gjk_support_polygon(-direction, polygon_1_vertices, poligon_1_vertices_count);
-		vec2f a = closest_points1[support_points_count] - closest_points2[support_points_count];
+		reference_vertices = polygon_1_vertices;
+		reference_count    = poligon_1_vertices_count;
+		reference_edge     = edge_1;
+		incident_vertices  = polygon_0_vertices;
+		incident_count     = poligon_0_vertices_count;
+		flip = true;
+	}
 
-		if(dot(a, direction) < 0)
-			break;
+	vec2f reference_normal = itu_lib_overlaps_polygon_edge_normal(reference_vertices, reference_count, reference_edge);
+	vec2f reference_a = reference_vertices[reference_edge];
+	vec2f reference_b = reference_vertices[(reference_edge + 1) % reference_count];
 
-		support_points[support_points_count++] = a;
+	// incident edge: the one facing the reference edge the most
+	int incident_edge = 0;
+	float incident_dot_min = dot(reference_normal, itu_lib_overlaps_polygon_edge_normal(incident_vertices, incident_count, 0));
+	for(int i = 1; i < incident_count; ++i)
+	{
+		float d = dot(reference_normal, itu_lib_overlaps_polygon_edge_normal(incident_vertices, incident_count, i));
+		if(d < incident_dot_min)
+		{
+			incident_dot_min = d;
+			incident_edge = i;
+		}
+	}
+	vec2f clip[2] = { incident_vertices[incident_edge], incident_vertices[(incident_edge + 1) % incident_count] };
+
+	// clip the incident edge to the sides of the reference edge
+	vec2f tangent = normalize(reference_b - reference_a);
+	float sides[2]   = { -dot(tangent, reference_a), dot(tangent, reference_b) };
+	vec2f sides_n[2] = { vec2f{ -tangent.x, -tangent.y }, tangent };
+	bool clipped_away = false;
+	for(int side = 0; side < 2 && !clipped_away; ++side)
+	{
+		float distance_0 = dot(sides_n[side], clip[0]) - sides[side];
+		float distance_1 = dot(sides_n[side], clip[1]) - sides[side];
+		if(distance_0 > 0 && distance_1 > 0)
+			clipped_away = true;
+		else if(distance_0 > 0)
+			clip[0] = clip[0] + (clip[1] - clip[0]) * (distance_0 / (distance_0 - distance_1));
+		else if(distance_1 > 0)
+			clip[1] = clip[1] + (clip[0] - clip[1]) * (distance_1 / (distance_1 - distance_0));
+	}
 
-		// do simplex
+	// only points behind the reference edge are in contact
+	out_manifold->depth = 0;
+	out_manifold->points_count = 0;
+	for(int i = 0; i < 2 && !clipped_away; ++i)
+	{
+		float separation = dot(reference_normal, clip[i] - reference_a);
+		if(separation >= 0)
+			continue;
+		out_manifold->points[out_manifold->points_count++] = clip[i] - reference_normal * (separation * 0.5f);
+		out_manifold->depth = SDL_max(out_manifold->depth, -separation);
+	}
+	if(out_manifold->points_count == 0)
+	{
+		// NOTE: shallow corner-against-corner overlaps can get clipped away entirely, even if SAT found no separating
+		//       axis. Fall back to the deepest vertex of the incident polygon
+		vec2f deepest = incident_vertices[0];
+		float separation_min = dot(reference_normal, deepest - reference_a);
+		for(int i = 1; i < incident_count; ++i)
 		{
-			/* simplex configuration
-			 * 
-			 * 
-			 * edge            a -- b
-			 * 
-			 * triangle        a -- b
-			 *                  \   |
-			 *                   \  |
-			 *                    \ |
-			 *                      c
-			 */
-			vec2f b = support_points[support_points_count-2];
-			vec2f ab = b - a;
-			vec2f a0 = -a;
-			float sign_ab = dot(ab, a0);
-
-			// edge
-			if(support_points_count == 2)
+			float separation = dot(reference_normal, incident_vertices[i] - reference_a);
+			if(separation < separation_min)
 			{
-				if(sign_ab > 0)
-				{
-					// if the origin points in the same direction as B, we need to search perpendicular to the segment
-					// (no need to check if we need to search in the direction of B, since we came from there)
-					support_points[0] = b;
-					support_points[1] = a;
-					support_points_count = 2;
-					direction = cross_triplet(ab, a0, ab);
-				}
-				else 
-				{
-					// if the origin points away from B, we need to search in the direction of the origin
-					support_points[0] = a;
-					support_points_count = 1;
-					direction = a0;
-				}
+				separation_min = separation;
+				deepest = incident_vertices[i];
 			}
-			// triangle
-			else if(support_points_count == 3)
-			{
-				vec2f c = support_points[support_points_count-3];
-				vec2f ac = c - a;
-				float sign_ac = dot(ac, a0);
+		}
+		out_manifold->points[0] = deepest - reference_normal * (separation_min * 0.5f);
+		out_manifold->points_count = 1;
+		out_manifold->depth = -separation_min;
+	}
 
-				if(sign_ab > 0 && sign_ac > 0)
-				{
-					// inside the triangle
-					ret = true;
-					break;
-				}
-				else if(sign_ac > 0)
-				{
-					//case AC
-					support_points[0] = c;
-					support_points[1] = a;
-					support_points_count = 2;
-					direction = cross_triplet(ac, a0, ac);
-					continue;
-				}
-				else
+	out_manifold->normal = flip ? -reference_normal : reference_normal;
+	return true;
+}
+
+// ********************************************************************************************************************
+// GJK
+// ********************************************************************************************************************
+
+ITU_OverlapsShape itu_lib_overlaps_shape_polygon(vec2f* vertices, int vertices_count)
+{
+	SDL_assert(vertices);
+	SDL_assert(vertices_count > 0);
+
+	ITU_OverlapsShape ret;
+	ret.type = ITU_OVERLAPS_SHAPE_POLYGON;
+	ret.polygon.vertices = vertices;
+	ret.polygon.vertices_count = vertices_count;
+	return ret;
+}
+
+ITU_OverlapsShape itu_lib_overlaps_shape_circle(vec2f center, float radius)
+{
+	ITU_OverlapsShape ret;
+	ret.type = ITU_OVERLAPS_SHAPE_CIRCLE;
+	ret.circle.center = center;
+	ret.circle.radius = radius;
+	return ret;
+}
+
+ITU_OverlapsShape itu_lib_overlaps_shape_capsule(vec2f a, vec2f b, float radius)
+{
+	ITU_OverlapsShape ret;
+	ret.type = ITU_OVERLAPS_SHAPE_CAPSULE;
+	ret.capsule.a = a;
+	ret.capsule.b = b;
+	ret.capsule.radius = radius;
+	return ret;
+}
+
+ITU_OverlapsShape itu_lib_overlaps_shape_rect(vec2f rect_min, vec2f rect_max)
+{
+	ITU_OverlapsShape ret;
+	ret.type = ITU_OVERLAPS_SHAPE_RECT;
+	ret.rect.min = rect_min;
+	ret.rect.max = rect_max;
+	return ret;
+}
+
+// furthest point of the shape along `direction` (which doesn't need to be normalized)
+static vec2f itu_lib_overlaps_support(ITU_OverlapsShape* shape, vec2f direction)
+{
+	switch(shape->type)
+	{
+		case ITU_OVERLAPS_SHAPE_POLYGON:
+		{
+			vec2f* vertices = shape->polygon.vertices;
+			vec2f ret = vertices[0];
+			float support_max = dot(direction, ret);
+			for(int i = 1; i < shape->polygon.vertices_count; ++i)
+			{
+				float support = dot(direction, vertices[i]);
+				if(support > support_max)
 				{
-					support_points[0] = b;
-					support_points[1] = a;
-					support_points_count = 2;
-					direction = cross_triplet(ab, a0, ab);
-					continue;
+					support_max = support;
+					ret = vertices[i];
 				}
-				break;
 			}
-			else
-			{
-				// this should never happen in 2D
-				SDL_Log("[GJK] inpossible case: support_points_count == %d\n", support_points_count);
+			return ret;
+		}
+		case ITU_OVERLAPS_SHAPE_CIRCLE:
+			return shape->circle.center + normalize(direction) * shape->circle.radius;
+		case ITU_OVERLAPS_SHAPE_CAPSULE:
+		{
+			vec2f ret = dot(direction, shape->capsule.a) > dot(direction, shape->capsule.b) ? shape->capsule.a : shape->capsule.b;
+			return ret + normalize(direction) * shape->capsule.radius;
+		}
+		case ITU_OVERLAPS_SHAPE_RECT:
+			return vec2f{ direction.x > 0 ? shape->rect.max.x : shape->rect.min.x, direction.y > 0 ? shape->rect.max.y : shape->rect.min.y };
+	}
+	SDL_assert(false && "unknown shape type");
+	return VEC2F_ZERO;
+}
+
+static ITU_OverlapsSimplexPoint itu_lib_overlaps_support_minkowski(ITU_OverlapsShape* shape_0, ITU_OverlapsShape* shape_1, vec2f direction)
+{
+	ITU_OverlapsSimplexPoint ret;
+	ret.point_0 = itu_lib_overlaps_support(shape_0, direction);
+	ret.point_1 = itu_lib_overlaps_support(shape_1, -direction);
+	ret.point = ret.point_0 - ret.point_1;
+	ret.direction = direction;
+	return ret;
+}
+
+// reduces the simplex to the smallest feature (vertex, edge or the whole triangle) closest to the origin, and returns
+// the closest point on it. Regions are tested with barycentric coordinates (same as Box2D's `b2Simplex::Solve3`)
+static vec2f itu_lib_overlaps_simplex_solve(ITU_OverlapsSimplex* simplex)
+{
+	ITU_OverlapsSimplexPoint* points = simplex->points;
+	vec2f w1 = points[0].point;
+	if(simplex->points_count == 1)
+		return w1;
+
+	vec2f w2 = points[1].point;
+	vec2f e12 = w2 - w1;
+	float d12_1 = dot(w2, e12);
+	float d12_2 = -dot(w1, e12);
+
+	if(simplex->points_count == 2)
+	{
+		if(d12_2 <= 0)
+		{
+			simplex->points_count = 1;
+			return w1;
+		}
+		if(d12_1 <= 0)
+		{
+			points[0] = points[1];
+			simplex->points_count = 1;
+			return w2;
+		}
+		return (w1 * d12_1 + w2 * d12_2) * (1.0f / (d12_1 + d12_2));
+	}
+
+	vec2f w3 = points[2].point;
+	vec2f e13 = w3 - w1;
+	float d13_1 = dot(w3, e13);
+	float d13_2 = -dot(w1, e13);
+	vec2f e23 = w3 - w2;
+	float d23_1 = dot(w3, e23);
+	float d23_2 = -dot(w2, e23);
+
+	float n123 = cross(e12, e13);
+	float d123_1 = n123 * cross(w2, w3);
+	float d123_2 = n123 * cross(w3, w1);
+	float d123_3 = n123 * cross(w1, w2);
+
+	// vertices
+	if(d12_2 <= 0 && d13_2 <= 0)
+	{
+		simplex->points_count = 1;
+		return w1;
+	}
+	if(d12_1 <= 0 && d23_2 <= 0)
+	{
+		points[0] = points[1];
+		simplex->points_count = 1;
+		return w2;
+	}
+	if(d13_1 <= 0 && d23_1 <= 0)
+	{
+		points[0] = points[2];
+		simplex->points_count = 1;
+		return w3;
+	}
+
+	// edges
+	if(d12_1 > 0 && d12_2 > 0 && d123_3 <= 0)
+	{
+		simplex->points_count = 2;
+		return (w1 * d12_1 + w2 * d12_2) * (1.0f / (d12_1 + d12_2));
+	}
+	if(d13_1 > 0 && d13_2 > 0 && d123_2 <= 0)
+	{
+		points[1] = points[2];
+		simplex->points_count = 2;
+		return (w1 * d13_1 + w3 * d13_2) * (1.0f / (d13_1 + d13_2));
+	}
+	if(d23_1 > 0 && d23_2 > 0 && d123_1 <= 0)
+	{
+		points[0] = points[2];
+		simplex->points_count = 2;
+		return (w3 * d23_2 + w2 * d23_1) * (1.0f / (d23_1 + d23_2));
+	}
+
+	// origin inside the triangle
+	return VEC2F_ZERO;
+}
+
+bool itu_lib_overlaps_gjk(ITU_OverlapsShape* shape_0, ITU_OverlapsShape* shape_1, ITU_OverlapsSimplex* simplex)
+{
+	SDL_assert(shape_0);
+	SDL_assert(shape_1);
+
+	// distance-based GJK: every iteration moves towards the point of the Minkowski difference closest to the origin,
+	// the shapes overlap if the Minkowski difference contains the origin
+	// NOTE: the result is stored in `simplex` for the next frame, so we use a local one if the caller doesn't care
+	ITU_OverlapsSimplex simplex_local;
+	if(!simplex)
+	{
+		simplex = &simplex_local;
+		simplex->points_count = 0;
+	}
+	SDL_assert(simplex->points_count >= 0 && simplex->points_count <= 3);
+
+	// warm start: same search directions as last time, on the shapes as they are now
+	if(simplex->points_count > 0)
+	{
+		for(int i = 0; i < simplex->points_count; ++i)
+			simplex->points[i] = itu_lib_overlaps_support_minkowski(shape_0, shape_1, simplex->points[i].direction);
+	}
+	else
+	{
+		simplex->points[0] = itu_lib_overlaps_support_minkowski(shape_0, shape_1, VEC2F_UP);
+		simplex->points_count = 1;
+	}
+
+	for(simplex->iterations = 1; simplex->iterations <= ITU_OVERLAPS_GJK_ITERATIONS_MAX; ++simplex->iterations)
+	{
+		vec2f closest = itu_lib_overlaps_simplex_solve(simplex);
+		if(simplex->points_count == 3)
+			return true;
+
+		// origin (almost) on the simplex: shapes are at least touching
+		float scale_sq = 0;
+		for(int i = 0; i < simplex->points_count; ++i)
+			scale_sq = SDL_max(scale_sq, length_sq(simplex->points[i].point));
+		if(length_sq(closest) <= scale_sq * 1e-10f)
+		{
+			// the origin is on a vertex of the Minkowski difference, so on its boundary
+			if(simplex->points_count == 1)
+				return false;
+
+			// the origin is on an edge of the simplex: it's inside only if the Minkowski difference extends on both sides
+			vec2f edge = simplex->points[1].point - simplex->points[0].point;
+			vec2f side = vec2f{ -edge.y, edge.x };
+			ITU_OverlapsSimplexPoint support_left  = itu_lib_overlaps_support_minkowski(shape_0, shape_1, side);
+			ITU_OverlapsSimplexPoint support_right = itu_lib_overlaps_support_minkowski(shape_0, shape_1, -side);
+			float epsilon = SDL_sqrtf(scale_sq) * length(side) * 1e-5f;
+			if(dot(support_left.point, side) <= epsilon || -dot(support_right.point, side) <= epsilon)
 				return false;
+
+			simplex->points[2] = support_left;
+			simplex->points_count = 3;
+			return true;
+		}
+
+		vec2f direction = -closest;
+		ITU_OverlapsSimplexPoint support = itu_lib_overlaps_support_minkowski(shape_0, shape_1, direction);
+
+		// nothing goes past the origin in the direction we are looking: there's a separating axis
+		// NOTE: touching shapes end up here too (strict test)
+		if(dot(support.point, direction) <= 0)
+			return false;
+
+		simplex->points[simplex->points_count++] = support;
+	}
+
+	// should only happen with curved shapes that are almost touching
+	return false;
+}
+
+bool itu_lib_overlaps_gjk_manifold(ITU_OverlapsShape* shape_0, ITU_OverlapsShape* shape_1, ITU_OverlapsSimplex* simplex, ITU_OverlapsManifold* out_manifold)
+{
+	SDL_assert(out_manifold);
+
+	ITU_OverlapsSimplex simplex_local;
+	if(!simplex)
+	{
+		simplex = &simplex_local;
+		simplex->points_count = 0;
+	}
+	if(!itu_lib_overlaps_gjk(shape_0, shape_1, simplex))
+		return false;
+
+	// EPA: grows the final GJK triangle into the Minkowski difference, one point at a time, until the edge closest
+	// to the origin is on its boundary. That edge gives normal and penetration depth
+	ITU_OverlapsSimplexPoint polytope[ITU_OVERLAPS_EPA_POINTS_MAX];
+	int polytope_count = 3;
+	polytope[0] = simplex->points[0];
+	// counter-clockwise, so that edge normals point outwards
+	if(cross(simplex->points[1].point - simplex->points[0].point, simplex->points[2].point - simplex->points[0].point) > 0)
+	{
+		polytope[1] = simplex->points[1];
+		polytope[2] = simplex->points[2];
+	}
+	else
+	{
+		polytope[1] = simplex->points[2];
+		polytope[2] = simplex->points[1];
+	}
+
+	int edge = -1;
+	vec2f normal = VEC2F_ZERO;
+	float distance = 0;
+	for(;;)
+	{
+		edge = -1;
+		for(int i = 0; i < polytope_count; ++i)
+		{
+			vec2f e = polytope[(i + 1) % polytope_count].point - polytope[i].point;
+			float e_length = length(e);
+			if(e_length == 0)
+				continue;
+			vec2f n = vec2f{ e.y, -e.x } * (1.0f / e_length);
+			float d = dot(n, polytope[i].point);
+			if(edge < 0 || d < distance)
+			{
+				edge = i;
+				normal = n;
+				distance = d;
 			}
 		}
+		if(edge < 0)
+			return false; // degenerate (ie, zero-area shapes)
+
+		ITU_OverlapsSimplexPoint support = itu_lib_overlaps_support_minkowski(shape_0, shape_1, normal);
+		if(dot(support.point, normal) - distance < ITU_OVERLAPS_EPA_TOLERANCE || polytope_count == ITU_OVERLAPS_EPA_POINTS_MAX)
+			break;
+
+		// insert between the two vertices of the edge
+		for(int i = polytope_count; i > edge + 1; --i)
+			polytope[i] = polytope[i - 1];
+		polytope[edge + 1] = support;
+		++polytope_count;
+	}
+
+	if(distance <= 0)
+		return false;
+
+	// contact point: closest point to the origin on the edge, mapped back on both shapes
+	ITU_OverlapsSimplexPoint* a = &polytope[edge];
+	ITU_OverlapsSimplexPoint* b = &polytope[(edge + 1) % polytope_count];
+	vec2f ab = b->point - a->point;
+	float t = SDL_clamp(-dot(a->point, ab) / length_sq(ab), 0.0f, 1.0f);
+	vec2f contact_0 = lerp(a->point_0, b->point_0, t);
+	vec2f contact_1 = lerp(a->point_1, b->point_1, t);
+
+	out_manifold->normal = normal;
+	out_manifold->depth = distance;
+	out_manifold->points[0] = (contact_0 + contact_1) * 0.5f;
+	out_manifold->points_count = 1;
+	return true;
+}
+
+// NOTE: assumes polygons are convex
+bool itu_lib_overlaps_polygon_polygon(vec2f* polygon_0_vertices, int poligon_0_vertices_count, vec2f* polygon_1_vertices, int poligon_1_vertices_count, ITU_OverlapsSimplex* simplex)
+{
+	ITU_OverlapsShape shape_0 = itu_lib_overlaps_shape_polygon(polygon_0_vertices, poligon_0_vertices_count);
+	ITU_OverlapsShape shape_1 = itu_lib_overlaps_shape_polygon(polygon_1_vertices, poligon_1_vertices_count);
+	return itu_lib_overlaps_gjk(&shape_0, &shape_1, simplex);
+}
+
+// ********************************************************************************************************************
+// batch tests
+// ********************************************************************************************************************
+
+// every batch test is split in blocks of (up to) 64 shapes, one for each bit of a mask. The block functions are the only
+// thing that changes between instruction sets
+typedef Uint64 (*ITU_OverlapsCircleBlockFn)(vec2f circle_center, float circle_radius, const float* centers_x, const float* centers_y, const float* radii, int count);
+typedef Uint64 (*ITU_OverlapsRectBlockFn)(vec2f rect_min, vec2f rect_max, const float* rects_min_x, const float* rects_min_y, const float* rects_max_x, const float* rects_max_y, int count);
+
+struct ITU_OverlapsContext
+{
+	bool simd_initialized;
+	ITU_OverlapsSimd simd;
+};
+
+static ITU_OverlapsContext ctx_overlaps;
+
+static Uint64 itu_lib_overlaps_circle_block_scalar(vec2f circle_center, float circle_radius, const float* centers_x, const float* centers_y, const float* radii, int count)
+{
+	Uint64 ret = 0;
+	for(int i = 0; i < count; ++i)
+		ret |= (Uint64)itu_lib_overlaps_circle_circle(circle_center, circle_radius, vec2f{ centers_x[i], centers_y[i] }, radii[i]) << i;
+	return ret;
+}
+
+static Uint64 itu_lib_overlaps_rect_block_scalar(vec2f rect_min, vec2f rect_max, const float* rects_min_x, const float* rects_min_y, const float* rects_max_x, const float* rects_max_y, int count)
+{
+	Uint64 ret = 0;
+	for(int i = 0; i < count; ++i)
+		ret |= (Uint64)itu_lib_overlaps_rect_rect(rect_min, rect_max, vec2f{ rects_min_x[i], rects_min_y[i] }, vec2f{ rects_max_x[i], rects_max_y[i] }) << i;
+	return ret;
+}
+
+// NOTE: SIMD blocks do 4 (SSE2) or 8 (AVX2) shapes at a time, and leave what doesn't fit to the scalar version.
+//       Comparisons are the same as the single-pair tests (strict, no epsilon), so results don't change with the instruction set
+#ifdef SDL_SSE2_INTRINSICS
+static Uint64 itu_lib_overlaps_circle_block_sse2(vec2f circle_center, float circle_radius, const float* centers_x, const float* centers_y, const float* radii, int count)
+{
+	__m128 center_x = _mm_set1_ps(circle_center.x);
+	__m128 center_y = _mm_set1_ps(circle_center.y);
+	__m128 radius   = _mm_set1_ps(circle_radius);
+
+	Uint64 ret = 0;
+	int i = 0;
+	for(; i + 4 <= count; i += 4)
+	{
+		__m128 d_x = _mm_sub_ps(_mm_loadu_ps(centers_x + i), center_x);
+		__m128 d_y = _mm_sub_ps(_mm_loadu_ps(centers_y + i), center_y);
+		__m128 d_sq = _mm_add_ps(_mm_mul_ps(d_x, d_x), _mm_mul_ps(d_y, d_y));
+		__m128 r_sum = _mm_add_ps(_mm_loadu_ps(radii + i), radius);
+		ret |= (Uint64)_mm_movemask_ps(_mm_cmplt_ps(d_sq, _mm_mul_ps(r_sum, r_sum))) << i;
 	}
+	if(i < count)
+		ret |= itu_lib_overlaps_circle_block_scalar(circle_center, circle_radius, centers_x + i, centers_y + i, radii + i, count - i) << i;
+	return ret;
+}
+
+static Uint64 itu_lib_overlaps_rect_block_sse2(vec2f rect_min, vec2f rect_max, const float* rects_min_x, const float* rects_min_y, const float* rects_max_x, const float* rects_max_y, int count)
+{
+	__m128 min_x = _mm_set1_ps(rect_min.x);
+	__m128 min_y = _mm_set1_ps(rect_min.y);
+	__m128 max_x = _mm_set1_ps(rect_max.x);
+	__m128 max_y = _mm_set1_ps(rect_max.y);
+
+	Uint64 ret = 0;
+	int i = 0;
+	for(; i + 4 <= count; i += 4)
+	{
+		__m128 overlap_x = _mm_and_ps(_mm_cmplt_ps(min_x, _mm_loadu_ps(rects_max_x + i)), _mm_cmpgt_ps(max_x, _mm_loadu_ps(rects_min_x + i)));
+		__m128 overlap_y = _mm_and_ps(_mm_cmplt_ps(min_y, _mm_loadu_ps(rects_max_y + i)), _mm_cmpgt_ps(max_y, _mm_loadu_ps(rects_min_y + i)));
+		ret |= (Uint64)_mm_movemask_ps(_mm_and_ps(overlap_x, overlap_y)) << i;
+	}
+	if(i < count)
+		ret |= itu_lib_overlaps_rect_block_scalar(rect_min, rect_max, rects_min_x + i, rects_min_y + i, rects_max_x + i, rects_max_y + i, count - i) << i;
+	return ret;
+}
+#endif // SDL_SSE2_INTRINSICS
+
+#ifdef SDL_AVX2_INTRINSICS
+SDL_TARGETING("avx2") static Uint64 itu_lib_overlaps_circle_block_avx2(vec2f circle_center, float circle_radius, const float* centers_x, const float* centers_y, const float* radii, int count)
+{
+	__m256 center_x = _mm256_set1_ps(circle_center.x);
+	__m256 center_y = _mm256_set1_ps(circle_center.y);
+	__m256 radius   = _mm256_set1_ps(circle_radius);
+
+	Uint64 ret = 0;
+	int i = 0;
+	for(; i + 8 <= count; i += 8)
+	{
+		__m256 d_x = _mm256_sub_ps(_mm256_loadu_ps(centers_x + i), center_x);
+		__m256 d_y = _mm256_sub_ps(_mm256_loadu_ps(centers_y + i), center_y);
+		__m256 d_sq = _mm256_add_ps(_mm256_mul_ps(d_x, d_x), _mm256_mul_ps(d_y, d_y));
+		__m256 r_sum = _mm256_add_ps(_mm256_loadu_ps(radii + i), radius);
+		ret |= (Uint64)_mm256_movemask_ps(_mm256_cmp_ps(d_sq, _mm256_mul_ps(r_sum, r_sum), _CMP_LT_OQ)) << i;
+	}
+	if(i < count)
+		ret |= itu_lib_overlaps_circle_block_scalar(circle_center, circle_radius, centers_x + i, centers_y + i, radii + i, count - i) << i;
+	return ret;
+}
+
+SDL_TARGETING("avx2") static Uint64 itu_lib_overlaps_rect_block_avx2(vec2f rect_min, vec2f rect_max, const float* rects_min_x, const float* rects_min_y, const float* rects_max_x, const float* rects_max_y, int count)
+{
+	__m256 min_x = _mm256_set1_ps(rect_min.x);
+	__m256 min_y = _mm256_set1_ps(rect_min.y);
+	__m256 max_x = _mm256_set1_ps(rect_max.x);
+	__m256 max_y = _mm256_set1_ps(rect_max.y);
+
+	Uint64 ret = 0;
+	int i = 0;
+	for(; i + 8 <= count; i += 8)
+	{
+		__m256 overlap_x = _mm256_and_ps(_mm256_cmp_ps(min_x, _mm256_loadu_ps(rects_max_x + i), _CMP_LT_OQ), _mm256_cmp_ps(max_x, _mm256_loadu_ps(rects_min_x + i), _CMP_GT_OQ));
+		__m256 overlap_y = _mm256_and_ps(_mm256_cmp_ps(min_y, _mm256_loadu_ps(rects_max_y + i), _CMP_LT_OQ), _mm256_cmp_ps(max_y, _mm256_loadu_ps(rects_min_y + i), _CMP_GT_OQ));
+		ret |= (Uint64)_mm256_movemask_ps(_mm256_and_ps(overlap_x, overlap_y)) << i;
+	}
+	if(i < count)
+		ret |= itu_lib_overlaps_rect_block_scalar(rect_min, rect_max, rects_min_x + i, rects_min_y + i, rects_max_x + i, rects_max_y + i, count - i) << i;
+	return ret;
+}
+#endif // SDL_AVX2_INTRINSICS
+
+void itu_lib_overlaps_simd_set(ITU_OverlapsSimd simd)
+{
+	ITU_OverlapsSimd supported = ITU_OVERLAPS_SIMD_NONE;
+#ifdef SDL_SSE2_INTRINSICS
+	if(SDL_HasSSE2())
+		supported = ITU_OVERLAPS_SIMD_SSE2;
+#endif
+#ifdef SDL_AVX2_INTRINSICS
+	if(SDL_HasAVX2())
+		supported = ITU_OVERLAPS_SIMD_AVX2;
+#endif
+
+	ctx_overlaps.simd = simd < supported ? simd : supported;
+	ctx_overlaps.simd_initialized = true;
+}
+
+ITU_OverlapsSimd itu_lib_overlaps_simd_get()
+{
+	if(!ctx_overlaps.simd_initialized)
+		itu_lib_overlaps_simd_set(ITU_OVERLAPS_SIMD_AVX2);
+	return ctx_overlaps.simd;
+}
+
+static ITU_OverlapsCircleBlockFn itu_lib_overlaps_circle_block_get()
+{
+	switch(itu_lib_overlaps_simd_get())
+	{
+#ifdef SDL_AVX2_INTRINSICS
+		case ITU_OVERLAPS_SIMD_AVX2: return itu_lib_overlaps_circle_block_avx2;
+#endif
+#ifdef SDL_SSE2_INTRINSICS
+		case ITU_OVERLAPS_SIMD_SSE2: return itu_lib_overlaps_circle_block_sse2;
+#endif
+		default: return itu_lib_overlaps_circle_block_scalar;
+	}
+}
+
+static ITU_OverlapsRectBlockFn itu_lib_overlaps_rect_block_get()
+{
+	switch(itu_lib_overlaps_simd_get())
+	{
+#ifdef SDL_AVX2_INTRINSICS
+		case ITU_OVERLAPS_SIMD_AVX2: return itu_lib_overlaps_rect_block_avx2;
+#endif
+#ifdef SDL_SSE2_INTRINSICS
+		case ITU_OVERLAPS_SIMD_SSE2: return itu_lib_overlaps_rect_block_sse2;
+#endif
+		default: return itu_lib_overlaps_rect_block_scalar;
+	}
+}
+
+static int itu_lib_overlaps_mask_count(Uint64 mask)
+{
+	int ret = 0;
+	for(; mask; mask &= mask - 1)
+		++ret;
+	return ret;
+}
+
+// appends a pair for every bit set in `mask`, where bit `i` is shape `index_b_first + i`
+static int itu_lib_overlaps_mask_to_pairs(Uint64 mask, int index_a, int index_b_first, ITU_OverlapsPair* out_pairs, int pairs_max, int pairs_count)
+{
+	for(; mask; mask &= mask - 1)
+	{
+		if(pairs_count < pairs_max)
+		{
+			out_pairs[pairs_count].index_a = index_a;
+			out_pairs[pairs_count].index_b = index_b_first + bit_index_lowest(mask);
+		}
+		++pairs_count;
+	}
+	return pairs_count;
+}
+
+int itu_lib_overlaps_circle_circles(vec2f circle_center, float circle_radius, const float* centers_x, const float* centers_y, const float* radii, int count, Uint64* out_mask)
+{
+	ITU_OverlapsCircleBlockFn block = itu_lib_overlaps_circle_block_get();
+
+	int ret = 0;
+	for(int i = 0; i < count; i += 64)
+	{
+		Uint64 mask = block(circle_center, circle_radius, centers_x + i, centers_y + i, radii + i, SDL_min(64, count - i));
+		out_mask[i / 64] = mask;
+		ret += itu_lib_overlaps_mask_count(mask);
+	}
+	return ret;
+}
+
+int itu_lib_overlaps_rect_rects(vec2f rect_min, vec2f rect_max, const float* rects_min_x, const float* rects_min_y, const float* rects_max_x, const float* rects_max_y, int count, Uint64* out_mask)
+{
+	ITU_OverlapsRectBlockFn block = itu_lib_overlaps_rect_block_get();
+
+	int ret = 0;
+	for(int i = 0; i < count; i += 64)
+	{
+		Uint64 mask = block(rect_min, rect_max, rects_min_x + i, rects_min_y + i, rects_max_x + i, rects_max_y + i, SDL_min(64, count - i));
+		out_mask[i / 64] = mask;
+		ret += itu_lib_overlaps_mask_count(mask);
+	}
+	return ret;
+}
+
+int itu_lib_overlaps_circles_circles(const float* centers_x, const float* centers_y, const float* radii, int count, ITU_OverlapsPair* out_pairs, int pairs_max)
+{
+	ITU_OverlapsCircleBlockFn block = itu_lib_overlaps_circle_block_get();
+
+	int ret = 0;
+	for(int i = 0; i < count - 1; ++i)
+	{
+		vec2f center = vec2f{ centers_x[i], centers_y[i] };
+		for(int j = i + 1; j < count; j += 64)
+		{
+			Uint64 mask = block(center, radii[i], centers_x + j, centers_y + j, radii + j, SDL_min(64, count - j));
+			ret = itu_lib_overlaps_mask_to_pairs(mask, i, j, out_pairs, pairs_max, ret);
+		}
+	}
+	return ret;
+}
+
+int itu_lib_overlaps_rects_rects(const float* rects_min_x, const float* rects_min_y, const float* rects_max_x, const float* rects_max_y, int count, ITU_OverlapsPair* out_pairs, int pairs_max)
+{
+	ITU_OverlapsRectBlockFn block = itu_lib_overlaps_rect_block_get();
+
+	int ret = 0;
+	for(int i = 0; i < count - 1; ++i)
+	{
+		vec2f rect_min = vec2f{ rects_min_x[i], rects_min_y[i] };
+		vec2f rect_max = vec2f{ rects_max_x[i], rects_max_y[i] };
+		for(int j = i + 1; j < count; j += 64)
+		{
+			Uint64 mask = block(rect_min, rect_max, rects_min_x + j, rects_min_y + j, rects_max_x + j, rects_max_y + j, SDL_min(64, count - j));
+			ret = itu_lib_overlaps_mask_to_pairs(mask, i, j, out_pairs, pairs_max, ret);
+		}
+	}
+	return ret;
+}
+
+int itu_lib_overlaps_mask_to_indices(const Uint64* mask, int count, int* out_indices)
+{
+	int ret = 0;
+	for(int i = 0; i < (count + 63) / 64; ++i)
+		for(Uint64 bits = mask[i]; bits; bits &= bits - 1)
+			out_indices[ret++] = i * 64 + bit_index_lowest(bits);
 	return ret;
 }
 
@@ -3,10 +3,6 @@
 // limitations
 // - no rotation
 // - only polygons have color fill
-// 
-// TODO
-// - get rid of VLAs
-// - get rid of BUFFER_SIZE
 
 #ifndef ITU_LIB_RENDER_HPP
 #define ITU_LIB_RENDER_HPP
@@ -105,13 +101,14 @@ void itu_lib_render_draw_circle(SDL_Renderer* renderer, vec2f center, float radi
 
 void itu_lib_render_draw_polygon(SDL_Renderer* renderer, vec2f position, const vec2f* vertices, int vertexCount, color color)
 {
-#define BUFFER_SIZE 128 + 1
 	SDL_FColor color_fill = { color.r, color.g, color.b, color.a };
+	int indices_count = SDL_max(vertexCount - 2, 0) * 3;
+
+	ITU_ArenaTemp scratch = itu_lib_arena_scratch_begin(NULL);
+	SDL_FPoint* vs_outline = arena_push_array(scratch.arena, SDL_FPoint, vertexCount + 1);
+	SDL_Vertex* vs         = arena_push_array(scratch.arena, SDL_Vertex, vertexCount);
+	int*        indices    = arena_push_array(scratch.arena, int, indices_count);
 
-	SDL_FPoint vs_outline[BUFFER_SIZE];
-	SDL_Vertex vs[BUFFER_SIZE];
-	SDL_zeroa(vs);
-	
 	for (int i = 0; i < vertexCount; ++i)
 	{
 		vec2f pos = position + vertices[i];
@@ -127,8 +124,6 @@ void itu_lib_render_draw_polygon(SDL_Renderer* renderer, vec2f position, const v
 	vs_outline[vertexCount].x = vs_outline[0].x;
 	vs_outline[vertexCount].y = vs_outline[0].y;
 
-	int indices_count = (vertexCount - 2)*3;
-	int indices[BUFFER_SIZE];
 	int c = 0;
 	for (int i = 2; i < vertexCount; ++i)
 	{
@@ -141,6 +136,8 @@ void itu_lib_render_draw_polygon(SDL_Renderer* renderer, vec2f position, const v
 	
 	SDL_SetRenderDrawColorFloat(renderer, color.r, color.g, color.b, 1.0f);
 	SDL_RenderLines(renderer, vs_outline, vertexCount + 1);
+
+	itu_lib_arena_scratch_end(scratch);
 }
 
 void itu_lib_render_draw_world_point(SDLContext* context, vec2f pos, float half_size, color color)
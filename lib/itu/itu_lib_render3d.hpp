@@ -2,7 +2,6 @@
 #define ITU_SYS_RENDER_3D_HPP
 
 #define FRAME_DRAWCALL_COUNT_MAX 1024
-#define FRAME_INSTANCE_DATA_COUNT_MAX 2048
 
 struct VertexData
 {
@@ -85,9 +84,7 @@ struct DrawCall
 {
 	Model3D* data_mesh;
 	int data_instances_count;
-	// TMP store instance data directly here
-	// FIXME dump this into a scratch arena
-	int data_instances_first_index;
+	InstanceData* data_instances; // in the frame arena
 };
 
 // enough space for 32768 verties (pos, normal, uvs)
@@ -176,9 +173,7 @@ struct ITU_SysRender3DCtx
 	DrawCall* drawcalls;
 	int drawcalls_count_alive;
 	int drawcalls_count_max;
-	InstanceData* instance_data;
 	int instance_data_count_alive;
-	int instance_data_count_max;
 };
 
 static ITU_SysRender3DCtx ctx_rendering;
@@ -275,9 +270,6 @@ void itu_sys_render3d_init(SDLContext* context)
 	ctx_rendering.drawcalls = (DrawCall*) SDL_calloc(FRAME_DRAWCALL_COUNT_MAX, sizeof(DrawCall));
 	ctx_rendering.drawcalls_count_max = FRAME_DRAWCALL_COUNT_MAX;
 
-	ctx_rendering.instance_data = (InstanceData*) SDL_calloc(FRAME_INSTANCE_DATA_COUNT_MAX, sizeof(InstanceData));
-	ctx_rendering.instance_data_count_max = FRAME_INSTANCE_DATA_COUNT_MAX;
-
 	// upload texture data
 	{
 		ctx_rendering.command_buffer_upload = SDL_AcquireGPUCommandBuffer(ctx_rendering.device);
@@ -504,18 +496,7 @@ void itu_sys_render3d_model3d_render(SDLContext* context, Model3D* data, Instanc
 		return;
 	}
 
-	if(ctx_rendering.instance_data_count_alive >= FRAME_DRAWCALL_COUNT_MAX)
-	{
-		SDL_Log("WARNING too instances to render for this frame!");
-		return;
-	}
-
-	int idx = ctx_rendering.drawcalls_count_alive++;
-	int instance_first_idx = ctx_rendering.instance_data_count_alive++;
-	ctx_rendering.drawcalls[idx].data_mesh = data;
-	ctx_rendering.drawcalls[idx].data_instances_count = 1;
-	ctx_rendering.drawcalls[idx].data_instances_first_index = instance_first_idx;
-	ctx_rendering.instance_data[instance_first_idx] = instance;
+	itu_sys_render3d_model3d_render_instanced(context, data, &instance, 1);
 }
 
 void itu_sys_render3d_model3d_render_instanced(SDLContext* context, Model3D* data, InstanceData* instances, int instances_count)
@@ -532,20 +513,22 @@ void itu_sys_render3d_model3d_render_instanced(SDLContext* context, Model3D* dat
 		return;
 	}
 
-	if(ctx_rendering.instance_data_count_alive + instances_count >= FRAME_DRAWCALL_COUNT_MAX)
+	// instance data has to fit in the GPU buffer it will be uploaded to
+	if((ctx_rendering.instance_data_count_alive + instances_count) * sizeof(InstanceData) >= INSTANCE_DATA_SIZE_MAX)
 	{
-		SDL_Log("WARNING too instances to render for this frame!");
+		SDL_Log("WARNING too many instances to render for this frame!");
 		return;
 	}
 
+	// callers are free to reuse `instances` right away, so we keep a copy until `itu_sys_render3d_frame_end`
+	InstanceData* instances_copy = arena_push_array(itu_lib_arena_frame(), InstanceData, instances_count);
+	SDL_memcpy(instances_copy, instances, instances_count * sizeof(InstanceData));
+
 	int idx = ctx_rendering.drawcalls_count_alive++;
-	int instance_first_idx = ctx_rendering.instance_data_count_alive;
 	ctx_rendering.instance_data_count_alive += instances_count;
 	ctx_rendering.drawcalls[idx].data_mesh = data;
 	ctx_rendering.drawcalls[idx].data_instances_count = instances_count;
-	ctx_rendering.drawcalls[idx].data_instances_first_index = instance_first_idx;
-	SDL_memcpy(ctx_rendering.instance_data + instance_first_idx, instances, instances_count * sizeof(InstanceData));
-
+	ctx_rendering.drawcalls[idx].data_instances = instances_copy;
 }
 
 void itu_sys_render3d_frame_end(SDLContext* context)
@@ -604,8 +587,7 @@ void itu_sys_render3d_frame_end(SDLContext* context)
 
 				offset_instance = ptr_data_instance - ctx_rendering.base_mapping_data_instances;
 		
-				InstanceData* src_instance_data = &ctx_rendering.instance_data[drawcall->data_instances_first_index];
-				SDL_memcpy(ptr_data_instance, src_instance_data, size_instance);
+				SDL_memcpy(ptr_data_instance, drawcall->data_instances, size_instance);
 
 				SDL_GPUTransferBufferLocation transfer_buffer_location = { };
 				transfer_buffer_location.offset = offset_instance;
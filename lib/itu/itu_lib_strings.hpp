@@ -0,0 +1,137 @@
+// itu_lib_strings.hpp
+// interned storage for long-lived strings (debug names, asset paths, ...)
+//
+// strings are copied in big blocks instead of being allocated one by one, and every distinct string is only stored
+// once: interning "asteroid" a thousand times costs a single copy and returns the same pointer every time.
+//
+// important notes:
+// - interned strings are immutable, and stay valid until `itu_lib_strings_clear` (nothing is ever freed one by one)
+// - since equal strings share the same pointer, interned strings can be compared with `==`
+// - not thread safe
+
+#ifndef ITU_LIB_STRINGS_HPP
+#define ITU_LIB_STRINGS_HPP
+
+#ifndef ITU_UNITY_BUILD
+#include <SDL3/SDL.h>
+#include <itu_common.hpp>
+#include <stb_ds.h>
+#endif
+
+// strings longer than this get a block of their own
+#define ITU_STRINGS_BLOCK_SIZE KB(64)
+
+const char* itu_lib_strings_intern(const char* str);
+const char* itu_lib_strings_intern_len(const char* str, int len);
+void        itu_lib_strings_clear();
+Uint64      itu_lib_strings_bytes_used();
+
+#endif // ITU_LIB_STRINGS_HPP
+
+#if (defined ITU_LIB_STRINGS_IMPLEMENTATION) || (defined ITU_UNITY_BUILD)
+
+struct ITU_StringsContext
+{
+	stbds_arr(char*) blocks; // every allocation, only used to free them
+	char*  block_curr;       // block we are currently filling
+	Uint64 block_used;       // bytes used in `block_curr`
+	Uint64 bytes_used;       // total, across all blocks
+
+	// NOTE: keys point inside `blocks`, the map never copies them
+	stbds_sm(const char*, int) lookup;
+};
+
+static ITU_StringsContext ctx_strings;
+
+static char* itu_lib_strings_alloc(Uint64 size)
+{
+	if(size > ITU_STRINGS_BLOCK_SIZE)
+	{
+		char* block = (char*)SDL_malloc(size);
+		stbds_arrput(ctx_strings.blocks, block);
+		return block;
+	}
+
+	if(!ctx_strings.block_curr || ctx_strings.block_used + size > ITU_STRINGS_BLOCK_SIZE)
+	{
+		ctx_strings.block_curr = (char*)SDL_malloc(ITU_STRINGS_BLOCK_SIZE);
+		ctx_strings.block_used = 0;
+		stbds_arrput(ctx_strings.blocks, ctx_strings.block_curr);
+	}
+
+	char* ret = ctx_strings.block_curr + ctx_strings.block_used;
+	ctx_strings.block_used += size;
+	return ret;
+}
+
+static const char* itu_lib_strings_intern_internal(const char* str, int len, bool null_terminated)
+{
+	// stb_ds string maps need a null-terminated key. Short strings are terminated on the stack, long ones
+	// are copied right away (if it turns out to be a duplicate we just waste that space)
+	char buffer[256];
+	const char* key = str;
+	char* copy = NULL;
+	if(!null_terminated)
+	{
+		if(len < (int)sizeof(buffer))
+		{
+			SDL_memcpy(buffer, str, len);
+			buffer[len] = 0;
+			key = buffer;
+		}
+		else
+		{
+			copy = itu_lib_strings_alloc(len + 1);
+			SDL_memcpy(copy, str, len);
+			copy[len] = 0;
+			key = copy;
+		}
+	}
+
+	int loc = stbds_shgeti(ctx_strings.lookup, key);
+	if(loc != -1)
+		return ctx_strings.lookup[loc].key;
+
+	if(!copy)
+	{
+		copy = itu_lib_strings_alloc(len + 1);
+		SDL_memcpy(copy, str, len);
+		copy[len] = 0;
+	}
+	ctx_strings.bytes_used += len + 1;
+
+	stbds_shput(ctx_strings.lookup, copy, len);
+	return copy;
+}
+
+const char* itu_lib_strings_intern_len(const char* str, int len)
+{
+	if(!str)
+		return NULL;
+
+	return itu_lib_strings_intern_internal(str, len, false);
+}
+
+const char* itu_lib_strings_intern(const char* str)
+{
+	if(!str)
+		return NULL;
+
+	return itu_lib_strings_intern_internal(str, SDL_strlen(str), true);
+}
+
+void itu_lib_strings_clear()
+{
+	for(int i = 0; i < stbds_arrlen(ctx_strings.blocks); ++i)
+		SDL_free(ctx_strings.blocks[i]);
+	stbds_arrfree(ctx_strings.blocks);
+	stbds_shfree(ctx_strings.lookup);
+	SDL_memset(&ctx_strings, 0, sizeof(ctx_strings));
+}
+
+Uint64 itu_lib_strings_bytes_used()
+{
+	return ctx_strings.bytes_used;
+}
+
+#endif // (defined ITU_LIB_STRINGS_IMPLEMENTATION) || (defined ITU_UNITY_BUILD)
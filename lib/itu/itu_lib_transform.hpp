@@ -1,21 +1,28 @@
 #ifndef ITU_LIB_TRANSFORM_HPP
 #define ITU_LIB_TRANSFORM_HPP
 
-#define TRANSFORM_HIERARCHY_MAX_DEPTH 16
-
 #ifndef ITU_UNITY_BUILD
 #include <itu_entity_storage.hpp>
 #include <glm/glm.hpp>
 #endif
 
+#define TRANSFORM3D_INDEX_NULL ((Uint32)-1)
+
+// hierarchy links are stored as `ITU_EntityId.index` of the other node (TRANSFORM3D_INDEX_NULL for none).
+// Entity indices don't change when component data moves around (swap-remove, pool growth, sorting, archetype moves),
+// so links never need to be patched.
+// Every Transform3D is part of the hierarchy as soon as it's added (as a root, unless `transform3D_add` is given a parent)
 struct Transform3D
 {
-	int TMP_id;
-	Transform3D* parent;
-	Transform3D* child_first;
-	Transform3D* child_last;
-	Transform3D* sibling_prev;
-	Transform3D* sibling_next;
+	Uint32 parent;
+	Uint32 child_first;
+	Uint32 child_last;
+	Uint32 sibling_prev;
+	Uint32 sibling_next;
+
+	// written when the pool is re-sorted in depth-first order (see `itu_lib_transform_update_globals`)
+	Uint32 order;      // position in depth-first order, which is also the position in the pool after sorting
+	Uint32 parent_loc; // position of the parent in the pool after sorting
 
 	glm::mat4 local;
 	glm::mat4 global;
@@ -24,9 +31,8 @@ struct Transform3D
 Transform3D* transform3D_add(ITU_EntityId id, ITU_EntityId parent);
 void transform3D_reparent(ITU_EntityId id, ITU_EntityId new_parent);
 
-int compare_transform_breadth_first(const void *a, const void* b);
-int compare_transform_depth_first(const void *a, const void* b);
-
+// re-sorts the pool in depth-first order if the hierarchy changed, then computes all global transforms in a single linear
+// pass (parents always come before their children)
 void itu_lib_transform_update_globals();
 
 #endif // ITU_LIB_TRANSFORM_HPP
@@ -35,180 +41,258 @@ void itu_lib_transform_update_globals();
 #define ITU_LIB_TRANSFORM_IMPLEMENTATION
 #if (defined ITU_LIB_TRANSFORM_IMPLEMENTATION) || (defined ITU_UNITY_BUILD)
 
-static Transform3D TMP_transform_root = 
+struct ITU_TransformContext
 {
-	-1
+	// nodes without a parent
+	Uint32 root_first;
+	Uint32 root_last;
+
+	// set every time a link changes, the pool has to be re-sorted before the linear pass
+	bool order_dirty;
+	stbds_arr(Uint32) stack; // depth-first walk scratch
 };
 
-void transform_hierarchy_remove(Transform3D* ptr, Transform3D* parent_old);
-void transform_hierarchy_add(Transform3D* ptr, Transform3D* parent_old);
-bool transform_is_offspring_of(Transform3D* ptr, Transform3D* ptr_other);
-void transform_hierarchy_refresh_before_deletion(Transform3D* ptr_to_be_deleted);
+static ITU_TransformContext ctx_transform = { TRANSFORM3D_INDEX_NULL, TRANSFORM3D_INDEX_NULL };
+
+void transform_hierarchy_add(Uint32 index, Uint32 parent_index);
+void transform_hierarchy_remove(Uint32 index);
+void transform_hierarchy_detach(Uint32 index);
+void transform_hierarchy_link_new(Uint32 index);
+void transform_hierarchy_clear();
+void transform_hierarchy_roots_get(Uint32* out_root_first, Uint32* out_root_last);
+void transform_hierarchy_roots_set(Uint32 root_first, Uint32 root_last);
+bool transform_is_offspring_of(Uint32 index, Uint32 index_other);
 
-void transform_hierarchy_remove(Transform3D* ptr)
+Transform3D* transform_hierarchy_get(Uint32 index)
 {
-	if(!ptr->parent)
-		return;
-	Transform3D* parent = ptr->parent;
+	return (Transform3D*)itu_entity_data_get_unchecked(itu_entity_id_from_index(index), ITU_COMPONENT_TYPE_Transform3D);
+}
 
-	if(parent->child_first == ptr)
-	{
-		parent->child_first = ptr->sibling_next;
-		if(parent->child_first)
-			parent->child_first->sibling_prev = NULL;
-	}
-	else if(parent->child_last == ptr)
+// unlinks `index` from its parent (or from the root list), leaving its own children untouched
+void transform_hierarchy_remove(Uint32 index)
+{
+	Transform3D* node = transform_hierarchy_get(index);
+
+	Uint32* child_first = &ctx_transform.root_first;
+	Uint32* child_last  = &ctx_transform.root_last;
+	if(node->parent != TRANSFORM3D_INDEX_NULL)
 	{
-		parent->child_last = ptr->sibling_prev;
-		if(parent->child_last)
-			parent->child_last->sibling_next = NULL;
+		Transform3D* parent = transform_hierarchy_get(node->parent);
+		child_first = &parent->child_first;
+		child_last  = &parent->child_last;
 	}
+
+	if(node->sibling_prev != TRANSFORM3D_INDEX_NULL)
+		transform_hierarchy_get(node->sibling_prev)->sibling_next = node->sibling_next;
 	else
-	{
-		if(ptr->sibling_prev)
-			ptr->sibling_prev->sibling_next = ptr->sibling_next;
-		if(ptr->sibling_next)
-			ptr->sibling_next->sibling_prev = ptr->sibling_prev;
-	}
+		*child_first = node->sibling_next;
 
-	// clean up siblings
-	ptr->sibling_next = ptr->sibling_prev = NULL;
+	if(node->sibling_next != TRANSFORM3D_INDEX_NULL)
+		transform_hierarchy_get(node->sibling_next)->sibling_prev = node->sibling_prev;
+	else
+		*child_last = node->sibling_prev;
+
+	node->parent = node->sibling_prev = node->sibling_next = TRANSFORM3D_INDEX_NULL;
+	ctx_transform.order_dirty = true;
 }
 
-void transform_hierarchy_add(Transform3D* ptr, Transform3D* parent_new)
+// appends `index` to the children of `parent_index` (or to the root list)
+void transform_hierarchy_add(Uint32 index, Uint32 parent_index)
 {
-	if(!parent_new)
-		parent_new = &TMP_transform_root;
+	Transform3D* node = transform_hierarchy_get(index);
 
-	if(!parent_new->child_first)
+	Uint32* child_first = &ctx_transform.root_first;
+	Uint32* child_last  = &ctx_transform.root_last;
+	if(parent_index != TRANSFORM3D_INDEX_NULL)
 	{
-		// parent has no children
-		ptr->parent = parent_new;
-		ptr->sibling_next = ptr->sibling_prev = NULL;
-		parent_new->child_first = parent_new->child_last = ptr;
+		Transform3D* parent = transform_hierarchy_get(parent_index);
+		child_first = &parent->child_first;
+		child_last  = &parent->child_last;
 	}
+
+	node->parent = parent_index;
+	node->sibling_next = TRANSFORM3D_INDEX_NULL;
+	node->sibling_prev = *child_last;
+	if(*child_last != TRANSFORM3D_INDEX_NULL)
+		transform_hierarchy_get(*child_last)->sibling_next = index;
 	else
+		*child_first = index;
+	*child_last = index;
+
+	ctx_transform.order_dirty = true;
+}
+
+// called before a Transform3D is removed: unlinks it, and hands its children over to its parent
+// NOTE: children keep their local transform, so they will jump in world space
+void transform_hierarchy_detach(Uint32 index)
+{
+	Transform3D* node = transform_hierarchy_get(index);
+	Uint32 parent = node->parent;
+
+	Uint32 child = node->child_first;
+	while(child != TRANSFORM3D_INDEX_NULL)
 	{
-		// parent with siblings, append to the end
-		ptr->parent = parent_new;
-		ptr->sibling_next = NULL;
-		ptr->sibling_prev = parent_new->child_last;
-		parent_new->child_last->sibling_next = ptr;
-		parent_new->child_last = ptr;
+		Uint32 child_next = transform_hierarchy_get(child)->sibling_next;
+		transform_hierarchy_remove(child);
+		transform_hierarchy_add(child, parent);
+		child = child_next;
 	}
+
+	transform_hierarchy_remove(index);
+	node->child_first = node->child_last = TRANSFORM3D_INDEX_NULL;
+}
+
+// called by entity storage right after a Transform3D is added: starts with no children, as the last root
+void transform_hierarchy_link_new(Uint32 index)
+{
+	Transform3D* node = transform_hierarchy_get(index);
+	node->child_first = node->child_last = TRANSFORM3D_INDEX_NULL;
+	transform_hierarchy_add(index, TRANSFORM3D_INDEX_NULL);
+}
+
+void transform_hierarchy_clear()
+{
+	ctx_transform.root_first = ctx_transform.root_last = TRANSFORM3D_INDEX_NULL;
+	ctx_transform.order_dirty = true;
+}
+
+// all links live in the components, except for the root list (used by world snapshots, see `itu_sys_estorage_snapshot_save`)
+void transform_hierarchy_roots_get(Uint32* out_root_first, Uint32* out_root_last)
+{
+	*out_root_first = ctx_transform.root_first;
+	*out_root_last  = ctx_transform.root_last;
+}
+
+void transform_hierarchy_roots_set(Uint32 root_first, Uint32 root_last)
+{
+	ctx_transform.root_first = root_first;
+	ctx_transform.root_last  = root_last;
+	ctx_transform.order_dirty = true;
 }
 
 Transform3D* transform3D_add(ITU_EntityId id, ITU_EntityId parent)
 {
-	static int tmp_id = 0;
 	Transform3D empty = { 0 };
-	empty.TMP_id = tmp_id++;
 	empty.local = glm::mat4(1.0f);
+	empty.global = glm::mat4(1.0f);
 	entity_add_component(id, Transform3D, empty);
 
-	Transform3D* ptr = entity_get_data(id, Transform3D);
-	Transform3D* ptr_parent = entity_get_data(parent, Transform3D);
-
 	if(itu_entity_equals(id, parent))
 		// cannot add a transform to itself! fallback to no parent
 		parent = ITU_ENTITY_ID_NULL;
 
-	transform_hierarchy_add((Transform3D*)ptr, (Transform3D*)ptr_parent);
+	// entity storage already added it as a root
+	if(entity_get_data(parent, Transform3D))
+	{
+		transform_hierarchy_remove(id.index);
+		transform_hierarchy_add(id.index, parent.index);
+	}
 
-	return ptr;
+	return entity_get_data(id, Transform3D);
 }
 
 void transform3D_reparent(ITU_EntityId id, ITU_EntityId new_parent)
 {
-	
-	Transform3D* ptr = entity_get_data(id, Transform3D);
-	Transform3D* ptr_parent = entity_get_data(new_parent, Transform3D);
+	if(!entity_get_data(id, Transform3D))
+		return;
 
-	if(transform_is_offspring_of(ptr_parent, ptr))
+	Uint32 parent_index = entity_get_data(new_parent, Transform3D) ? new_parent.index : TRANSFORM3D_INDEX_NULL;
+	if(parent_index != TRANSFORM3D_INDEX_NULL && transform_is_offspring_of(parent_index, id.index))
 	{
 		SDL_Log("WARNING cannot reparent node to one of its offspring!");
 		return;
 	}
 
-	transform_hierarchy_remove(ptr);
-	transform_hierarchy_add(ptr, ptr_parent);
+	transform_hierarchy_remove(id.index);
+	transform_hierarchy_add(id.index, parent_index);
 }
 
-bool transform_is_offspring_of(Transform3D* ptr, Transform3D* ptr_other)
+// true if `index` is `index_other` or any of its descendants
+bool transform_is_offspring_of(Uint32 index, Uint32 index_other)
 {
-	if(ptr == ptr_other)
-		return true;
-	if(ptr == NULL || ptr_other == NULL)
-		return false;
-
-	if(ptr->child_first && transform_is_offspring_of(ptr->child_first, ptr_other))
-		return true;
-
-	if(ptr->sibling_next && transform_is_offspring_of(ptr->sibling_next, ptr_other))
-		return true;
-
+	while(index != TRANSFORM3D_INDEX_NULL)
+	{
+		if(index == index_other)
+			return true;
+		index = transform_hierarchy_get(index)->parent;
+	}
 	return false;
 }
 
-void transform_hierarchy_refresh_before_deletion(Transform3D* ptr_old, Transform3D* ptr_new)
+Uint32 transform_sort_key_order(const void* data)
 {
-	if(ptr_old == ptr_new)
-	{
-		return;
-	}
+	return ((const Transform3D*)data)->order;
+}
 
-	if(ptr_old->sibling_prev)
-		ptr_old->sibling_prev->sibling_next = ptr_new;
-	if(ptr_old->sibling_next)
-		ptr_old->sibling_next->sibling_prev = ptr_new;
+// assigns `order` and `parent_loc` walking the hierarchy depth-first, then sorts the pool by `order`
+void transform_hierarchy_sort()
+{
+	Uint32 order_next = 0;
+	stbds_arrsetlen(ctx_transform.stack, 0);
+	if(ctx_transform.root_first != TRANSFORM3D_INDEX_NULL)
+		stbds_arrput(ctx_transform.stack, ctx_transform.root_first);
 
-	Transform3D* child = ptr_old->child_first;
-	while(child)
+	while(stbds_arrlen(ctx_transform.stack) > 0)
 	{
-		child->parent = ptr_new;
-		child = child->sibling_next;
-	}
+		Uint32 index = stbds_arrpop(ctx_transform.stack);
+		Transform3D* node = transform_hierarchy_get(index);
 
-	if(ptr_new->sibling_prev)
-		ptr_new->sibling_prev->sibling_next = ptr_new->sibling_next;
-	if(ptr_new->sibling_next)
-		ptr_new->sibling_next->sibling_prev = ptr_new->sibling_prev;
+		node->order = order_next++;
+		node->parent_loc = node->parent != TRANSFORM3D_INDEX_NULL ? transform_hierarchy_get(node->parent)->order : TRANSFORM3D_INDEX_NULL;
 
-	child = ptr_new->child_first;
-	while(child)
-	{
-		child->parent = ptr_old;
-		child = child->sibling_next;
+		// sibling goes in first, so that the whole subtree is done before moving to it
+		if(node->sibling_next != TRANSFORM3D_INDEX_NULL)
+			stbds_arrput(ctx_transform.stack, node->sibling_next);
+		if(node->child_first != TRANSFORM3D_INDEX_NULL)
+			stbds_arrput(ctx_transform.stack, node->child_first);
 	}
+
+	SDL_assert(order_next == (Uint32)itu_sys_estorage_component_count(ITU_COMPONENT_TYPE_Transform3D)); // some Transform3D is not linked
+	itu_sys_estorage_component_sort_keys(ITU_COMPONENT_TYPE_Transform3D, transform_sort_key_order);
+	ctx_transform.order_dirty = false;
 }
 
 void itu_lib_transform_update_globals()
 {
-	Transform3D* stack[TRANSFORM_HIERARCHY_MAX_DEPTH] = { 0 };
-	stack[0] = (Transform3D*)TMP_transform_root.child_first;
-	int stack_depth = 0;
+	ITU_ComponentView view;
+	itu_sys_estorage_component_view(ITU_COMPONENT_TYPE_Transform3D, &view);
 
-	while(stack_depth >= 0)
+	// archetype mode: data is spread across archetypes, walk the hierarchy instead
+	if(!view.data)
 	{
-		Transform3D* curr = stack[stack_depth];
-		if(!curr)
+		stbds_arrsetlen(ctx_transform.stack, 0);
+		if(ctx_transform.root_first != TRANSFORM3D_INDEX_NULL)
+			stbds_arrput(ctx_transform.stack, ctx_transform.root_first);
+
+		while(stbds_arrlen(ctx_transform.stack) > 0)
 		{
-			--stack_depth;
-			if(stack_depth >= 0)
-				stack[stack_depth] = stack[stack_depth]->sibling_next;
-			continue;
+			Transform3D* node = transform_hierarchy_get(stbds_arrpop(ctx_transform.stack));
+			if(node->parent != TRANSFORM3D_INDEX_NULL)
+				node->global = transform_hierarchy_get(node->parent)->global * node->local;
+			else
+				node->global = node->local;
+
+			if(node->sibling_next != TRANSFORM3D_INDEX_NULL)
+				stbds_arrput(ctx_transform.stack, node->sibling_next);
+			if(node->child_first != TRANSFORM3D_INDEX_NULL)
+				stbds_arrput(ctx_transform.stack, node->child_first);
 		}
+		return;
+	}
 
-		if(stack_depth > 0)
-			curr->global = curr->parent->global * curr->local;
+	if(ctx_transform.order_dirty)
+		transform_hierarchy_sort();
+
+	Transform3D* transforms = (Transform3D*)view.data;
+	int count = itu_sys_estorage_component_count(ITU_COMPONENT_TYPE_Transform3D);
+	for(int i = 0; i < count; ++i)
+	{
+		Transform3D* curr = &transforms[i];
+		if(curr->parent_loc != TRANSFORM3D_INDEX_NULL)
+			curr->global = transforms[curr->parent_loc].global * curr->local;
 		else
 			curr->global = curr->local;
-		
-		if(curr->child_first && stack_depth < TRANSFORM_HIERARCHY_MAX_DEPTH)
-			stack[++stack_depth] = curr->child_first;
-		else
-			stack[stack_depth] = curr->sibling_next;
 	}
 }
 
-#endif // (defined ITU_LIB_TRANSFORM_IMPLEMENTATION) || (defined ITU_UNITY_BUILD)
\ No newline at end of file
+#endif // (defined ITU_LIB_TRANSFORM_IMPLEMENTATION) || (defined ITU_UNITY_BUILD)
@@ -7,6 +7,7 @@
 #include <SDL3_ttf/SDL_ttf.h>
 #include <stb_ds.h>
 #include <imgui/imgui.h>
+#include <itu_lib_strings.hpp>
 #endif
 
 struct TextureData
@@ -113,13 +114,8 @@ ITU_IdTexture itu_sys_rstorage_texture_add(SDL_Texture* texture)
 
 void itu_sys_rstorage_texture_set_debug_name(ITU_IdTexture id, const char* debug_name)
 {
-	// NOTE: allocating every single name is BAD, but we haven't looked in allocation startegies and memory arenas yet
-	int len = SDL_strlen(debug_name);
-	char* name_storage = (char*)SDL_malloc(len + 1);
-	SDL_memcpy(name_storage, debug_name, len);
-	name_storage[len] = 0;
-
-	stbds_hmput(ctx_rstorage.debug_names_texture, id, name_storage);
+	// NOTE: asset paths are interned, loading the same file more than once does not store its path again
+	stbds_hmput(ctx_rstorage.debug_names_texture, id, itu_lib_strings_intern(debug_name));
 }
 
 const char* itu_sys_rstorage_texture_get_debug_name(ITU_IdTexture id)
@@ -182,13 +178,7 @@ RawTextureData* itu_sys_rstorage_raw_texture_get_ptr(ITU_IdRawTexture id)
 
 void itu_sys_rstorage_raw_texture_set_debug_name(ITU_IdRawTexture id, const char* debug_name)
 {
-		// NOTE: allocating every single name is BAD, but we haven't looked in allocation startegies and memory arenas yet
-	int len = SDL_strlen(debug_name);
-	char* name_storage = (char*)SDL_malloc(len + 1);
-	SDL_memcpy(name_storage, debug_name, len);
-	name_storage[len] = 0;
-
-	stbds_hmput(ctx_rstorage.debug_names_raw_texture, id, name_storage);
+	stbds_hmput(ctx_rstorage.debug_names_raw_texture, id, itu_lib_strings_intern(debug_name));
 }
 
 const char* itu_sys_rstorage_raw_texture_get_debug_name(ITU_IdRawTexture id)
@@ -257,13 +247,7 @@ TTF_Font* itu_sys_rstorage_font_get_ptr(ITU_IdFont id)
 
 void itu_sys_rstorage_font_set_debug_name(ITU_IdFont id, const char* debug_name)
 {
-	// NOTE: allocating every single name is BAD, but we haven't looked in allocation startegies and memory arenas yet
-	int len = SDL_strlen(debug_name);
-	char* name_storage = (char*)SDL_malloc(len + 1);
-	SDL_memcpy(name_storage, debug_name, len);
-	name_storage[len] = 0;
-
-	stbds_hmput(ctx_rstorage.debug_names_font, id, name_storage);
+	stbds_hmput(ctx_rstorage.debug_names_font, id, itu_lib_strings_intern(debug_name));
 }
 
 const char* itu_sys_rstorage_font_get_debug_name(ITU_IdFont id)
@@ -328,13 +312,7 @@ Model3D* itu_sys_rstorage_model3d_get_ptr(ITU_IdModel3D id)
 
 void itu_sys_rstorage_model3d_set_debug_name(ITU_IdModel3D id, const char* debug_name)
 {
-	// NOTE: allocating every single name is BAD, but we haven't looked in allocation startegies and memory arenas yet
-	int len = SDL_strlen(debug_name);
-	char* name_storage = (char*)SDL_malloc(len + 1);
-	SDL_memcpy(name_storage, debug_name, len);
-	name_storage[len] = 0;
-
-	stbds_hmput(ctx_rstorage.debug_names_model3d, id, name_storage);
+	stbds_hmput(ctx_rstorage.debug_names_model3d, id, itu_lib_strings_intern(debug_name));
 }
 
 const char* itu_sys_rstorage_model3d_get_debug_name(ITU_IdModel3D id)
@@ -35,9 +35,12 @@
 #include <assimp/postprocess.h>
 
 #include <itu_common.hpp>
+#include <itu_lib_arena.hpp>
 #include <itu_lib_engine.hpp>
 #include <itu_lib_fileutils.hpp>
 #include <itu_lib_math.hpp>
+#include <itu_lib_jobs.hpp>
+#include <itu_lib_strings.hpp>
 
 #include <itu_entity_storage.hpp>
 #include <itu_resource_storage.hpp>
@@ -46,6 +49,7 @@
 #include <itu_lib_transform.hpp>
 #include <itu_lib_render.hpp>
 #include <itu_lib_overlaps.hpp>
+#include <itu_lib_broadphase.hpp>
 #include <itu_lib_sprite.hpp>
 #include <itu_lib_imgui.hpp>
 // #include <itu_lib_box2d.hpp> // deprecated
@@ -48,5 +48,27 @@ uint64_t lib_profiler_sample_end()
 	return elapsed / performance_frequency;
 
 }
+#else
+#include <time.h>
+
+uint64_t sample_beg;
+
+uint64_t get_performance_counter_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void lib_profiler_sample_beg()
+{
+	sample_beg = get_performance_counter_ns();
+}
+
+uint64_t lib_profiler_sample_end()
+{
+	return get_performance_counter_ns() - sample_beg;
+}
 #endif // WIN32
 #endif //LIB_SIMPLE_PROFILER_IMPLEMENTATION
\ No newline at end of file
@@ -0,0 +1,338 @@
+// compares the two ways a system body can reach component data in `itu_entity_storage` (sparse set mode):
+// - `entity_get_data`: out-of-line call per entity per component (validity check, `component_mask` test, `data_loc` lookup)
+// - `itu_view`       : pools are resolved once per system run, every access is a single typed `data_loc` load
+// both systems are called through an `ITU_SystemUpdateFunction`-like function pointer, with the same member list
+// the storage is reimplemented here in a minimal form, so that it can be tested with entity counts way above `ENTITIES_COUNT_MAX`
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string.h> // for memset
+#define LIB_SIMPLE_PROFILER_IMPLEMENTATION
+#include "lib_simple_profiler.h"
+
+#define NUM_TRIALS 10
+#define CHURN_PERCENT 20 // percentage of entities that lose and regain PhysicsData before measuring
+
+#define COMPONENTS_COUNT 3
+
+#define array_count(arr) (sizeof(arr) / sizeof(arr[0]))
+
+#if _MSC_VER
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
+// sizes roughly match the engine components
+struct Transform   { float position[2]; float scale[2]; float rotation; };
+struct Sprite      { void* texture; float rect_src[4]; float tint[4]; float pivot[2]; };
+struct PhysicsData { float velocity[2]; float acceleration[2]; float angular_velocity; float mass; uint64_t body_id; };
+
+enum ComponentType { COMPONENT_TRANSFORM, COMPONENT_SPRITE, COMPONENT_PHYSICS };
+const size_t component_sizes[COMPONENTS_COUNT] = { sizeof(Transform), sizeof(Sprite), sizeof(PhysicsData) };
+
+#define MASK_ALL ((1 << COMPONENT_TRANSFORM) | (1 << COMPONENT_SPRITE) | (1 << COMPONENT_PHYSICS))
+
+struct EntityId
+{
+	uint32_t generation;
+	uint32_t index;
+};
+
+struct Entity
+{
+	EntityId id;
+	uint64_t component_mask;
+};
+
+struct Pool
+{
+	size_t element_size;
+	int count_alive;
+
+	uint64_t* data_loc;   // entity index -> location in `data`, -1 if not present
+	uint32_t* entity_ids; // location in `data` -> entity index
+	unsigned char* data;
+};
+
+struct World
+{
+	Entity* entities;
+	int entities_count;
+	Pool pools[COMPONENTS_COUNT];
+
+	EntityId* members; // what `ITU_System::members` would hold for a Transform+Sprite+PhysicsData system
+	int members_count;
+};
+
+struct RunResults
+{
+	uint64_t min;
+	uint64_t max;
+	uint64_t avg;
+};
+
+typedef void (*system_update_t)(World* world, EntityId* entity_ids, int entity_ids_count);
+
+void world_init(World* world, int entities_count)
+{
+	world->entities = (Entity*)malloc(sizeof(Entity) * entities_count);
+	world->entities_count = entities_count;
+	for(int i = 0; i < COMPONENTS_COUNT; ++i)
+	{
+		Pool* pool = &world->pools[i];
+		pool->element_size = component_sizes[i];
+		pool->count_alive = 0;
+		pool->data_loc   = (uint64_t*)malloc(sizeof(uint64_t) * entities_count);
+		pool->entity_ids = (uint32_t*)malloc(sizeof(uint32_t) * entities_count);
+		pool->data       = (unsigned char*)malloc(pool->element_size * entities_count);
+		memset(pool->data_loc, -1, sizeof(uint64_t) * entities_count);
+	}
+	world->members = (EntityId*)malloc(sizeof(EntityId) * entities_count);
+	world->members_count = 0;
+}
+
+void world_free(World* world)
+{
+	for(int i = 0; i < COMPONENTS_COUNT; ++i)
+	{
+		free(world->pools[i].data_loc);
+		free(world->pools[i].entity_ids);
+		free(world->pools[i].data);
+	}
+	free(world->entities);
+	free(world->members);
+}
+
+void* pool_add(World* world, uint32_t entity, int type)
+{
+	Pool* pool = &world->pools[type];
+	uint64_t loc = pool->count_alive++;
+	pool->data_loc[entity] = loc;
+	pool->entity_ids[loc] = entity;
+	world->entities[entity].component_mask |= 1ull << type;
+	void* ret = pool->data + loc * pool->element_size;
+	memset(ret, 0, pool->element_size);
+	return ret;
+}
+
+void pool_remove(World* world, uint32_t entity, int type)
+{
+	Pool* pool = &world->pools[type];
+	uint64_t loc_curr = pool->data_loc[entity];
+	uint64_t loc_last = pool->count_alive - 1;
+	uint32_t entity_swap = pool->entity_ids[loc_last];
+
+	pool->entity_ids[loc_curr] = entity_swap;
+	memcpy(pool->data + loc_curr * pool->element_size, pool->data + loc_last * pool->element_size, pool->element_size);
+	pool->data_loc[entity_swap] = loc_curr;
+	pool->data_loc[entity] = -1;
+	pool->count_alive--;
+	world->entities[entity].component_mask &= ~(1ull << type);
+}
+
+// same steps as `itu_entity_data_get`
+NOINLINE void* entity_data_get(World* world, EntityId id, int type)
+{
+	if(id.index >= (uint32_t)world->entities_count || world->entities[id.index].id.generation != id.generation)
+		return NULL;
+
+	if(!(world->entities[id.index].component_mask & (1ull << type)))
+		return NULL;
+
+	Pool* pool = &world->pools[type];
+	return pool->data + pool->data_loc[id.index] * pool->element_size;
+}
+
+void system_update_get_data(World* world, EntityId* entity_ids, int entity_ids_count)
+{
+	const float delta_time = 0.016f;
+	for(int k = 0; k < entity_ids_count; ++k)
+	{
+		EntityId id = entity_ids[k];
+		Transform*   transform = (Transform*)  entity_data_get(world, id, COMPONENT_TRANSFORM);
+		Sprite*      sprite    = (Sprite*)     entity_data_get(world, id, COMPONENT_SPRITE);
+		PhysicsData* physics   = (PhysicsData*)entity_data_get(world, id, COMPONENT_PHYSICS);
+
+		physics->velocity[0] += physics->acceleration[0] * delta_time;
+		physics->velocity[1] += physics->acceleration[1] * delta_time;
+		transform->position[0] += physics->velocity[0] * delta_time;
+		transform->position[1] += physics->velocity[1] * delta_time;
+		transform->rotation += physics->angular_velocity * delta_time;
+		sprite->tint[3] = transform->rotation;
+	}
+}
+
+// same steps as `itu_view<Transform, Sprite, PhysicsData>`
+struct ComponentView
+{
+	unsigned char* data;
+	uint64_t* data_loc;
+};
+
+void system_update_view(World* world, EntityId* entity_ids, int entity_ids_count)
+{
+	const float delta_time = 0.016f;
+	ComponentView views[COMPONENTS_COUNT];
+	for(int i = 0; i < COMPONENTS_COUNT; ++i)
+	{
+		views[i].data     = world->pools[i].data;
+		views[i].data_loc = world->pools[i].data_loc;
+	}
+
+	for(int k = 0; k < entity_ids_count; ++k)
+	{
+		EntityId id = entity_ids[k];
+		Transform*   transform = (Transform*)  views[COMPONENT_TRANSFORM].data + views[COMPONENT_TRANSFORM].data_loc[id.index];
+		Sprite*      sprite    = (Sprite*)     views[COMPONENT_SPRITE   ].data + views[COMPONENT_SPRITE   ].data_loc[id.index];
+		PhysicsData* physics   = (PhysicsData*)views[COMPONENT_PHYSICS  ].data + views[COMPONENT_PHYSICS  ].data_loc[id.index];
+
+		physics->velocity[0] += physics->acceleration[0] * delta_time;
+		physics->velocity[1] += physics->acceleration[1] * delta_time;
+		transform->position[0] += physics->velocity[0] * delta_time;
+		transform->position[1] += physics->velocity[1] * delta_time;
+		transform->rotation += physics->angular_velocity * delta_time;
+		sprite->tint[3] = transform->rotation;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+// deterministic component layout: every entity has a Transform, half of them a Sprite, half of them PhysicsData
+uint64_t entity_mask(uint32_t entity)
+{
+	uint32_t h = entity * 2654435761u;
+	uint64_t mask = 1 << COMPONENT_TRANSFORM;
+	if(h & 0x100)
+		mask |= 1 << COMPONENT_SPRITE;
+	if(h & 0x200)
+		mask |= 1 << COMPONENT_PHYSICS;
+	return mask;
+}
+
+void init_physics(PhysicsData* physics, uint32_t entity)
+{
+	physics->acceleration[0] = (float)(entity % 7);
+	physics->acceleration[1] = (float)(entity % 5);
+	physics->angular_velocity = 0.1f;
+}
+
+void format_nanosecs(uint64_t time, char* buf)
+{
+	const char* prefixes[] = { "ns", "us", "ms", "s"};
+	uint64_t frac = 0;
+
+	int prefix = 0;
+	while (time >= 1000 && prefix < (int)array_count(prefixes) - 1)
+	{
+		frac = time % 1000;
+		time /= 1000;
+		++prefix;
+	}
+
+	sprintf(buf, "%3llu.%03llu%s", (unsigned long long)time, (unsigned long long)frac, prefixes[prefix]);
+}
+
+RunResults run_trials(World* world, system_update_t fn_update)
+{
+	RunResults ret = { (uint64_t)-1, 0, 0 };
+	for(int k = 0; k < NUM_TRIALS; ++k)
+	{
+		lib_profiler_sample_beg();
+		fn_update(world, world->members, world->members_count);
+		uint64_t elapsed = lib_profiler_sample_end();
+
+		if(elapsed < ret.min)
+			ret.min = elapsed;
+		if(elapsed > ret.max)
+			ret.max = elapsed;
+		ret.avg += elapsed;
+	}
+	ret.avg /= NUM_TRIALS;
+	return ret;
+}
+
+int main(void)
+{
+	int sizes[] = { 10000, 100000, 1000000 };
+	int sizes_count = array_count(sizes);
+
+	printf("%10s%24s%24s\n", "N", "entity_get_data", "itu_view");
+	for(int s = 0; s < sizes_count; ++s)
+	{
+		int entities_count = sizes[s];
+
+		World world;
+		world_init(&world, entities_count);
+
+		for(int e = 0; e < entities_count; ++e)
+		{
+			world.entities[e].id.generation = 0;
+			world.entities[e].id.index = e;
+			world.entities[e].component_mask = 0;
+
+			uint64_t mask = entity_mask(e);
+			for(int i = 0; i < COMPONENTS_COUNT; ++i)
+				if(mask & (1ull << i))
+					pool_add(&world, e, i);
+
+			if(mask & (1 << COMPONENT_PHYSICS))
+				init_physics((PhysicsData*)entity_data_get(&world, world.entities[e].id, COMPONENT_PHYSICS), e);
+		}
+
+		// simulate gameplay churn: entities losing and regaining a component scramble the order of the pools
+		srand(42);
+		for(int n = 0; n < entities_count * CHURN_PERCENT / 100; ++n)
+		{
+			uint32_t e = ((uint32_t)rand() * (RAND_MAX + 1u) + (uint32_t)rand()) % entities_count;
+			if(!(world.entities[e].component_mask & (1 << COMPONENT_PHYSICS)))
+				continue;
+
+			pool_remove(&world, e, COMPONENT_PHYSICS);
+			init_physics((PhysicsData*)pool_add(&world, e, COMPONENT_PHYSICS), e);
+		}
+
+		for(int e = 0; e < entities_count; ++e)
+			if(world.entities[e].component_mask == MASK_ALL)
+				world.members[world.members_count++] = world.entities[e].id;
+
+		// sanity check: both paths have to resolve the same data
+		{
+			Transform* before = (Transform*)malloc(sizeof(Transform) * world.members_count);
+			for(int k = 0; k < world.members_count; ++k)
+				before[k] = *(Transform*)entity_data_get(&world, world.members[k], COMPONENT_TRANSFORM);
+
+			system_update_get_data(&world, world.members, world.members_count);
+			system_update_view(&world, world.members, world.members_count);
+
+			for(int k = 0; k < world.members_count; ++k)
+			{
+				PhysicsData* physics = (PhysicsData*)entity_data_get(&world, world.members[k], COMPONENT_PHYSICS);
+				Transform*   after   = (Transform*)  entity_data_get(&world, world.members[k], COMPONENT_TRANSFORM);
+				assert(after->rotation == before[k].rotation + 2 * physics->angular_velocity * 0.016f);
+				(void)physics; (void)after;
+			}
+			free(before);
+		}
+
+		RunResults results[2];
+		results[0] = run_trials(&world, system_update_get_data);
+		results[1] = run_trials(&world, system_update_view);
+
+		printf("%10d", entities_count);
+		for(int i = 0; i < 2; ++i)
+		{
+			char buf_avg[64];
+			char buf_min[64];
+			format_nanosecs(results[i].avg, buf_avg);
+			format_nanosecs(results[i].min, buf_min);
+			printf("%12s(%10s)", buf_avg, buf_min);
+		}
+		putc('\n', stdout);
+
+		world_free(&world);
+	}
+
+	return 0;
+}